@@ -0,0 +1,49 @@
+#include "admission_control.h"
+
+namespace http_handler {
+
+AdmissionController::AdmissionController(AdmissionSettings settings)
+        : settings_(settings) {
+}
+
+std::optional<AdmissionController::Clock::time_point> AdmissionController::TryEnqueue(Clock::time_point now) noexcept {
+    // Увеличиваем счётчик заранее, чтобы конкурирующие потоки не превысили предел вместе
+    const size_t depth = queue_depth_.fetch_add(1, std::memory_order_relaxed);
+    if (settings_.max_queue_depth != 0 && depth >= settings_.max_queue_depth) {
+        queue_depth_.fetch_sub(1, std::memory_order_relaxed);
+        rejected_by_depth_.fetch_add(1, std::memory_order_relaxed);
+        return std::nullopt;
+    }
+    return now;
+}
+
+bool AdmissionController::Dequeue(Clock::time_point enqueued_at, Clock::time_point now) noexcept {
+    using namespace std::chrono;
+    queue_depth_.fetch_sub(1, std::memory_order_relaxed);
+
+    const auto wait = duration_cast<microseconds>(now - enqueued_at);
+    last_wait_us_.store(wait.count(), std::memory_order_relaxed);
+    int64_t max_wait = max_wait_us_.load(std::memory_order_relaxed);
+    while (wait.count() > max_wait
+           && !max_wait_us_.compare_exchange_weak(max_wait, wait.count(), std::memory_order_relaxed)) {
+    }
+
+    if (settings_.max_queue_wait.count() != 0 && wait > settings_.max_queue_wait) {
+        rejected_by_wait_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+AdmissionController::Stats AdmissionController::GetStats() const noexcept {
+    using std::chrono::microseconds;
+    return {
+            queue_depth_.load(std::memory_order_relaxed),
+            microseconds{last_wait_us_.load(std::memory_order_relaxed)},
+            microseconds{max_wait_us_.load(std::memory_order_relaxed)},
+            rejected_by_depth_.load(std::memory_order_relaxed),
+            rejected_by_wait_.load(std::memory_order_relaxed)
+    };
+}
+
+}  // namespace http_handler
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+namespace http_handler {
+
+// Политика отказа в обслуживании при перегрузке api_strand
+struct AdmissionSettings {
+    // Максимальное число запросов, ожидающих выполнения в api_strand. 0 - без ограничения
+    size_t max_queue_depth = 1024;
+    // Запрос, простоявший в очереди дольше, отклоняется без обработки. 0 - без ограничения
+    std::chrono::milliseconds max_queue_wait{1000};
+    // Значение заголовка Retry-After в ответе 503
+    std::chrono::seconds retry_after{1};
+};
+
+// Учитывает глубину очереди к api_strand и время ожидания в ней.
+// Методы потокобезопасны: TryEnqueue вызывается из потоков сессий, Dequeue - внутри strand
+class AdmissionController {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Stats {
+        size_t queue_depth;
+        std::chrono::microseconds last_wait;
+        std::chrono::microseconds max_wait;
+        uint64_t rejected_by_depth;
+        uint64_t rejected_by_wait;
+    };
+
+    explicit AdmissionController(AdmissionSettings settings = {});
+
+    AdmissionController(const AdmissionController&) = delete;
+    AdmissionController& operator=(const AdmissionController&) = delete;
+
+    // Ставит запрос в очередь. Возвращает момент постановки или nullopt, если очередь переполнена
+    [[nodiscard]] std::optional<Clock::time_point> TryEnqueue(Clock::time_point now = Clock::now()) noexcept;
+
+    // Снимает запрос с очереди в момент начала его обработки.
+    // Возвращает false, если запрос ждал дольше допустимого и должен быть отклонён
+    [[nodiscard]] bool Dequeue(Clock::time_point enqueued_at, Clock::time_point now = Clock::now()) noexcept;
+
+    [[nodiscard]] std::chrono::seconds GetRetryAfter() const noexcept {
+        return settings_.retry_after;
+    }
+
+    [[nodiscard]] Stats GetStats() const noexcept;
+
+private:
+    AdmissionSettings settings_;
+    std::atomic<size_t> queue_depth_{0};
+    std::atomic<int64_t> last_wait_us_{0};
+    std::atomic<int64_t> max_wait_us_{0};
+    std::atomic<uint64_t> rejected_by_depth_{0};
+    std::atomic<uint64_t> rejected_by_wait_{0};
+};
+
+}  // namespace http_handler
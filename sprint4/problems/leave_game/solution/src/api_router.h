@@ -0,0 +1,155 @@
+#pragma once
+// boost.beast будет использовать std::string_view вместо boost::string_view
+#define BOOST_BEAST_USE_STD_STRING_VIEW
+
+#include <boost/beast/http/verb.hpp>
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+namespace http_handler {
+
+namespace http = boost::beast::http;
+
+// Точки входа API. Значения используются как индексы в таблице маршрутов
+enum class ApiRoute : uint8_t {
+    MAPS,
+    MAP_BY_ID,
+    RECORDS,
+    JOIN,
+    PLAYERS,
+    STATE,
+    ACTION,
+    TICK,
+    UNKNOWN
+};
+
+// Результат разбора цели запроса. Все строки ссылаются на память исходного запроса
+struct RouteMatch {
+    ApiRoute route = ApiRoute::UNKNOWN;
+    // Идентификатор карты для MAP_BY_ID
+    std::string_view param;
+    // Строка параметров после '?'
+    std::string_view query;
+};
+
+// Описание маршрута: допустимые методы и значение заголовка Allow
+struct RouteSpec {
+    uint64_t methods;
+    std::string_view allow;
+};
+
+namespace detail {
+
+constexpr uint64_t MethodBit(http::verb method) noexcept {
+    return uint64_t{1} << static_cast<unsigned>(method);
+}
+
+constexpr uint64_t GET_HEAD = MethodBit(http::verb::get) | MethodBit(http::verb::head);
+constexpr uint64_t GET = MethodBit(http::verb::get);
+constexpr uint64_t POST = MethodBit(http::verb::post);
+
+// Отделяет от пути первый сегмент вместе с завершающим '/'
+constexpr std::string_view PopSegment(std::string_view& path) noexcept {
+    const auto slash = path.find('/');
+    const auto segment = path.substr(0, slash);
+    path = slash == std::string_view::npos ? std::string_view{} : path.substr(slash + 1);
+    return segment;
+}
+
+// Разбирает сегменты после /api/v1/game/
+constexpr ApiRoute MatchGameRoute(std::string_view rest) noexcept {
+    const auto segment = PopSegment(rest);
+    if (segment == "player") {
+        return PopSegment(rest) == "action" && rest.empty() ? ApiRoute::ACTION : ApiRoute::UNKNOWN;
+    }
+    if (!rest.empty()) {
+        return ApiRoute::UNKNOWN;
+    }
+    // Сегменты различаются длиной и первой буквой, поэтому сравнение строк выполняется не более одного раза
+    switch (segment.size()) {
+        case 4:
+            if (segment[0] == 'j') {
+                return segment == "join" ? ApiRoute::JOIN : ApiRoute::UNKNOWN;
+            }
+            return segment == "tick" ? ApiRoute::TICK : ApiRoute::UNKNOWN;
+        case 5:
+            return segment == "state" ? ApiRoute::STATE : ApiRoute::UNKNOWN;
+        case 7:
+            if (segment[0] == 'r') {
+                return segment == "records" ? ApiRoute::RECORDS : ApiRoute::UNKNOWN;
+            }
+            return segment == "players" ? ApiRoute::PLAYERS : ApiRoute::UNKNOWN;
+        default:
+            return ApiRoute::UNKNOWN;
+    }
+}
+
+}  // namespace detail
+
+// Таблица маршрутов, индексируемая значением ApiRoute
+inline constexpr std::array<RouteSpec, static_cast<size_t>(ApiRoute::UNKNOWN) + 1> API_ROUTES{{
+    {detail::GET_HEAD, "GET, HEAD"},  // MAPS
+    {detail::GET_HEAD, "GET, HEAD"},  // MAP_BY_ID
+    {detail::GET, "GET"},             // RECORDS
+    {detail::POST, "POST"},           // JOIN
+    {detail::GET_HEAD, "GET, HEAD"},  // PLAYERS
+    {detail::GET_HEAD, "GET, HEAD"},  // STATE
+    {detail::POST, "POST"},           // ACTION
+    {detail::POST, "POST"},           // TICK
+    {0, ""},                          // UNKNOWN
+}};
+
+constexpr const RouteSpec& GetRouteSpec(ApiRoute route) noexcept {
+    return API_ROUTES[static_cast<size_t>(route)];
+}
+
+// Проверяет, допустим ли метод для маршрута, одной операцией над битовой маской
+constexpr bool IsMethodAllowed(ApiRoute route, http::verb method) noexcept {
+    return (GetRouteSpec(route).methods & detail::MethodBit(method)) != 0;
+}
+
+// Находит маршрут по цели запроса без выделения памяти.
+// Завершающий '/' допускается для всех точек входа, параметры запроса отделяются от пути
+constexpr RouteMatch MatchApiRoute(std::string_view target) noexcept {
+    RouteMatch match;
+    if (const auto question = target.find('?'); question != std::string_view::npos) {
+        match.query = target.substr(question + 1);
+        target = target.substr(0, question);
+    }
+
+    constexpr std::string_view API_PREFIX = "/api/v1/";
+    if (!target.starts_with(API_PREFIX)) {
+        return match;
+    }
+    std::string_view rest = target.substr(API_PREFIX.size());
+    const auto segment = detail::PopSegment(rest);
+    if (segment == "maps") {
+        if (rest.empty()) {
+            match.route = ApiRoute::MAPS;
+        } else {
+            match.route = ApiRoute::MAP_BY_ID;
+            match.param = rest;
+        }
+    } else if (segment == "game") {
+        match.route = detail::MatchGameRoute(rest);
+    }
+    return match;
+}
+
+// Вызывает fn(key, value) для каждого параметра строки запроса, не выделяя память.
+// Параметры без '=' пропускаются
+template <typename Fn>
+constexpr void ForEachQueryParam(std::string_view query, Fn&& fn) {
+    while (!query.empty()) {
+        const auto ampersand = query.find('&');
+        const auto param = query.substr(0, ampersand);
+        query = ampersand == std::string_view::npos ? std::string_view{} : query.substr(ampersand + 1);
+        if (const auto eq = param.find('='); eq != std::string_view::npos) {
+            fn(param.substr(0, eq), param.substr(eq + 1));
+        }
+    }
+}
+
+}  // namespace http_handler
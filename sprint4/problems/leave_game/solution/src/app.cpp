@@ -1,4 +1,9 @@
 #include "app.h"
+#include "logger.h"
+#include "metrics.h"
+#include "tick_profiler.h"
+
+#include <boost/asio/co_spawn.hpp>
 
 #include <iostream>
 #include <utility>
@@ -43,6 +48,18 @@ void DogTokens::SetTokenToSession(TokenToSession token_to_session) {
     token_to_session_ = std::move(token_to_session);
 }
 
+size_t DogTokens::EstimateHeapUsage() const noexcept {
+    using memory_usage::EstimateHeap;
+    size_t size = EstimateHeap(token_to_dog_) + EstimateHeap(token_to_session_);
+    for (const auto& [token, dog] : token_to_dog_) {
+        size += EstimateHeap(*token);
+    }
+    for (const auto& [token, session] : token_to_session_) {
+        size += EstimateHeap(*token);
+    }
+    return size;
+}
+
 bool DogTokens::DeleteDogToken(const std::shared_ptr<Dog> &dog_ptr) noexcept {
     if (!dog_ptr) {
         return false;
@@ -110,6 +127,36 @@ void Application::SetDatabase(std::shared_ptr<postgres::Database> database_ptr)
         throw std::invalid_argument("Database ptr is null");
     }
     db_ = std::move(database_ptr);
+    retired_players_writer_ = std::make_unique<RetiredPlayersWriter>(
+            db_->GetExecutor(), RetiredPlayersWriter::Settings{},
+            [db = db_](const postgres::RetiredPlayer& player) {
+                return SaveRetiredPlayerUseCase::Write(*db, player);
+            });
+}
+
+net::awaitable<size_t> Application::FlushRetiredPlayers(std::chrono::milliseconds timeout) {
+    co_return co_await retired_players_writer_->Flush(timeout);
+}
+
+net::awaitable<void> Application::LoadTableOfRecords() {
+    // Таблица загружается страницами по курсору: каждый запрос укладывается в query_timeout
+    // независимо от размера таблицы
+    constexpr int LOAD_BATCH_SIZE = 1000;
+    const auto conn = co_await db_->GetConnection();
+    const postgres::RetiredPlayersRepository player_repository{*conn, db_->GetQueryTimeout()};
+    std::vector<leaderboard::Record> records;
+    std::optional<postgres::RetiredPlayer> last;
+    for (;;) {
+        auto players = co_await player_repository.Load(last, LOAD_BATCH_SIZE);
+        for (const auto& player : players) {
+            records.push_back({player.id.ToString(), player.name, player.score, player.play_time_ms});
+        }
+        if (players.size() < LOAD_BATCH_SIZE) {
+            break;
+        }
+        last = std::move(players.back());
+    }
+    records_.Reset(std::move(records));
 }
 
 json::object Application::GetMapsById(const model::Map::Id &map_id) const {
@@ -119,7 +166,9 @@ json::object Application::GetMapsById(const model::Map::Id &map_id) const {
 
 JoinGameResult Application::JoinGame(const model::Map::Id &map_id, const std::string &user_name) {
     JoinGameUseCase join_game(game_model_, dog_tokens_);
-    return join_game.JoinGame(map_id, user_name);
+    auto result = join_game.JoinGame(map_id, user_name);
+    UpdateGameMetrics();
+    return result;
 }
 
 DogsList Application::ListPlayers(const Token& token) {
@@ -134,7 +183,14 @@ json::object Application::GameState(const Token &token) {
 
 MovePlayersResult Application::MovePlayers(const Token &token, std::string_view move) {
     MovePlayersUseCase move_players(dog_tokens_);
-    return move_players.MovePlayers(token, move);
+    const auto result = move_players.MovePlayers(token, move);
+    if (result == MovePlayersResult::OK) {
+        // Направление собаки меняется вне сессии, поэтому о смене состояния сессия узнаёт отсюда
+        if (const auto session = dog_tokens_.FindSessionByToken(token)) {
+            session->MarkStateChanged();
+        }
+    }
+    return result;
 }
 
 sig::connection Application::DoOnTick(const TickSignal::slot_type &handler) {
@@ -144,6 +200,7 @@ sig::connection Application::DoOnTick(const TickSignal::slot_type &handler) {
 void Application::Tick(std::chrono::milliseconds time_delta) {
     TickUseCase tick(game_model_, time_delta);
     tick.Tick();
+    UpdateGameMetrics();
     tick_signal_(time_delta);
 }
 
@@ -151,8 +208,22 @@ model::Game & Application::GetGame() const {
     return game_model_;
 }
 
-void Application::SetSessions(model::Game::Sessions sessions) const {
+void Application::SetSessions(model::Game::Sessions sessions) {
     game_model_.SetSessions(std::move(sessions));
+    UpdateGameMetrics();
+}
+
+void Application::UpdateGameMetrics() const {
+    size_t dogs = 0;
+    size_t loot_items = 0;
+    for (const auto& session : game_model_.GetSessions()) {
+        dogs += session->GetDogsCount();
+        loot_items += session->GetLootsCount();
+    }
+    auto& server_metrics = metrics::GetServerMetrics();
+    server_metrics.game_sessions.Set(static_cast<int64_t>(game_model_.GetSessions().size()));
+    server_metrics.dogs.Set(static_cast<int64_t>(dogs));
+    server_metrics.loot_items.Set(static_cast<int64_t>(loot_items));
 }
 
 void Application::SetTokenToDog(DogTokens::TokenToDog token_to_dog) {
@@ -172,15 +243,36 @@ void Application::OnRetiredDog(std::map<unsigned, std::shared_ptr<Dog>>::const_i
 }
 
 void Application::SaveRetiredPlayers(std::map<unsigned, std::shared_ptr<Dog>>::const_iterator &dog_it, const std::shared_ptr<model::GameSession> &session_ptr) {
-    const auto retired_players_use_case = SaveRetiredPlayerUseCase(*db_, session_ptr, dog_tokens_);
+    // В профиль тика входит только удаление собаки: запись в базу выполняется вне api_strand
+    const metrics::TickProfiler::PhaseTimer timer{metrics::GetTickProfiler(), metrics::TickPhase::RETIRE_DOG,
+                                                  *session_ptr->GetMap()->GetId()};
+    const auto retired_players_use_case = SaveRetiredPlayerUseCase(*retired_players_writer_, records_, session_ptr,
+                                                                   dog_tokens_);
     retired_players_use_case.Save(dog_it);
 }
 
-json::array Application::GetTableOfRecords(const int start, const int max_items) const {
-    const auto table_of_records_use_case = TableOfRecordsUseCase(*db_, start, max_items);
+MemoryUsage Application::EstimateMemoryUsage() const {
+    MemoryUsage usage;
+    for (const auto& map : game_model_.GetMaps()) {
+        usage.maps.emplace_back(*map.GetId(), map.EstimateMemoryUsage());
+    }
+    for (const auto& session : game_model_.GetSessions()) {
+        usage.sessions.emplace_back(*session->GetMap()->GetId(), session->EstimateMemoryUsage());
+    }
+    usage.tokens = dog_tokens_.EstimateHeapUsage();
+    return usage;
+}
+
+TableOfRecordsPage Application::GetTableOfRecords(const size_t start, const size_t max_items,
+                                                  const std::optional<leaderboard::Record> &after) const {
+    const auto table_of_records_use_case = TableOfRecordsUseCase(records_, start, max_items, after);
     return table_of_records_use_case.GetTableOfRecords();
 }
 
+uint64_t Application::GetTableOfRecordsVersion() const noexcept {
+    return records_.GetVersion();
+}
+
 DogsList ListDogsUseCase::ListDogs(const Token &token) const {
     if (const auto dog = dog_tokens_.FindDogByToken(token); !dog) {
         return std::nullopt;
@@ -393,51 +485,60 @@ void TickUseCase::Tick() {
     game_model_.Tick(time_delta_);
 }
 
-SaveRetiredPlayerUseCase::SaveRetiredPlayerUseCase(postgres::Database &db, const std::shared_ptr<model::GameSession>& session_ptr, DogTokens &player_tokens)
-                                                    : db_(db)
+SaveRetiredPlayerUseCase::SaveRetiredPlayerUseCase(RetiredPlayersWriter &writer, leaderboard::Leaderboard &records,
+                                                   const std::shared_ptr<model::GameSession>& session_ptr, DogTokens &player_tokens)
+                                                    : writer_(writer)
+                                                    , records_(records)
                                                     , session_ptr_(session_ptr)
                                                     , player_tokens_(player_tokens) {
 }
 
 void SaveRetiredPlayerUseCase::Save(std::map<unsigned, std::shared_ptr<Dog>>::const_iterator &dog_it) const {
-    const auto conn = db_.GetTransaction();
-    auto transaction = pqxx::work(*conn);
-    try {
-        const postgres::RetiredPlayersRepository player_repository{transaction};
-        const auto dog_ptr = dog_it->second;
-        player_repository.Save(dog_ptr->GetName(), static_cast<int>(dog_ptr->GetScore()), static_cast<int>(dog_ptr->GetPlayTime().count()));
-        player_tokens_.DeleteDogToken(dog_ptr);
-        if (!session_ptr_) {
-            throw std::runtime_error("GameSession is nullptr");
-        }
-        session_ptr_->DeleteDog(dog_it);
-    } catch (const std::exception &) {
-        transaction.abort();
-        throw;
-        // return;
+    const auto dog_ptr = dog_it->second;
+    postgres::RetiredPlayer player{postgres::RetiredPlayerId::New(), dog_ptr->GetName(),
+                                   static_cast<int>(dog_ptr->GetScore()),
+                                   static_cast<int>(dog_ptr->GetPlayTime().count())};
+    if (!session_ptr_) {
+        throw std::runtime_error("GameSession is nullptr");
+    }
+    player_tokens_.DeleteDogToken(dog_ptr);
+    session_ptr_->DeleteDog(dog_it);
+    records_.Add({player.id.ToString(), player.name, player.score, player.play_time_ms});
+    if (!writer_.Enqueue(std::move(player))) {
+        server_logging::LogServerError(0, "retired players queue is full"s, "save retired player"s);
     }
-    transaction.commit();
 }
 
-TableOfRecordsUseCase::TableOfRecordsUseCase(postgres::Database &db, const int start, const int max_items): db_(db)
+net::awaitable<void> SaveRetiredPlayerUseCase::Write(postgres::Database &db, postgres::RetiredPlayer player) {
+    const auto conn = co_await db.GetConnection();
+    const postgres::RetiredPlayersRepository player_repository{*conn, db.GetQueryTimeout()};
+    co_await player_repository.Save(player);
+}
+
+TableOfRecordsUseCase::TableOfRecordsUseCase(const leaderboard::Leaderboard &records, const size_t start,
+                                             const size_t max_items,
+                                             std::optional<leaderboard::Record> after): records_(records)
     , start_(start)
-    , max_items_(max_items) {
+    , max_items_(max_items)
+    , after_(std::move(after)) {
 }
 
-json::array TableOfRecordsUseCase::GetTableOfRecords() const {
-    const auto conn = db_.GetTransaction();
-    pqxx::transaction transaction(*conn);
-    const postgres::RetiredPlayersRepository player_repository{transaction};
-    auto player_records = player_repository.Load(start_, max_items_);
-    json::array player_records_json;
-    for (const auto &record : player_records) {
-        player_records_json.push_back({
+TableOfRecordsPage TableOfRecordsUseCase::GetTableOfRecords() const {
+    constexpr double MS_IN_S = 1000.0;
+    const auto page = after_ ? records_.GetPageAfter(*after_, max_items_) : records_.GetPage(start_, max_items_);
+    TableOfRecordsPage result{page.version, {}, {}};
+    if (!page.records.empty() && page.records.size() == max_items_) {
+        result.next_cursor = leaderboard::EncodeCursor(page.records.back());
+    }
+    result.records.reserve(page.records.size());
+    for (const auto &record : page.records) {
+        result.records.push_back({
             {"name"s, record.name},
             {"score"s, record.score},
-            {"playTime", record.play_time},
+            {"playTime", record.play_time_ms / MS_IN_S},
         });
     }
-    return player_records_json;
+    return result;
 }
 
 } // namespace app
\ No newline at end of file
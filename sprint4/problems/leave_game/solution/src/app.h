@@ -3,14 +3,18 @@
 #include <string>
 #include <optional>
 #include <chrono>
+#include <boost/asio/awaitable.hpp>
 #include <boost/signals2.hpp>
 
+#include "leaderboard.h"
 #include "postgres.h"
+#include "retired_players_writer.h"
 #include "tagged.h"
 #include "model.h"
 #include "json_loader.h"
 
 namespace sig = boost::signals2;
+namespace net = boost::asio;
 
 namespace app {
 
@@ -38,6 +42,8 @@ public:
     void SetTokenToDog(TokenToDog token_to_dog);
     void SetTokenToSession(TokenToSession token_to_session);
     bool DeleteDogToken(const std::shared_ptr<Dog> &dog_ptr) noexcept;
+    // Память обоих индексов токенов вместе со строками токенов
+    [[nodiscard]] size_t EstimateHeapUsage() const noexcept;
 
 
 private:
@@ -142,35 +148,64 @@ private:
 
 class SaveRetiredPlayerUseCase {
 public:
-    SaveRetiredPlayerUseCase(postgres::Database &db, const std::shared_ptr<model::GameSession>& session_ptr, DogTokens &player_tokens);
+    SaveRetiredPlayerUseCase(RetiredPlayersWriter &writer, leaderboard::Leaderboard &records,
+                             const std::shared_ptr<model::GameSession>& session_ptr, DogTokens &player_tokens);
+    // Сразу удаляет собаку из игры, добавляет игрока в таблицу рекордов в памяти и ставит его
+    // в очередь записи в базу данных, поэтому тик не ждёт базу данных
     void Save(std::map<unsigned, std::shared_ptr<Dog>>::const_iterator &dog_it) const;
+    // Записывает игрока в базу данных. Используется очередью записи
+    static net::awaitable<void> Write(postgres::Database &db, postgres::RetiredPlayer player);
 
 private:
-    postgres::Database &db_;
+    RetiredPlayersWriter &writer_;
+    leaderboard::Leaderboard &records_;
     const std::shared_ptr<model::GameSession> session_ptr_;
     DogTokens &player_tokens_;
 };
 
+// Страница таблицы рекордов в JSON и версия таблицы, из которой она взята
+struct TableOfRecordsPage {
+    uint64_t version{0};
+    json::array records;
+    // Курсор следующей страницы. Пустой, если страница неполная и за ней записей нет
+    std::string next_cursor;
+};
+
 class TableOfRecordsUseCase {
 public:
-    TableOfRecordsUseCase(postgres::Database &db, int start, int max_items);
-    [[nodiscard]] json::array GetTableOfRecords() const;
+    // Страница начинается с позиции start или, если задан after, с записи, следующей за after
+    TableOfRecordsUseCase(const leaderboard::Leaderboard &records, size_t start, size_t max_items,
+                          std::optional<leaderboard::Record> after);
+    [[nodiscard]] TableOfRecordsPage GetTableOfRecords() const;
 
 private:
-    postgres::Database &db_;
-    int start_;
-    int max_items_;
+    const leaderboard::Leaderboard &records_;
+    size_t start_;
+    size_t max_items_;
+    std::optional<leaderboard::Record> after_;
+};
+
+// Память игрового состояния по подсистемам
+struct MemoryUsage {
+    std::vector<std::pair<std::string, memory_usage::MapMemoryUsage>> maps;
+    // Сессии обозначаются идентификатором карты: на каждой карте одна сессия
+    std::vector<std::pair<std::string, memory_usage::SessionMemoryUsage>> sessions;
+    size_t tokens = 0;
 };
 
 class Application {
 public:
     using milliseconds = std::chrono::milliseconds;
     using TickSignal = sig::signal<void(milliseconds delta)>;
-    using TableOfRecords = std::vector<postgres::PlayerRecordResult>;
 
     explicit Application(model::Game &model_game);
 
     void SetDatabase(std::shared_ptr<postgres::Database> database_ptr);
+    // Загружает таблицу рекордов из базы данных в память. Вызывается при старте до запуска сервера
+    net::awaitable<void> LoadTableOfRecords();
+    // Ждёт записи ушедших на покой игроков в базу данных, но не дольше timeout.
+    // Возвращает число незаписанных игроков. Вызывается при остановке сервера
+    net::awaitable<size_t> FlushRetiredPlayers(std::chrono::milliseconds timeout);
     json::object GetMapsById(const model::Map::Id &map_id) const;
     JoinGameResult JoinGame(const model::Map::Id &map_id, const std::string &user_name);
     DogsList ListPlayers(const Token &token);
@@ -181,18 +216,30 @@ public:
     [[nodiscard]] sig::connection DoOnTick(const TickSignal::slot_type& handler);
     void Tick(std::chrono::milliseconds time_delta);
     model::Game& GetGame() const;
-    void SetSessions (model::Game::Sessions sessions) const;
+    void SetSessions (model::Game::Sessions sessions);
     void SetTokenToDog(DogTokens::TokenToDog token_to_dog);
     void SetTokenToSession(DogTokens::TokenToSession token_to_session);
     const DogTokens& GetDogTokens() const;
     void OnRetiredDog(std::map<unsigned, std::shared_ptr<Dog>>::const_iterator& dog_it, const std::shared_ptr<model::GameSession> &session_ptr);
     void SaveRetiredPlayers(std::map<unsigned, std::shared_ptr<Dog>>::const_iterator &dog_it, const std::shared_ptr<model::GameSession> &session_ptr);
-    json::array GetTableOfRecords(int start, int max_items) const;
+    // Таблица рекордов читается из памяти без обращения к базе данных и не требует api_strand
+    [[nodiscard]] TableOfRecordsPage GetTableOfRecords(size_t start, size_t max_items,
+                                                       const std::optional<leaderboard::Record> &after) const;
+    // Версия таблицы рекордов: меняется при каждом уходе игрока на покой
+    [[nodiscard]] uint64_t GetTableOfRecordsVersion() const noexcept;
+    // Оценивает память карт, сессий и токенов. Вызывается внутри api_strand
+    [[nodiscard]] MemoryUsage EstimateMemoryUsage() const;
 
 private:
+    // Обновляет метрики числа сессий, собак и потерянных предметов. Вызывается после изменения состояния игры
+    void UpdateGameMetrics() const;
+
     model::Game &game_model_;
     DogTokens dog_tokens_;
     std::shared_ptr<postgres::Database> db_;
+    std::unique_ptr<RetiredPlayersWriter> retired_players_writer_;
+    // Таблица рекордов в памяти. Изменяется внутри api_strand, читается из любых потоков
+    leaderboard::Leaderboard records_;
     TickSignal tick_signal_;
     sig::scoped_connection dog_retired_connection_;
 };
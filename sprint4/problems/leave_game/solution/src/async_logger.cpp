@@ -0,0 +1,220 @@
+#include "async_logger.h"
+#include "json_string.h"
+
+#include <cstdio>
+#include <ctime>
+
+namespace server_logging {
+
+using namespace std::literals;
+using util::AppendJsonString;
+
+namespace {
+
+std::atomic<uint64_t> next_logger_id{0};
+
+void AppendNumber(std::string& out, int64_t value) {
+    char buffer[24];
+    const int size = std::snprintf(buffer, sizeof(buffer), "%lld", static_cast<long long>(value));
+    out.append(buffer, size);
+}
+
+// Время в локальном часовом поясе в формате ISO 8601 с микросекундами: 2024-01-31T12:34:56.789012.
+// Дата и время с точностью до секунды форматируются заново только при смене секунды
+void AppendTimestamp(std::string& out, std::chrono::system_clock::time_point timestamp) {
+    thread_local std::time_t cached_seconds = -1;
+    thread_local char cached_prefix[32];
+    thread_local size_t cached_prefix_size = 0;
+
+    const auto since_epoch = timestamp.time_since_epoch();
+    const auto seconds = std::chrono::floor<std::chrono::seconds>(since_epoch);
+    const std::time_t time = seconds.count();
+    if (time != cached_seconds) {
+        std::tm tm{};
+        ::localtime_r(&time, &tm);
+        cached_prefix_size = std::strftime(cached_prefix, sizeof(cached_prefix), "%Y-%m-%dT%H:%M:%S", &tm);
+        cached_seconds = time;
+    }
+    out.append(cached_prefix, cached_prefix_size);
+
+    char fraction[16];
+    const auto micros = std::chrono::duration_cast<std::chrono::microseconds>(since_epoch - seconds).count();
+    const int size = std::snprintf(fraction, sizeof(fraction), ".%06lld", static_cast<long long>(micros));
+    out.append(fraction, size);
+}
+
+// Дописывает поля вида "name":value через запятую
+class JsonFields {
+public:
+    explicit JsonFields(std::string& out)
+            : out_(out) {
+    }
+
+    JsonFields& Add(std::string_view name, std::string_view value) {
+        AppendName(name);
+        AppendJsonString(out_, value);
+        return *this;
+    }
+
+    JsonFields& Add(std::string_view name, int64_t value) {
+        AppendName(name);
+        AppendNumber(out_, value);
+        return *this;
+    }
+
+private:
+    void AppendName(std::string_view name) {
+        if (!first_) {
+            out_ += ',';
+        }
+        first_ = false;
+        AppendJsonString(out_, name);
+        out_ += ':';
+    }
+
+    std::string& out_;
+    bool first_ = true;
+};
+
+std::string_view GetMessage(LogEventType type) {
+    switch (type) {
+        case LogEventType::REQUEST_RECEIVED:
+            return "request received"sv;
+        case LogEventType::RESPONSE_SENT:
+            return "response sent"sv;
+        case LogEventType::SERVER_STARTED:
+            return "server started"sv;
+        case LogEventType::SERVER_EXITED:
+            return "server exited"sv;
+        case LogEventType::SERVER_ERROR:
+            return "error"sv;
+        case LogEventType::EVENTS_DROPPED:
+            return "log events dropped"sv;
+    }
+    return "Unknown"sv;
+}
+
+}  // namespace
+
+void FormatLogEvent(const LogEvent& event, std::string& out) {
+    out += "{\"timestamp\":\""sv;
+    AppendTimestamp(out, event.timestamp);
+    out += "\",\"message\":"sv;
+    AppendJsonString(out, GetMessage(event.type));
+    out += ",\"data\":{"sv;
+
+    JsonFields data{out};
+    const auto& numbers = event.numbers;
+    const auto& strings = event.strings;
+    switch (event.type) {
+        case LogEventType::REQUEST_RECEIVED:
+            data.Add("ip"sv, strings[0].View()).Add("URI"sv, strings[1].View()).Add("method"sv, strings[2].View());
+            break;
+        case LogEventType::RESPONSE_SENT:
+            data.Add("response_time"sv, numbers[0]).Add("code"sv, numbers[1]).Add("content_type"sv, strings[0].View())
+                    .Add("strand_wait_us"sv, numbers[2]).Add("handler_time_us"sv, numbers[3]);
+            break;
+        case LogEventType::SERVER_STARTED:
+            data.Add("port"sv, numbers[0]).Add("address"sv, strings[0].View());
+            break;
+        case LogEventType::SERVER_EXITED:
+            data.Add("code"sv, numbers[0]).Add("exception"sv, strings[0].View());
+            break;
+        case LogEventType::SERVER_ERROR:
+            data.Add("code"sv, numbers[0]).Add("text"sv, strings[0].View()).Add("where"sv, strings[1].View());
+            break;
+        case LogEventType::EVENTS_DROPPED:
+            data.Add("count"sv, numbers[0]);
+            break;
+    }
+    out += "}}"sv;
+}
+
+AsyncLogger::AsyncLogger(std::ostream& output, AsyncLoggerSettings settings)
+        : id_(next_logger_id.fetch_add(1, std::memory_order_relaxed))
+        , output_(output)
+        , settings_(settings) {
+    batch_.reserve(settings_.max_batch_size + 1024);
+    thread_ = std::jthread([this](std::stop_token stop_token) {
+        Run(std::move(stop_token));
+    });
+}
+
+AsyncLogger::~AsyncLogger() {
+    thread_.request_stop();
+    thread_.join();
+}
+
+void AsyncLogger::Log(const LogEvent& event) {
+    if (!GetThreadRing().TryPush(event)) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+AsyncLogger::Ring& AsyncLogger::GetThreadRing() {
+    // Поток обычно пишет в один логгер, поэтому в кэше хранится только последний использованный буфер
+    thread_local uint64_t cached_id = UINT64_MAX;
+    thread_local std::shared_ptr<Ring> cached_ring;
+    if (cached_id != id_) {
+        auto ring = std::make_shared<Ring>(settings_.ring_capacity);
+        {
+            std::lock_guard lock{rings_mutex_};
+            rings_.push_back(ring);
+        }
+        cached_ring = std::move(ring);
+        cached_id = id_;
+    }
+    return *cached_ring;
+}
+
+void AsyncLogger::Run(std::stop_token stop_token) {
+    while (!stop_token.stop_requested()) {
+        if (Drain() == 0) {
+            std::this_thread::sleep_for(settings_.idle_period);
+        }
+    }
+    // Записываем события, принятые до остановки
+    Drain();
+}
+
+size_t AsyncLogger::Drain() {
+    {
+        std::lock_guard lock{rings_mutex_};
+        if (drain_rings_.size() != rings_.size()) {
+            drain_rings_ = rings_;
+        }
+    }
+
+    size_t count = 0;
+    for (const auto& ring : drain_rings_) {
+        count += ring->ConsumeAll([this](const LogEvent& event) {
+            FormatLogEvent(event, batch_);
+            batch_ += '\n';
+            if (batch_.size() >= settings_.max_batch_size) {
+                WriteBatch();
+            }
+        });
+    }
+
+    const uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+    if (dropped != reported_dropped_) {
+        LogEvent event{LogEventType::EVENTS_DROPPED, std::chrono::system_clock::now()};
+        event.numbers[0] = static_cast<int64_t>(dropped - reported_dropped_);
+        reported_dropped_ = dropped;
+        FormatLogEvent(event, batch_);
+        batch_ += '\n';
+    }
+    WriteBatch();
+    return count;
+}
+
+void AsyncLogger::WriteBatch() {
+    if (batch_.empty()) {
+        return;
+    }
+    output_.write(batch_.data(), static_cast<std::streamsize>(batch_.size()));
+    output_.flush();
+    batch_.clear();
+}
+
+}  // namespace server_logging
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "spsc_ring.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace server_logging {
+
+// Строка фиксированной ёмкости, хранящаяся внутри события. Длинные строки обрезаются
+class LogString {
+public:
+    static constexpr size_t CAPACITY = 255;
+
+    LogString() = default;
+    explicit LogString(std::string_view str) noexcept {
+        Assign(str);
+    }
+
+    void Assign(std::string_view str) noexcept {
+        size_ = static_cast<uint8_t>(std::min(str.size(), CAPACITY));
+        str.copy(data_.data(), size_);
+    }
+
+    [[nodiscard]] std::string_view View() const noexcept {
+        return {data_.data(), size_};
+    }
+
+private:
+    std::array<char, CAPACITY> data_;
+    uint8_t size_ = 0;
+};
+
+enum class LogEventType : uint8_t {
+    REQUEST_RECEIVED,
+    RESPONSE_SENT,
+    SERVER_STARTED,
+    SERVER_EXITED,
+    SERVER_ERROR,
+    // Служебное событие фонового потока: часть событий не поместилась в буферы
+    EVENTS_DROPPED
+};
+
+// Событие лога в двоичном виде. Значение полей numbers и strings зависит от типа события,
+// имена полей JSON подставляются только при форматировании
+struct LogEvent {
+    LogEventType type = LogEventType::SERVER_ERROR;
+    std::chrono::system_clock::time_point timestamp;
+    std::array<int64_t, 4> numbers{};
+    std::array<LogString, 3> strings;
+};
+
+// Форматирует событие в JSON-строку и дописывает её в out без перевода строки
+void FormatLogEvent(const LogEvent& event, std::string& out);
+
+struct AsyncLoggerSettings {
+    // Число событий в буфере одного потока. При переполнении новые события отбрасываются
+    size_t ring_capacity = 4096;
+    // Пауза фонового потока, когда буферы пусты
+    std::chrono::milliseconds idle_period{5};
+    // Накопленный текст записывается в поток вывода по достижении этого размера или когда буферы опустеют
+    size_t max_batch_size = 64 * 1024;
+};
+
+// Асинхронный логгер. Каждый поток пишет события в собственный кольцевой буфер без блокировок
+// и выделения памяти. Фоновый поток забирает события, форматирует их в JSON в переиспользуемый
+// буфер и записывает пачками. События разных потоков могут попасть в вывод не в порядке времени
+class AsyncLogger {
+public:
+    explicit AsyncLogger(std::ostream& output, AsyncLoggerSettings settings = {});
+    // Записывает все принятые события и останавливает фоновый поток
+    ~AsyncLogger();
+
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+    // Не блокируется. Буфер потока создаётся при первом вызове в этом потоке
+    void Log(const LogEvent& event);
+
+    [[nodiscard]] uint64_t GetDroppedCount() const noexcept {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+private:
+    using Ring = SpscRing<LogEvent>;
+
+    Ring& GetThreadRing();
+    void Run(std::stop_token stop_token);
+    // Забирает события из всех буферов и возвращает их количество. Выполняется только фоновым потоком
+    size_t Drain();
+    void WriteBatch();
+
+    // Идентификатор отличает буферы разных логгеров в кэше потока
+    const uint64_t id_;
+    std::ostream& output_;
+    AsyncLoggerSettings settings_;
+
+    std::mutex rings_mutex_;
+    std::vector<std::shared_ptr<Ring>> rings_;
+    std::atomic<uint64_t> dropped_{0};
+
+    // Состояние фонового потока
+    std::vector<std::shared_ptr<Ring>> drain_rings_;
+    std::string batch_;
+    uint64_t reported_dropped_ = 0;
+
+    std::jthread thread_;
+};
+
+}  // namespace server_logging
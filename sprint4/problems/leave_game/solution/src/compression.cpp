@@ -0,0 +1,93 @@
+#include "compression.h"
+
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+
+namespace compression {
+
+namespace io = boost::iostreams;
+using namespace std::literals;
+
+namespace {
+
+std::string_view Trim(std::string_view str) {
+    constexpr auto WHITESPACE = " \t"sv;
+    const auto begin = str.find_first_not_of(WHITESPACE);
+    if (begin == std::string_view::npos) {
+        return {};
+    }
+    const auto end = str.find_last_not_of(WHITESPACE);
+    return str.substr(begin, end - begin + 1);
+}
+
+// Проверяет, что параметры кодировки содержат q=0 (кодировка запрещена клиентом)
+bool HasZeroQuality(std::string_view params) {
+    while (!params.empty()) {
+        const auto semicolon = params.find(';');
+        const auto param = Trim(params.substr(0, semicolon));
+        params = semicolon == std::string_view::npos ? std::string_view{} : params.substr(semicolon + 1);
+
+        if (param.size() < 2 || (param[0] != 'q' && param[0] != 'Q') || param[1] != '=') {
+            continue;
+        }
+        const auto value = Trim(param.substr(2));
+        // Допустимые записи нулевого веса: 0, 0., 0.0, 0.00, 0.000
+        if (value.empty() || value[0] != '0') {
+            return false;
+        }
+        return value.find_first_not_of(".0"sv, 1) == std::string_view::npos;
+    }
+    return false;
+}
+
+}  // namespace
+
+std::string GzipCompress(std::string_view data, int level) {
+    std::string result;
+    io::filtering_ostream out;
+    out.push(io::gzip_compressor(io::gzip_params(level)));
+    out.push(io::back_inserter(result));
+    out.write(data.data(), static_cast<std::streamsize>(data.size()));
+    // Закрываем цепочку фильтров, чтобы дописать завершающий блок gzip
+    out.reset();
+    return result;
+}
+
+bool AcceptsGzip(std::string_view accept_encoding) {
+    bool wildcard_allowed = false;
+    while (!accept_encoding.empty()) {
+        const auto comma = accept_encoding.find(',');
+        const auto item = accept_encoding.substr(0, comma);
+        accept_encoding = comma == std::string_view::npos ? std::string_view{} : accept_encoding.substr(comma + 1);
+
+        const auto semicolon = item.find(';');
+        const auto coding = Trim(item.substr(0, semicolon));
+        const auto params = semicolon == std::string_view::npos ? std::string_view{} : item.substr(semicolon + 1);
+
+        if (boost::iequals(coding, "gzip"sv) || boost::iequals(coding, "x-gzip"sv)) {
+            // Явное упоминание gzip важнее, чем "*"
+            return !HasZeroQuality(params);
+        }
+        if (coding == "*"sv) {
+            wildcard_allowed = !HasZeroQuality(params);
+        }
+    }
+    return wildcard_allowed;
+}
+
+EncodedBody EncodeBody(std::string plain, const GzipSettings& settings) {
+    EncodedBody body;
+    if (settings.level > 0 && plain.size() >= settings.min_size) {
+        body.gzip = GzipCompress(plain, settings.level);
+        // Сжатие не дало выигрыша - отдаём исходное тело
+        if (body.gzip.size() >= plain.size()) {
+            body.gzip.clear();
+        }
+    }
+    body.plain = std::move(plain);
+    return body;
+}
+
+}  // namespace compression
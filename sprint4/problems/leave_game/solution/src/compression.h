@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace compression {
+
+// Параметры gzip-сжатия ответов отдельной точки входа
+struct GzipSettings {
+    // Тела короче порога отдаются без сжатия
+    size_t min_size = 1024;
+    // Уровень сжатия zlib: 1 - быстрее, 9 - сильнее
+    int level = 6;
+};
+
+// Тело ответа вместе с заранее сжатым вариантом
+struct EncodedBody {
+    std::string plain;
+    // Пустая строка, если сжатие не выполнялось или оказалось невыгодным
+    std::string gzip;
+};
+
+// Сжимает данные в формат gzip с заданным уровнем сжатия
+std::string GzipCompress(std::string_view data, int level);
+
+// Возвращает true, если значение заголовка Accept-Encoding разрешает ответ в gzip
+bool AcceptsGzip(std::string_view accept_encoding);
+
+// Подготавливает тело ответа: сжимает его, если размер не меньше порога
+EncodedBody EncodeBody(std::string plain, const GzipSettings& settings);
+
+}  // namespace compression
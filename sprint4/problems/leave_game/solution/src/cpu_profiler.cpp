@@ -0,0 +1,325 @@
+#include "cpu_profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+// В старых версиях glibc поле адресата сигнала не имеет короткого имени
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+namespace metrics {
+using namespace std::literals;
+
+namespace {
+
+// Наибольшее число выборок за одно профилирование
+constexpr size_t MAX_SAMPLES = 100'000;
+
+// Профилировщик, чьи таймеры сейчас запущены. Обработчик сигнала увеличивает счётчик до чтения указателя,
+// поэтому Stop, обнулив указатель и дождавшись нуля в счётчике, знает, что буфер больше никто не пишет
+std::atomic<CpuProfiler*> active_profiler{nullptr};
+std::atomic<int> handlers_in_flight{0};
+
+// Границы стека потока. Заполняются при регистрации потока и читаются обработчиком сигнала,
+// который выполняется в прерванном потоке. Переменные не требуют динамической инициализации,
+// поэтому обращение к ним из обработчика безопасно
+thread_local uintptr_t stack_low = 0;
+thread_local uintptr_t stack_high = 0;
+
+void LoadStackBounds() noexcept {
+    pthread_attr_t attr;
+    if (pthread_getattr_np(pthread_self(), &attr) != 0) {
+        return;
+    }
+    void* address = nullptr;
+    size_t size = 0;
+    if (pthread_attr_getstack(&attr, &address, &size) == 0) {
+        stack_low = reinterpret_cast<uintptr_t>(address);
+        stack_high = stack_low + size;
+    }
+    pthread_attr_destroy(&attr);
+}
+
+// Адрес прерванной инструкции и указатель её кадра
+struct InterruptedFrame {
+    const void* pc = nullptr;
+    uintptr_t fp = 0;
+};
+
+InterruptedFrame GetInterruptedFrame(const ucontext_t& context) noexcept {
+#if defined(__x86_64__)
+    return {reinterpret_cast<const void*>(context.uc_mcontext.gregs[REG_RIP]),
+            static_cast<uintptr_t>(context.uc_mcontext.gregs[REG_RBP])};
+#elif defined(__aarch64__)
+    return {reinterpret_cast<const void*>(context.uc_mcontext.pc), context.uc_mcontext.regs[29]};
+#else
+    (void)context;
+    return {};
+#endif
+}
+
+// Записывает в frames прерванную инструкцию и адреса возврата, проходя по цепочке указателей кадров.
+// Кадр хранит указатель кадра вызывающей функции и адрес возврата в неё. Читаются только адреса
+// внутри стека потока, а кадры вызывающих функций должны лежать выше, поэтому обход не может
+// обратиться к чужой памяти или зациклиться, даже если функция собрана без указателя кадра
+size_t WalkStack(InterruptedFrame interrupted, void** frames, size_t max_depth) noexcept {
+    size_t depth = 0;
+    if (interrupted.pc == nullptr || max_depth == 0) {
+        return depth;
+    }
+    frames[depth++] = const_cast<void*>(interrupted.pc);
+    uintptr_t fp = interrupted.fp;
+    while (depth < max_depth) {
+        if (fp < stack_low || fp + 2 * sizeof(void*) > stack_high || fp % alignof(void*) != 0) {
+            break;
+        }
+        const auto* frame = reinterpret_cast<void* const*>(fp);
+        if (frame[1] == nullptr) {
+            break;
+        }
+        frames[depth++] = frame[1];
+        const auto caller_fp = reinterpret_cast<uintptr_t>(frame[0]);
+        if (caller_fp <= fp) {
+            break;
+        }
+        fp = caller_fp;
+    }
+    return depth;
+}
+
+std::string Demangle(const char* name) {
+    int status = 0;
+    std::unique_ptr<char, decltype(&std::free)> demangled{abi::__cxa_demangle(name, nullptr, nullptr, &status),
+                                                          &std::free};
+    return status == 0 && demangled ? std::string{demangled.get()} : std::string{name};
+}
+
+// Имя функции по адресу. Адреса возврата указывают на инструкцию после вызова, поэтому ищется предыдущий байт.
+// Адреса без символа выводятся как смещение в модуле
+std::string Symbolize(const void* address, bool return_address) {
+    const auto* lookup = static_cast<const char*>(address) - (return_address ? 1 : 0);
+    Dl_info info{};
+    if (dladdr(lookup, &info) != 0) {
+        if (info.dli_sname) {
+            return Demangle(info.dli_sname);
+        }
+        if (info.dli_fname) {
+            std::string_view module = info.dli_fname;
+            module = module.substr(module.rfind('/') + 1);
+            char offset[32];
+            std::snprintf(offset, sizeof(offset), "+0x%zx",
+                          static_cast<size_t>(lookup - static_cast<const char*>(info.dli_fbase)));
+            return std::string{module} + offset;
+        }
+    }
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%p", address);
+    return buffer;
+}
+
+}  // namespace
+
+CpuProfiler::ThreadScope::ThreadScope(CpuProfiler& profiler)
+        : profiler_(profiler)
+        , tid_(gettid()) {
+    LoadStackBounds();
+    std::lock_guard lock{profiler_.mutex_};
+    auto& thread = profiler_.threads_.emplace_back(ProfiledThread{tid_, pthread_self(), std::nullopt});
+    if (profiler_.running_) {
+        profiler_.StartTimer(thread);
+    }
+}
+
+CpuProfiler::ThreadScope::~ThreadScope() {
+    // Таймер удаляется до завершения потока, чьё процессорное время он измеряет
+    std::lock_guard lock{profiler_.mutex_};
+    auto& threads = profiler_.threads_;
+    const auto it = std::find_if(threads.begin(), threads.end(), [this](const ProfiledThread& thread) {
+        return thread.tid == tid_;
+    });
+    if (it != threads.end()) {
+        StopTimer(*it);
+        threads.erase(it);
+    }
+}
+
+CpuProfiler::~CpuProfiler() {
+    Stop();
+}
+
+bool CpuProfiler::Start(int frequency, std::chrono::seconds duration) {
+    std::lock_guard lock{mutex_};
+    if (running_ || frequency <= 0) {
+        return false;
+    }
+    if (active_profiler.load() != nullptr) {
+        // Сигнал SIGPROF один на процесс, поэтому одновременно работает только один профилировщик
+        return false;
+    }
+
+    // Буфер рассчитан на всё время профилирования с запасом на потоки, зарегистрированные позже
+    const auto expected = static_cast<size_t>(frequency) * static_cast<size_t>(std::max<int64_t>(duration.count(), 1))
+                          * (threads_.size() + 1);
+    capacity_ = std::min(expected + expected / 4, MAX_SAMPLES);
+    samples_ = std::make_unique<Sample[]>(capacity_);
+    next_sample_.store(0);
+    interval_ = std::chrono::nanoseconds{1s} / frequency;
+
+    // Обработчик не снимается после остановки: сигнал, доставленный после удаления таймеров,
+    // иначе завершил бы процесс действием по умолчанию
+    struct sigaction action {};
+    action.sa_sigaction = &CpuProfiler::HandleSignal;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGPROF, &action, nullptr) != 0) {
+        throw std::system_error{errno, std::system_category(), "sigaction"s};
+    }
+
+    active_profiler.store(this);
+    running_ = true;
+    try {
+        for (auto& thread : threads_) {
+            StartTimer(thread);
+        }
+    } catch (...) {
+        for (auto& thread : threads_) {
+            StopTimer(thread);
+        }
+        running_ = false;
+        active_profiler.store(nullptr);
+        throw;
+    }
+    return true;
+}
+
+std::string CpuProfiler::Stop() {
+    std::unique_ptr<Sample[]> samples;
+    size_t count = 0;
+    {
+        std::lock_guard lock{mutex_};
+        if (!running_) {
+            return {};
+        }
+        for (auto& thread : threads_) {
+            StopTimer(thread);
+        }
+        running_ = false;
+        active_profiler.store(nullptr);
+        while (handlers_in_flight.load() != 0) {
+            std::this_thread::yield();
+        }
+        count = std::min(next_sample_.load(), capacity_);
+        samples = std::move(samples_);
+        capacity_ = 0;
+    }
+    // Выборки больше никто не пишет, поэтому имена функций ищутся после снятия блокировки
+    return Collapse(samples.get(), count);
+}
+
+void CpuProfiler::StartTimer(ProfiledThread& thread) const {
+    clockid_t clock;
+    if (const int error = pthread_getcpuclockid(thread.handle, &clock); error != 0) {
+        throw std::system_error{error, std::system_category(), "pthread_getcpuclockid"s};
+    }
+    sigevent event{};
+    event.sigev_notify = SIGEV_THREAD_ID;
+    event.sigev_signo = SIGPROF;
+    event.sigev_notify_thread_id = thread.tid;
+    timer_t timer;
+    if (timer_create(clock, &event, &timer) != 0) {
+        throw std::system_error{errno, std::system_category(), "timer_create"s};
+    }
+    itimerspec spec{};
+    spec.it_interval.tv_sec = static_cast<time_t>(interval_ / 1s);
+    spec.it_interval.tv_nsec = static_cast<long>((interval_ % 1s).count());
+    spec.it_value = spec.it_interval;
+    if (timer_settime(timer, 0, &spec, nullptr) != 0) {
+        const int error = errno;
+        timer_delete(timer);
+        throw std::system_error{error, std::system_category(), "timer_settime"s};
+    }
+    thread.timer = timer;
+}
+
+void CpuProfiler::StopTimer(ProfiledThread& thread) noexcept {
+    if (thread.timer) {
+        timer_delete(*thread.timer);
+        thread.timer.reset();
+    }
+}
+
+void CpuProfiler::HandleSignal([[maybe_unused]] int signal, [[maybe_unused]] siginfo_t* info, void* context) {
+    // Обработчик может прервать системный вызов, результат которого поток ещё не прочитал из errno
+    const int saved_errno = errno;
+    handlers_in_flight.fetch_add(1);
+    if (auto* profiler = active_profiler.load()) {
+        profiler->RecordSample(*static_cast<const ucontext_t*>(context));
+    }
+    handlers_in_flight.fetch_sub(1);
+    errno = saved_errno;
+}
+
+void CpuProfiler::RecordSample(const ucontext_t& context) noexcept {
+    const size_t index = next_sample_.fetch_add(1, std::memory_order_relaxed);
+    if (index >= capacity_) {
+        return;
+    }
+    // Раскрутка начинается с прерванной инструкции, поэтому кадров обработчика и трамплина ядра в стеке нет
+    auto& sample = samples_[index];
+    sample.depth = WalkStack(GetInterruptedFrame(context), sample.frames, MAX_DEPTH);
+    sample.ready.store(true, std::memory_order_release);
+}
+
+std::string CpuProfiler::Collapse(const Sample* samples, size_t count) {
+    std::unordered_map<const void*, std::string> symbols;
+    const auto symbolize = [&symbols](const void* address, bool return_address) -> const std::string& {
+        auto it = symbols.find(address);
+        if (it == symbols.end()) {
+            it = symbols.emplace(address, Symbolize(address, return_address)).first;
+        }
+        return it->second;
+    };
+
+    std::map<std::string, size_t> stacks;
+    std::string stack;
+    for (size_t i = 0; i < count; ++i) {
+        const auto& sample = samples[i];
+        if (!sample.ready.load(std::memory_order_acquire) || sample.depth == 0) {
+            continue;
+        }
+        // В свёрнутом формате стек записывается от корня к вершине
+        stack.clear();
+        for (size_t frame = sample.depth; frame-- > 0;) {
+            if (!stack.empty()) {
+                stack += ';';
+            }
+            stack += symbolize(sample.frames[frame], frame != 0);
+        }
+        ++stacks[stack];
+    }
+
+    std::string result;
+    for (const auto& [frames, samples] : stacks) {
+        result.append(frames).append(" "sv).append(std::to_string(samples)).append("\n"sv);
+    }
+    return result;
+}
+
+CpuProfiler& GetCpuProfiler() {
+    static CpuProfiler profiler;
+    return profiler;
+}
+
+}  // namespace metrics
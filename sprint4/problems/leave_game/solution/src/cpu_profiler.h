@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <ucontext.h>
+
+namespace metrics {
+
+// Выборочный профилировщик процессора. Каждый зарегистрированный поток получает собственный таймер
+// процессорного времени (timer_create с CLOCK_THREAD_CPUTIME_ID), который посылает этому потоку SIGPROF.
+// Обработчик сигнала записывает стек вызовов в заранее выделенный буфер, не выделяя память и не блокируясь.
+// Стек раскручивается по цепочке указателей кадров, поэтому код собирается с -fno-omit-frame-pointer:
+// backtrace() и _Unwind_Backtrace не безопасны в обработчике сигнала.
+// Результат - стеки в свёрнутом формате ("main;run;Tick 42"), который принимает flamegraph.pl.
+// Имена функций исполняемого файла видны, только если он собран с -rdynamic
+class CpuProfiler {
+public:
+    // Глубже этого стек обрезается со стороны корня
+    static constexpr size_t MAX_DEPTH = 48;
+
+    // Регистрирует поток на время своей жизни: профилировщик будет снимать его стеки
+    class ThreadScope {
+    public:
+        explicit ThreadScope(CpuProfiler& profiler);
+        ThreadScope(const ThreadScope&) = delete;
+        ThreadScope& operator=(const ThreadScope&) = delete;
+        ~ThreadScope();
+
+    private:
+        CpuProfiler& profiler_;
+        pid_t tid_;
+    };
+
+    CpuProfiler() = default;
+    CpuProfiler(const CpuProfiler&) = delete;
+    CpuProfiler& operator=(const CpuProfiler&) = delete;
+    ~CpuProfiler();
+
+    // Запускает выборку с частотой frequency раз в секунду процессорного времени каждого потока.
+    // Буфер рассчитан на duration профилирования. Возвращает false, если профилирование уже идёт.
+    // Выбрасывает std::system_error, если не удалось создать таймер
+    bool Start(int frequency, std::chrono::seconds duration);
+    // Останавливает выборку и возвращает собранные стеки в свёрнутом формате, по строке на стек.
+    // Если профилирование не запущено, возвращает пустую строку
+    std::string Stop();
+
+private:
+    struct Sample {
+        std::atomic<bool> ready{false};
+        size_t depth = 0;
+        void* frames[MAX_DEPTH];
+    };
+    struct ProfiledThread {
+        pid_t tid;
+        pthread_t handle;
+        std::optional<timer_t> timer;
+    };
+
+    static void HandleSignal(int signal, siginfo_t* info, void* context);
+    void RecordSample(const ucontext_t& context) noexcept;
+    void StartTimer(ProfiledThread& thread) const;
+    static void StopTimer(ProfiledThread& thread) noexcept;
+    // Переводит адреса в имена функций. Вызывается без блокировки: dladdr и деманглинг медленные
+    static std::string Collapse(const Sample* samples, size_t count);
+
+    std::mutex mutex_;
+    std::vector<ProfiledThread> threads_;
+    bool running_ = false;
+    std::chrono::nanoseconds interval_{};
+
+    // Буфер выборок. Обработчик сигнала занимает ячейку атомарным счётчиком
+    std::unique_ptr<Sample[]> samples_;
+    size_t capacity_ = 0;
+    std::atomic<size_t> next_sample_{0};
+};
+
+// Профилировщик процесса. Создаётся при первом обращении
+CpuProfiler& GetCpuProfiler();
+
+}  // namespace metrics
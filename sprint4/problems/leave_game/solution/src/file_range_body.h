@@ -0,0 +1,103 @@
+#pragma once
+// boost.beast будет использовать std::string_view вместо boost::string_view
+#define BOOST_BEAST_USE_STD_STRING_VIEW
+
+#include <boost/asio/buffer.hpp>
+#include <boost/beast/core/error.hpp>
+#include <boost/beast/core/file.hpp>
+#include <boost/beast/http/error.hpp>
+#include <boost/beast/http/message.hpp>
+#include <boost/optional.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+namespace http_handler {
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace net = boost::asio;
+
+// Тело ответа с фрагментом файла [offset, offset + length) или файлом целиком.
+// Сессия отправляет такое тело системным вызовом sendfile() прямо из дескриптора файла в сокет.
+// Writer с чтением через буфер используется, только если тело записывается обычным http::async_write
+struct FileRangeBody {
+    class value_type {
+    public:
+        void open(const char* path, uint64_t offset, uint64_t length, beast::error_code& ec) {
+            file_.open(path, beast::file_mode::read, ec);
+            offset_ = offset;
+            length_ = length;
+        }
+
+        // Открывает файл целиком. Размер берётся у открытого файла, а не из индекса
+        void open(const char* path, beast::error_code& ec) {
+            file_.open(path, beast::file_mode::read, ec);
+            offset_ = 0;
+            length_ = ec ? 0 : file_.size(ec);
+        }
+
+        [[nodiscard]] int native_handle() const {
+            return file_.native_handle();
+        }
+        [[nodiscard]] uint64_t offset() const noexcept {
+            return offset_;
+        }
+        [[nodiscard]] uint64_t size() const noexcept {
+            return length_;
+        }
+
+    private:
+        friend struct FileRangeBody;
+
+        beast::file file_;
+        uint64_t offset_ = 0;
+        uint64_t length_ = 0;
+    };
+
+    static std::uint64_t size(const value_type& body) noexcept {
+        return body.size();
+    }
+
+    class writer {
+    public:
+        using const_buffers_type = net::const_buffer;
+
+        template <bool isRequest, class Fields>
+        writer(const http::header<isRequest, Fields>&, value_type& body)
+                : body_(body)
+                , remain_(body.length_) {
+        }
+
+        void init(beast::error_code& ec) {
+            body_.file_.seek(body_.offset_, ec);
+        }
+
+        boost::optional<std::pair<const_buffers_type, bool>> get(beast::error_code& ec) {
+            if (remain_ == 0) {
+                ec = {};
+                return boost::none;
+            }
+            const auto amount = static_cast<size_t>(std::min<uint64_t>(remain_, buffer_.size()));
+            const size_t read = body_.file_.read(buffer_.data(), amount, ec);
+            if (ec) {
+                return boost::none;
+            }
+            if (read == 0) {
+                // Файл стал короче после формирования заголовков
+                ec = http::error::short_read;
+                return boost::none;
+            }
+            remain_ -= read;
+            return {{net::const_buffer(buffer_.data(), read), remain_ > 0}};
+        }
+
+    private:
+        value_type& body_;
+        uint64_t remain_;
+        std::array<char, 16 * 1024> buffer_;
+    };
+};
+
+}  // namespace http_handler
@@ -0,0 +1,120 @@
+#include "http_conditional.h"
+
+#include <algorithm>
+#include <charconv>
+#include <ctime>
+
+namespace http_handler {
+
+using namespace std::literals;
+
+namespace {
+
+// Разбирает неотрицательное число, занимающее строку целиком
+std::optional<uint64_t> ParseUint(std::string_view str) {
+    uint64_t value = 0;
+    const auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+    if (str.empty() || ec != std::errc{} || ptr != str.data() + str.size()) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+std::string_view TrimSpaces(std::string_view str) {
+    const auto begin = str.find_first_not_of(" \t"sv);
+    if (begin == std::string_view::npos) {
+        return {};
+    }
+    return str.substr(begin, str.find_last_not_of(" \t"sv) - begin + 1);
+}
+
+std::string_view StripWeakPrefix(std::string_view etag) {
+    return etag.starts_with("W/"sv) ? etag.substr(2) : etag;
+}
+
+}  // namespace
+
+std::string FormatHttpDate(std::chrono::system_clock::time_point time) {
+    const std::time_t seconds = std::chrono::system_clock::to_time_t(time);
+    std::tm tm{};
+    ::gmtime_r(&seconds, &tm);
+    char buffer[32];
+    // Имена дней и месяцев в локали "C" совпадают с требуемыми HTTP
+    const size_t size = std::strftime(buffer, sizeof(buffer), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    return {buffer, size};
+}
+
+std::optional<std::chrono::system_clock::time_point> ParseHttpDate(std::string_view date) {
+    const std::string str{date};
+    std::tm tm{};
+    const char* end = ::strptime(str.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    if (!end || *end != '\0') {
+        return std::nullopt;
+    }
+    return std::chrono::system_clock::from_time_t(::timegm(&tm));
+}
+
+bool MatchesEtag(std::string_view if_none_match, std::string_view etag) {
+    etag = StripWeakPrefix(etag);
+    while (!if_none_match.empty()) {
+        const auto comma = if_none_match.find(',');
+        const auto candidate = TrimSpaces(if_none_match.substr(0, comma));
+        if (candidate == "*"sv || StripWeakPrefix(candidate) == etag) {
+            return true;
+        }
+        if (comma == std::string_view::npos) {
+            break;
+        }
+        if_none_match.remove_prefix(comma + 1);
+    }
+    return false;
+}
+
+ParsedRange ParseRange(std::string_view range, uint64_t size) {
+    using Status = ParsedRange::Status;
+
+    range = TrimSpaces(range);
+    if (!range.starts_with("bytes="sv)) {
+        return {};
+    }
+    range.remove_prefix("bytes="sv.size());
+    const auto dash = range.find('-');
+    if (dash == std::string_view::npos || range.find(',') != std::string_view::npos) {
+        return {};
+    }
+
+    const auto first = TrimSpaces(range.substr(0, dash));
+    const auto last = TrimSpaces(range.substr(dash + 1));
+    if (first.empty()) {
+        // Суффикс: последние n байт
+        const auto suffix = ParseUint(last);
+        if (!suffix) {
+            return {};
+        }
+        if (*suffix == 0 || size == 0) {
+            return {Status::UNSATISFIABLE};
+        }
+        const uint64_t length = std::min(*suffix, size);
+        return {Status::SATISFIABLE, {size - length, length}};
+    }
+
+    const auto offset = ParseUint(first);
+    if (!offset) {
+        return {};
+    }
+    uint64_t end = size;
+    if (!last.empty()) {
+        const auto last_pos = ParseUint(last);
+        if (!last_pos || *last_pos < *offset) {
+            return {};
+        }
+        // Конец диапазона за пределами файла усекается до размера файла
+        end = *last_pos < size ? *last_pos + 1 : size;
+    }
+    if (*offset >= size) {
+        return {Status::UNSATISFIABLE};
+    }
+    return {Status::SATISFIABLE, {*offset, end - *offset}};
+}
+
+}  // namespace http_handler
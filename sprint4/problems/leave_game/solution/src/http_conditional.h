@@ -0,0 +1,41 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace http_handler {
+
+// Дата в формате HTTP (IMF-fixdate): "Sun, 06 Nov 1994 08:49:37 GMT"
+std::string FormatHttpDate(std::chrono::system_clock::time_point time);
+// Разбирает дату в формате IMF-fixdate. Устаревшие форматы не поддерживаются
+std::optional<std::chrono::system_clock::time_point> ParseHttpDate(std::string_view date);
+
+// Проверяет, содержит ли заголовок If-None-Match указанный ETag. Сравнение слабое: префикс W/ не учитывается
+bool MatchesEtag(std::string_view if_none_match, std::string_view etag);
+
+// Диапазон байт [offset, offset + length)
+struct ByteRange {
+    uint64_t offset = 0;
+    uint64_t length = 0;
+};
+
+struct ParsedRange {
+    enum class Status {
+        // Заголовка нет, он некорректен или содержит несколько диапазонов: отдаётся весь файл
+        IGNORED,
+        SATISFIABLE,
+        // Диапазон начинается за концом файла: ответ 416
+        UNSATISFIABLE
+    };
+
+    Status status = Status::IGNORED;
+    ByteRange range;
+};
+
+// Разбирает заголовок Range для ресурса размером size. Поддерживается один диапазон байт
+ParsedRange ParseRange(std::string_view range, uint64_t size);
+
+}  // namespace http_handler
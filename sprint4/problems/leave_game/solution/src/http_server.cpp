@@ -1,12 +1,267 @@
 #include "http_server.h"
 
+#include <boost/asio/detached.hpp>
+
+#include <algorithm>
+
+#include <sys/sendfile.h>
+
 namespace http_server {
 
+namespace {
+
+// Безопасные методы не меняют состояние сервера, поэтому такие запросы можно обрабатывать одновременно
+bool IsSafeMethod(http::verb method) {
+    return method == http::verb::get || method == http::verb::head;
+}
+
+}  // namespace
+
 void SessionBase::Run() {
-    // Вызываем метод Read, используя executor объекта stream_.
+    // Запускаем сопрограммы чтения и записи в executor объекта stream_.
     // Таким образом вся работа со stream_ будет выполняться, используя его executor
-    net::dispatch(stream_.get_executor(),
-                  beast::bind_front_handler(&SessionBase::Read, GetSharedThis()));
+    auto self = GetSharedThis();
+    net::co_spawn(stream_.get_executor(), WriteResponses(self), net::detached);
+    net::co_spawn(stream_.get_executor(), ReadRequests(self), net::detached);
+}
+
+net::awaitable<void> SessionBase::ReadRequests(std::shared_ptr<SessionBase> self) {
+    using namespace std::literals;
+    const size_t pipeline_depth = std::max<size_t>(1, limits_.pipeline_depth);
+    while (true) {
+        co_await WaitUntil(reader_wakeup_, [this, pipeline_depth] {
+            return closing_ || pending_.size() < pipeline_depth;
+        });
+        if (closing_) {
+            break;
+        }
+
+        // Создаём новый парсер для каждого запроса. Память запроса выделяется из пула соединения,
+        // куда возвращается после обработки предыдущего запроса.
+        // Парсер прекращает чтение, как только тело превысит допустимый размер
+        const RequestAllocator alloc{request_pool_};
+        parser_.emplace(std::piecewise_construct, std::make_tuple(alloc), std::make_tuple(alloc));
+        parser_->body_limit(limits_.max_body_size);
+        StartDeadline(read_deadline_);
+
+        beast::error_code ec;
+        if (buffer_.size() == 0) {
+            // Ждём первых байт запроса отдельно, чтобы простой keep-alive соединения не считался чтением.
+            // Прочитанные байты остаются в буфере, и парсер начинает с них
+            const size_t bytes = co_await stream_.async_read_some(buffer_.prepare(beast::read_size(buffer_, 65536)),
+                                                                  net::redirect_error(net::use_awaitable, ec));
+            buffer_.commit(bytes);
+            if (ec == net::error::eof) {
+                ec = http::error::end_of_stream;
+            }
+        }
+        const auto read_started_at = RequestInfo::Clock::now();
+        if (!ec) {
+            co_await http::async_read(stream_, buffer_, *parser_, net::redirect_error(net::use_awaitable, ec));
+        }
+        ec = StopDeadline(read_deadline_, ec);
+        if (closing_) {
+            // Чтение прервано из-за закрытия соединения
+            break;
+        }
+        if (ec == http::error::end_of_stream) {
+            // Нормальная ситуация - клиент закрыл соединение
+            eof_received_ = true;
+            break;
+        }
+        if (ec == http::error::body_limit) {
+            // Тело не дочитано, поэтому после ответа соединение закрывается
+            auto slot = AddSlot();
+            auto response = MakePayloadTooLarge(parser_->get().version());
+            co_await Write(std::move(slot), std::move(response));
+            break;
+        }
+        if (ec) {
+            server_logging::LogServerError(ec.value(), ec.message(), "read"s);
+            ReportError(ec, "read"sv);
+            break;
+        }
+
+        const RequestInfo info{{}, accepted_at_, read_started_at, RequestInfo::Clock::now()};
+        HttpRequest request = parser_->release();
+        if (IsSafeMethod(request.method())) {
+            // Запрос обрабатывается параллельно с чтением следующих
+            net::co_spawn(stream_.get_executor(), HandleSlot(self, std::move(request), AddSlot(), info),
+                          net::detached);
+            continue;
+        }
+        // Запрос, меняющий состояние, служит барьером: он обрабатывается после записи ответов
+        // на предыдущие запросы, а следующие запросы читаются после записи ответа на него
+        co_await WaitUntil(reader_wakeup_, [this] {
+            return closing_ || pending_.empty();
+        });
+        if (closing_) {
+            break;
+        }
+        auto slot = AddSlot();
+        co_await HandleSlot(self, std::move(request), std::move(slot), info);
+        co_await WaitUntil(reader_wakeup_, [this] {
+            return closing_ || pending_.empty();
+        });
+    }
+    reading_done_ = true;
+    writer_wakeup_.cancel();
+}
+
+net::awaitable<void> SessionBase::WriteResponses([[maybe_unused]] std::shared_ptr<SessionBase> self) {
+    using namespace std::literals;
+    while (true) {
+        co_await WaitUntil(writer_wakeup_, [this] {
+            return pending_.empty() ? reading_done_ : static_cast<bool>(pending_.front()->response);
+        });
+        if (pending_.empty()) {
+            // Все запросы прочитаны и ответы на них записаны
+            if (eof_received_) {
+                Close();
+            }
+            break;
+        }
+
+        const auto response = std::move(pending_.front()->response);
+        const auto on_written = std::move(pending_.front()->on_written);
+        const auto ec = co_await response->WriteTo(*this);
+        pending_.pop_front();
+        reader_wakeup_.cancel();
+        if (on_written) {
+            on_written(ec);
+        }
+
+        if (ec) {
+            server_logging::LogServerError(ec.value(), ec.message(), "write"s);
+            ReportError(ec, "write"sv);
+            // Закрытие сокета прерывает ожидающее чтение
+            closing_ = true;
+            beast::error_code close_ec;
+            stream_.socket().close(close_ec);
+            break;
+        }
+        if (response->NeedEof()) {
+            // Семантика ответа требует закрыть соединение. Ответы на следующие запросы не отправляются
+            closing_ = true;
+            Close();
+            beast::error_code cancel_ec;
+            stream_.socket().cancel(cancel_ec);
+            break;
+        }
+    }
+    reader_wakeup_.cancel();
+}
+
+net::awaitable<void> SessionBase::HandleSlot([[maybe_unused]] std::shared_ptr<SessionBase> self, HttpRequest request,
+                                             ResponseSlotPtr slot, RequestInfo info) {
+    using namespace std::literals;
+    const auto version = request.version();
+    try {
+        co_await HandleRequest(std::move(request), slot, std::move(info));
+    } catch (const std::exception& ex) {
+        server_logging::LogServerError(0, ex.what(), "handle"s);
+    }
+    if (!slot->response) {
+        // Обработчик не сформировал ответ. Без него очередь записи остановилась бы навсегда
+        http::response<http::string_body> res{http::status::internal_server_error, version};
+        res.set(http::field::content_type, "text/plain"sv);
+        res.keep_alive(false);
+        res.body() = "Internal Server Error"s;
+        res.prepare_payload();
+        co_await Write(slot, std::move(res));
+    }
+    // Место в очереди освобождается раньше self, которому принадлежит пул памяти
+    slot.reset();
+}
+
+net::awaitable<beast::error_code> SessionBase::SendFile(int file, uint64_t offset, uint64_t size) {
+    // Наибольшее число байт, которое Linux передаёт за один вызов sendfile()
+    constexpr uint64_t max_chunk = 0x7ffff000;
+
+    auto& socket = stream_.socket();
+    beast::error_code ec;
+    socket.native_non_blocking(true, ec);
+    if (ec) {
+        co_return ec;
+    }
+
+    auto file_offset = static_cast<off_t>(offset);
+    while (size > 0) {
+        const ssize_t sent = ::sendfile(socket.native_handle(), file, &file_offset, std::min(size, max_chunk));
+        if (sent > 0) {
+            size -= static_cast<uint64_t>(sent);
+            continue;
+        }
+        if (sent == 0) {
+            // Файл стал короче после формирования заголовков: клиент не получит обещанные байты
+            co_return http::error::short_read;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            co_return beast::error_code{errno, sys::system_category()};
+        }
+
+        // Срок отсчитывается для каждого ожидания, поэтому большой файл может передаваться дольше таймаута
+        StartDeadline(write_deadline_);
+        co_await socket.async_wait(tcp::socket::wait_write, net::redirect_error(net::use_awaitable, ec));
+        ec = StopDeadline(write_deadline_, ec);
+        if (ec) {
+            co_return ec;
+        }
+    }
+    co_return beast::error_code{};
+}
+
+void SessionBase::StartDeadline(Deadline& deadline) {
+    deadline.expired = false;
+    deadline.timer.expires_after(IO_TIMEOUT);
+    // Обработчик таймера может выполниться после завершения сессии, поэтому она захватывается слабой ссылкой
+    deadline.timer.async_wait([weak_self = std::weak_ptr{GetSharedThis()}, &deadline,
+                               generation = ++deadline.generation](beast::error_code ec) {
+        const auto self = weak_self.lock();
+        if (!self || ec || deadline.generation != generation) {
+            return;
+        }
+        deadline.expired = true;
+        beast::error_code close_ec;
+        self->stream_.socket().close(close_ec);
+    });
+}
+
+beast::error_code SessionBase::StopDeadline(Deadline& deadline, beast::error_code ec) {
+    ++deadline.generation;
+    deadline.timer.cancel();
+    if (ec && deadline.expired) {
+        return beast::error::timeout;
+    }
+    return ec;
+}
+
+SessionBase::ResponseSlotPtr SessionBase::AddSlot() {
+    auto slot = std::allocate_shared<ResponseSlot>(RecyclingAllocator<ResponseSlot>{request_pool_});
+    pending_.push_back(slot);
+    return slot;
+}
+
+http::response<http::string_body> SessionBase::MakePayloadTooLarge(unsigned version) {
+    using namespace std::literals;
+    http::response<http::string_body> res{http::status::payload_too_large, version};
+    res.set(http::field::content_type, "text/plain"sv);
+    res.keep_alive(false);
+    res.body() = "Payload Too Large"s;
+    res.prepare_payload();
+    return res;
+}
+
+void SessionBase::Close() {
+    beast::error_code ec;
+    stream_.socket().shutdown(tcp::socket::shutdown_send, ec);
+    if (ec) {
+        // Обрабатываем ошибку shutdown
+        ReportError(ec, "shutdown");
+    }
 }
 
 void ReportError(beast::error_code ec, std::string_view what) {
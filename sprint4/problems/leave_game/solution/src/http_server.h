@@ -1,14 +1,26 @@
 #pragma once
 #include "sdk.h"
 #include "logger.h"
+#include "session_allocator.h"
 // boost.beast будет использовать std::string_view вместо boost::string_view
 #define BOOST_BEAST_USE_STD_STRING_VIEW
 
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/co_spawn.hpp>
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/asio/strand.hpp>
+#include <boost/asio/use_awaitable.hpp>
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <deque>
+#include <functional>
 #include <iostream>
+#include <optional>
 
 namespace sys = boost::system;
 
@@ -21,6 +33,98 @@ namespace http = beast::http;
 
 void ReportError(beast::error_code ec, std::string_view what);
 
+// Тело ответа, которое можно отправить системным вызовом sendfile() из открытого файла.
+// Ядро копирует данные из page cache в сокет, минуя буферы пользовательского пространства
+template <typename Body>
+concept SendfileBody = requires(const typename Body::value_type& body) {
+    { body.native_handle() } -> std::convertible_to<int>;
+    { body.offset() } -> std::convertible_to<uint64_t>;
+    { body.size() } -> std::convertible_to<uint64_t>;
+};
+
+// Запрос, поля и тело которого размещаются в пуле памяти соединения
+using RequestAllocator = RecyclingAllocator<char>;
+using RequestBody = http::basic_string_body<char, std::char_traits<char>, RequestAllocator>;
+using HttpRequest = http::request<RequestBody, http::basic_fields<RequestAllocator>>;
+
+// Сведения о запросе, известные только соединению. Передаются обработчику вместе с запросом
+struct RequestInfo {
+    using Clock = std::chrono::steady_clock;
+
+    tcp::endpoint remote_endpoint;
+    // Соединение принято
+    Clock::time_point accepted_at;
+    // Получены первые байты запроса и запрос прочитан целиком.
+    // Ожидание следующего запроса keep-alive соединения во время чтения не входит
+    Clock::time_point read_started_at;
+    Clock::time_point read_finished_at;
+};
+
+// Вызывается после записи ответа в сокет. Получает результат записи
+using WriteCallback = std::function<void(beast::error_code)>;
+
+// Ограничения, защищающие сервер от перегрузки соединениями и большими запросами
+struct ServerLimits {
+    // Максимальное число одновременно открытых соединений. 0 - без ограничения
+    size_t max_connections = 10000;
+    // Максимальный размер тела запроса. Запросы большего размера получают ответ 413
+    uint64_t max_body_size = 64 * 1024;
+    // Сколько запросов одного соединения может ожидать ответа одновременно (HTTP pipelining).
+    // 1 - следующий запрос читается только после записи ответа на предыдущий
+    size_t pipeline_depth = 8;
+};
+
+// Параметры сокетов. По умолчанию сокеты не меняются: алгоритм Нейгла остаётся включённым,
+// а нулевой размер буфера оставляет значение, выбранное системой
+struct SocketSettings {
+    bool tcp_nodelay = false;
+    int send_buffer_size = 0;
+    int receive_buffer_size = 0;
+    // Разрешает нескольким acceptor'ам слушать один порт (SO_REUSEPORT).
+    // Ядро распределяет входящие соединения между ними
+    bool reuse_port = false;
+};
+
+// Считает открытые соединения. Listener и все его сессии разделяют один счётчик
+class ConnectionCounter : public std::enable_shared_from_this<ConnectionCounter> {
+public:
+    // Слот соединения освобождается при разрушении сессии, владеющей им
+    class Slot {
+    public:
+        Slot() = default;
+        explicit Slot(std::shared_ptr<ConnectionCounter> counter) noexcept
+                : counter_(std::move(counter)) {
+        }
+        Slot(Slot&&) noexcept = default;
+        Slot& operator=(Slot&&) noexcept = default;
+        ~Slot() {
+            if (counter_) {
+                counter_->count_.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+    private:
+        std::shared_ptr<ConnectionCounter> counter_;
+    };
+
+    explicit ConnectionCounter(size_t max_connections) noexcept
+            : max_connections_(max_connections) {
+    }
+
+    // Занимает слот или возвращает nullopt, если достигнут предел соединений
+    std::optional<Slot> TryAcquire() {
+        const size_t count = count_.fetch_add(1, std::memory_order_relaxed);
+        if (max_connections_ != 0 && count >= max_connections_) {
+            count_.fetch_sub(1, std::memory_order_relaxed);
+            return std::nullopt;
+        }
+        return Slot{shared_from_this()};
+    }
+
+private:
+    const size_t max_connections_;
+    std::atomic<size_t> count_{0};
+};
+
 class SessionBase {
 public:
     // Запрещаем копирование и присваивание объектов SessionBase и его наследников
@@ -28,22 +132,39 @@ public:
     SessionBase& operator=(const SessionBase&) = delete;
     void Run();
 protected:
-    using HttpRequest = http::request<http::string_body>;
+    // Ответ, ожидающий записи. Тип ответа стирается, чтобы ответы разных типов стояли в одной очереди
+    class PendingResponse {
+    public:
+        virtual ~PendingResponse() = default;
+        virtual net::awaitable<beast::error_code> WriteTo(SessionBase& session) = 0;
+        [[nodiscard]] virtual bool NeedEof() const = 0;
+    };
 
-    explicit SessionBase(tcp::socket&& socket)
-            : stream_(std::move(socket)) {
+    // Место ответа в очереди записи. Очередь упорядочена так же, как прочитанные запросы
+    struct ResponseSlot {
+        std::shared_ptr<PendingResponse> response;
+        WriteCallback on_written;
+    };
+    using ResponseSlotPtr = std::shared_ptr<ResponseSlot>;
+
+    SessionBase(tcp::socket&& socket, const ServerLimits& limits, ConnectionCounter::Slot slot)
+            : stream_(std::move(socket))
+            , accepted_at_(RequestInfo::Clock::now())
+            , limits_(limits)
+            , slot_(std::move(slot)) {
     }
 
+    // Помещает ответ на запрос в его место очереди. Ответ записывается, когда будут записаны ответы
+    // на все предыдущие запросы. Ответ и место в очереди размещаются в пуле соединения.
+    // on_written вызывается после записи ответа и не вызывается, если соединение закрылось раньше
     template <typename Body, typename Fields>
-    void Write(http::response<Body, Fields>&& response) {
-        // Запись выполняется асинхронно, поэтому response перемещаем в область кучи
-        auto safe_response = std::make_shared<http::response<Body, Fields>>(std::move(response));
-
-        auto self = GetSharedThis();
-        http::async_write(stream_, *safe_response,
-                          [safe_response, self](beast::error_code ec, std::size_t bytes_written) {
-                              self->OnWrite(safe_response->need_eof(), ec, bytes_written);
-                          });
+    net::awaitable<void> Write(ResponseSlotPtr slot, http::response<Body, Fields> response,
+                               WriteCallback on_written = {}) {
+        slot->on_written = std::move(on_written);
+        slot->response = std::allocate_shared<PendingResponseImpl<Body, Fields>>(
+                RecyclingAllocator<PendingResponseImpl<Body, Fields>>{request_pool_}, std::move(response));
+        writer_wakeup_.cancel();
+        co_return;
     }
     ~SessionBase() = default;
 
@@ -53,59 +174,108 @@ protected:
     }
 
 private:
-    void Read() {
-        using namespace std::literals;
-        // Очищаем запрос от прежнего значения (метод Read может быть вызван несколько раз)
-        request_ = {};
-        stream_.expires_after(30s);
-        // Считываем request_ из stream_, используя buffer_ для хранения считанных данных
-        http::async_read(stream_, buffer_, request_,
-                // По окончании операции будет вызван метод OnRead
-                         beast::bind_front_handler(&SessionBase::OnRead, GetSharedThis()));
-    }
-    void OnRead(beast::error_code ec, [[maybe_unused]] std::size_t bytes_read) {
-        using namespace std::literals;
-        if (ec == http::error::end_of_stream) {
-            // Нормальная ситуация - клиент закрыл соединение
-            return Close();
+    template <typename Body, typename Fields>
+    class PendingResponseImpl final : public PendingResponse {
+    public:
+        explicit PendingResponseImpl(http::response<Body, Fields>&& response)
+                : response_(std::move(response)) {
         }
-        if (ec) {
-            server_logging::LogServerError(ec.value(), ec.message(), "read"s);
-            return ReportError(ec, "read"sv);
+        net::awaitable<beast::error_code> WriteTo(SessionBase& session) override {
+            beast::error_code ec;
+            if constexpr (SendfileBody<Body>) {
+                // Заголовок записывается через Beast, тело - напрямую из файла
+                http::response_serializer<Body, Fields> serializer{response_};
+                session.StartDeadline(session.write_deadline_);
+                co_await http::async_write_header(session.stream_, serializer,
+                                                  net::redirect_error(net::use_awaitable, ec));
+                ec = session.StopDeadline(session.write_deadline_, ec);
+                if (!ec) {
+                    const auto& body = response_.body();
+                    ec = co_await session.SendFile(body.native_handle(), body.offset(), body.size());
+                }
+            } else {
+                session.StartDeadline(session.write_deadline_);
+                co_await http::async_write(session.stream_, response_, net::redirect_error(net::use_awaitable, ec));
+                ec = session.StopDeadline(session.write_deadline_, ec);
+            }
+            co_return ec;
         }
-        HandleRequest(std::move(request_));
-    }
-    void OnWrite(bool close, beast::error_code ec, [[maybe_unused]] std::size_t bytes_written) {
-        using namespace std::literals;
-        if (ec) {
-            server_logging::LogServerError(ec.value(), ec.message(), "write"s);
-            return ReportError(ec, "write"sv);
+        [[nodiscard]] bool NeedEof() const override {
+            return response_.need_eof();
         }
+    private:
+        http::response<Body, Fields> response_;
+    };
 
-        if (close) {
-            // Семантика ответа требует закрыть соединение
-            return Close();
+    // Читает запросы, пока в очереди ответов есть место, и запускает их обработку.
+    // self продлевает время жизни сессии до завершения сопрограммы
+    net::awaitable<void> ReadRequests(std::shared_ptr<SessionBase> self);
+    // Записывает готовые ответы строго в порядке поступления запросов
+    net::awaitable<void> WriteResponses(std::shared_ptr<SessionBase> self);
+    // Обрабатывает запрос, заполняя его место в очереди ответов
+    net::awaitable<void> HandleSlot(std::shared_ptr<SessionBase> self, HttpRequest request, ResponseSlotPtr slot,
+                                    RequestInfo info);
+    // Ожидает выполнения условия. Сопрограмма, изменившая состояние, будит ожидающую отменой таймера
+    template <typename Predicate>
+    static net::awaitable<void> WaitUntil(net::steady_timer& wakeup, Predicate predicate) {
+        while (!predicate()) {
+            wakeup.expires_at(net::steady_timer::time_point::max());
+            beast::error_code ec;
+            co_await wakeup.async_wait(net::redirect_error(net::use_awaitable, ec));
         }
-
-        // Считываем следующий запрос
-        Read();
     }
-    void Close() {
-        beast::error_code ec;
-        stream_.socket().shutdown(tcp::socket::shutdown_send, ec);
-        if (ec) {
-            // Обрабатываем ошибку shutdown
-            ReportError(ec, "shutdown");
+    // Отправляет size байт файла, начиная с offset, через sendfile(). Когда буфер сокета заполнен,
+    // ожидает готовности сокета к записи, но не дольше таймаута записи
+    net::awaitable<beast::error_code> SendFile(int file, uint64_t offset, uint64_t size);
+
+    // Срок операции одного направления соединения
+    struct Deadline {
+        explicit Deadline(const net::any_io_executor& executor)
+                : timer(executor) {
         }
-    }
-    // Обработку запроса делегируем подклассу
-    virtual void HandleRequest(HttpRequest&& request) = 0;
+        net::steady_timer timer;
+        // Номер запуска. Срабатывание таймера, запущенного для уже завершённой операции, игнорируется
+        unsigned generation = 0;
+        bool expired = false;
+    };
+    // Запускает отсчёт срока операции. По истечении срока сокет закрывается, как это делает
+    // beast::tcp_stream, и ожидающие операции прерываются
+    void StartDeadline(Deadline& deadline);
+    // Останавливает отсчёт срока. Ошибка операции, прерванной по истечении срока, заменяется на beast::error::timeout
+    beast::error_code StopDeadline(Deadline& deadline, beast::error_code ec);
+    ResponseSlotPtr AddSlot();
+    static http::response<http::string_body> MakePayloadTooLarge(unsigned version);
+    void Close();
+    // Обработку запроса делегируем подклассу. Ответ передаётся в Write вместе со slot.
+    // В info заполнено всё, кроме адреса клиента
+    virtual net::awaitable<void> HandleRequest(HttpRequest request, ResponseSlotPtr slot, RequestInfo info) = 0;
 
     virtual std::shared_ptr<SessionBase> GetSharedThis() = 0;
-    // tcp_stream содержит внутри себя сокет и добавляет поддержку таймаутов
+    // Таймаут операций чтения и записи
+    static constexpr std::chrono::seconds IO_TIMEOUT{30};
+    // Собственные таймауты tcp_stream не используются: его срок общий для чтения и записи,
+    // и запись ответа продлевала бы срок чтения запроса. У каждого направления свой срок
     beast::tcp_stream stream_;
+    const RequestInfo::Clock::time_point accepted_at_;
+    // Буфер чтения не очищается между запросами и сохраняет выделенную память
     beast::flat_buffer buffer_;
-    HttpRequest request_;
+    ServerLimits limits_;
+    // Пул объявлен раньше парсера и очереди, чтобы разрушиться после размещённых в нём объектов
+    RecyclingPool request_pool_;
+    std::optional<http::request_parser<RequestBody, RequestAllocator>> parser_;
+    std::deque<ResponseSlotPtr, RecyclingAllocator<ResponseSlotPtr>> pending_{
+            RecyclingAllocator<ResponseSlotPtr>{request_pool_}};
+    // Все сопрограммы сессии выполняются в executor объекта stream_, поэтому состояние не требует блокировок
+    net::steady_timer reader_wakeup_{stream_.get_executor()};
+    net::steady_timer writer_wakeup_{stream_.get_executor()};
+    Deadline read_deadline_{stream_.get_executor()};
+    Deadline write_deadline_{stream_.get_executor()};
+    // Чтение завершено: клиент закрыл соединение, произошла ошибка или запрос не может быть дочитан
+    bool reading_done_ = false;
+    bool eof_received_ = false;
+    // Соединение закрывается: новые запросы не читаются, оставшиеся ответы не записываются
+    bool closing_ = false;
+    ConnectionCounter::Slot slot_;
 };
 
 template <typename RequestHandler>
@@ -113,21 +283,22 @@ class Session : public SessionBase, public std::enable_shared_from_this<Session<
 
 public:
     template <typename Handler>
-    Session(tcp::socket&& socket, Handler&& request_handler)
-            : SessionBase(std::move(socket))
+    Session(tcp::socket&& socket, Handler&& request_handler, const ServerLimits& limits, ConnectionCounter::Slot slot)
+            : SessionBase(std::move(socket), limits, std::move(slot))
             , request_handler_(std::forward<Handler>(request_handler)) {
     }
 private:
-    void HandleRequest(HttpRequest&& request) override {
-        // Получаем IP клиента
-
-//todo        const std::string client_ip_str = GetSocket().remote_endpoint().address().to_string();
-        // Захватываем умный указатель на текущий объект Session в лямбде,
-        // чтобы продлить время жизни сессии до вызова лямбды.
-        // Используется generic-лямбда функция, способная принять response произвольного типа
-        request_handler_(GetSocket().remote_endpoint(), std::move(request), [self = this->shared_from_this()](auto&& response) {
-            self->Write(std::move(response));
-        });
+    net::awaitable<void> HandleRequest(HttpRequest request, ResponseSlotPtr slot, RequestInfo info) override {
+        // Клиент мог уже закрыть соединение, поэтому адрес получаем без исключения
+        beast::error_code ec;
+        info.remote_endpoint = GetSocket().remote_endpoint(ec);
+        // Сессия жива, пока выполняется сопрограмма HandleSlot, поэтому достаточно захватить this.
+        // Используется generic-лямбда функция, способная принять response произвольного типа.
+        // Лямбда не создаётся прямо в выражении co_await: GCC 12 может дважды разрушить такой временный объект
+        auto send = [this, slot = std::move(slot)](auto&& response, WriteCallback on_written = {}) {
+            return Write(slot, std::move(response), std::move(on_written));
+        };
+        co_await request_handler_(std::move(info), std::move(request), std::move(send));
     }
     std::shared_ptr<SessionBase> GetSharedThis() override {
         return this->shared_from_this();
@@ -139,11 +310,18 @@ template <typename RequestHandler>
 class Listener : public std::enable_shared_from_this<Listener<RequestHandler>> {
 public:
     template <typename Handler>
-    Listener(net::io_context& ioc, const tcp::endpoint& endpoint, Handler&& request_handler)
+    Listener(net::io_context& ioc, const tcp::endpoint& endpoint, Handler&& request_handler,
+             const ServerLimits& limits = {}, const SocketSettings& socket_settings = {},
+             std::shared_ptr<ConnectionCounter> connections = nullptr)
             : ioc_(ioc)
             // Обработчики асинхронных операций acceptor_ будут вызываться в своём strand
             , acceptor_(net::make_strand(ioc))
-            , request_handler_(std::forward<Handler>(request_handler)) {
+            , request_handler_(std::forward<Handler>(request_handler))
+            , limits_(limits)
+            , socket_settings_(socket_settings)
+            // Несколько Listener'ов могут разделять общий счётчик соединений
+            , connections_(connections ? std::move(connections)
+                                       : std::make_shared<ConnectionCounter>(limits.max_connections)) {
         // Открываем acceptor, используя протокол (IPv4 или IPv6), указанный в endpoint
         acceptor_.open(endpoint.protocol());
 
@@ -152,6 +330,10 @@ public:
         // Однако это может помешать повторно открыть сокет в полузакрытом состоянии.
         // Флаг reuse_address разрешает открыть сокет, когда он "наполовину закрыт"
         acceptor_.set_option(net::socket_base::reuse_address(true));
+        if (socket_settings_.reuse_port) {
+            using reuse_port = net::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+            acceptor_.set_option(reuse_port(true));
+        }
         // Привязываем acceptor к адресу и порту endpoint
         acceptor_.bind(endpoint);
         // Переводим acceptor в состояние, в котором он способен принимать новые соединения
@@ -165,7 +347,29 @@ public:
 
 private:
     void AsyncRunSession(tcp::socket&& socket) {
-        std::make_shared<Session<RequestHandler>>(std::move(socket), request_handler_)->Run();
+        auto slot = connections_->TryAcquire();
+        if (!slot) {
+            // Предел соединений исчерпан - сразу закрываем сокет, не тратя ресурсы на сессию
+            beast::error_code ec;
+            socket.close(ec);
+            return;
+        }
+        ApplySocketSettings(socket);
+        std::make_shared<Session<RequestHandler>>(std::move(socket), request_handler_, limits_,
+                                                  std::move(*slot))->Run();
+    }
+    // Ошибки настройки не критичны: соединение обслуживается с параметрами по умолчанию
+    void ApplySocketSettings(tcp::socket& socket) const {
+        beast::error_code ec;
+        if (socket_settings_.tcp_nodelay) {
+            socket.set_option(tcp::no_delay(true), ec);
+        }
+        if (socket_settings_.send_buffer_size > 0) {
+            socket.set_option(net::socket_base::send_buffer_size(socket_settings_.send_buffer_size), ec);
+        }
+        if (socket_settings_.receive_buffer_size > 0) {
+            socket.set_option(net::socket_base::receive_buffer_size(socket_settings_.receive_buffer_size), ec);
+        }
     }
     void DoAccept() {
         acceptor_.async_accept(
@@ -201,15 +405,21 @@ private:
     net::io_context& ioc_;
     tcp::acceptor acceptor_;
     RequestHandler request_handler_;
+    ServerLimits limits_;
+    SocketSettings socket_settings_;
+    std::shared_ptr<ConnectionCounter> connections_;
 };
 
 template <typename RequestHandler>
-void ServeHttp(net::io_context& ioc, const tcp::endpoint& endpoint, RequestHandler&& handler) {
+void ServeHttp(net::io_context& ioc, const tcp::endpoint& endpoint, RequestHandler&& handler,
+               const ServerLimits& limits = {}, const SocketSettings& socket_settings = {},
+               std::shared_ptr<ConnectionCounter> connections = nullptr) {
     // При помощи decay_t исключим ссылки из типа RequestHandler,
     // чтобы Listener хранил RequestHandler по значению
     using MyListener = Listener<std::decay_t<RequestHandler>>;
 
-    std::make_shared<MyListener>(ioc, endpoint, std::forward<RequestHandler>(handler))->Run();
+    std::make_shared<MyListener>(ioc, endpoint, std::forward<RequestHandler>(handler), limits, socket_settings,
+                                 std::move(connections))->Run();
 }
 
 }  // namespace http_server
@@ -1,4 +1,5 @@
 #include "infrastructure.h"
+#include "metrics.h"
 
 infrastructure::SerializingListener::SerializingListener(app::Application &app, const milliseconds period,
     const std::string &save_file): app_(app), save_period_(period), save_file_(save_file), temp_file_(save_file + ".tmp") {}
@@ -12,6 +13,7 @@ void infrastructure::SerializingListener::Save(milliseconds delta) {
 }
 
 void infrastructure::SerializingListener::Save() {
+    const auto save_start = std::chrono::steady_clock::now();
     try {
         // Открываем временный файл для записи
         std::ofstream ofs(temp_file_);
@@ -28,6 +30,7 @@ void infrastructure::SerializingListener::Save() {
         std::filesystem::rename(temp_file_, save_file_);
 
         time_since_save_ = 0ms;
+        metrics::GetServerMetrics().state_save_duration.Record(std::chrono::steady_clock::now() - save_start);
     } catch (const std::exception& ex) {
         std::filesystem::remove(temp_file_);
         throw ex;
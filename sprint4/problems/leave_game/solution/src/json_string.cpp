@@ -0,0 +1,39 @@
+#include "json_string.h"
+
+namespace util {
+using namespace std::literals;
+
+void AppendJsonString(std::string& out, std::string_view str) {
+    constexpr std::string_view hex = "0123456789abcdef"sv;
+    out += '"';
+    for (const char c : str) {
+        switch (c) {
+            case '"':
+                out += "\\\""sv;
+                break;
+            case '\\':
+                out += "\\\\"sv;
+                break;
+            case '\n':
+                out += "\\n"sv;
+                break;
+            case '\r':
+                out += "\\r"sv;
+                break;
+            case '\t':
+                out += "\\t"sv;
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    out.append("\\u00"sv);
+                    out += hex[static_cast<unsigned char>(c) >> 4];
+                    out += hex[static_cast<unsigned char>(c) & 0xf];
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+}
+
+}  // namespace util
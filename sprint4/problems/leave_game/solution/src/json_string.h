@@ -0,0 +1,13 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace util {
+
+// Дописывает строку в JSON-кавычках, экранируя служебные символы. Перевод строки, возврат каретки и табуляция
+// записываются короткими последовательностями, остальные управляющие символы - в виде \u00XX.
+// Используется журналом и трассировками, которые формируют JSON без Boost.JSON
+void AppendJsonString(std::string& out, std::string_view str);
+
+}  // namespace util
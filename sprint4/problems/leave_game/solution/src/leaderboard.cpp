@@ -0,0 +1,161 @@
+#include "leaderboard.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <mutex>
+#include <tuple>
+
+namespace leaderboard {
+using namespace std::literals;
+
+namespace {
+
+constexpr std::string_view BASE64URL_ALPHABET = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_"sv;
+// Разделитель полей курсора. Имя стоит последним и может содержать разделитель
+constexpr char CURSOR_SEPARATOR = ':';
+
+// Кодирует данные в base64url без выравнивания символами '='
+std::string EncodeBase64Url(std::string_view data) {
+    std::string out;
+    out.reserve((data.size() * 4 + 2) / 3);
+    uint32_t buffer = 0;
+    int bits = 0;
+    for (const unsigned char byte : data) {
+        buffer = (buffer << 8) | byte;
+        bits += 8;
+        while (bits >= 6) {
+            bits -= 6;
+            out += BASE64URL_ALPHABET[(buffer >> bits) & 0x3F];
+        }
+    }
+    if (bits > 0) {
+        out += BASE64URL_ALPHABET[(buffer << (6 - bits)) & 0x3F];
+    }
+    return out;
+}
+
+std::optional<std::string> DecodeBase64Url(std::string_view text) {
+    static const auto decode_table = [] {
+        std::array<int8_t, 256> table{};
+        table.fill(-1);
+        for (size_t i = 0; i < BASE64URL_ALPHABET.size(); ++i) {
+            table[static_cast<unsigned char>(BASE64URL_ALPHABET[i])] = static_cast<int8_t>(i);
+        }
+        return table;
+    }();
+    std::string out;
+    out.reserve(text.size() * 3 / 4);
+    uint32_t buffer = 0;
+    int bits = 0;
+    for (const unsigned char ch : text) {
+        const int value = decode_table[ch];
+        if (value < 0) {
+            return std::nullopt;
+        }
+        buffer = (buffer << 6) | static_cast<uint32_t>(value);
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            out += static_cast<char>((buffer >> bits) & 0xFF);
+        }
+    }
+    return out;
+}
+
+// Разбирает целое поле курсора до разделителя и отрезает его вместе с разделителем
+bool TakeInt(std::string_view& text, int& value) {
+    const auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc{} || ptr == text.data() + text.size() || *ptr != CURSOR_SEPARATOR) {
+        return false;
+    }
+    text.remove_prefix(ptr - text.data() + 1);
+    return true;
+}
+
+}  // namespace
+
+std::string EncodeCursor(const Record& record) {
+    std::string text = std::to_string(record.score);
+    text.append(1, CURSOR_SEPARATOR).append(std::to_string(record.play_time_ms));
+    text.append(1, CURSOR_SEPARATOR).append(record.id);
+    text.append(1, CURSOR_SEPARATOR).append(record.name);
+    return EncodeBase64Url(text);
+}
+
+std::optional<Record> DecodeCursor(std::string_view cursor) {
+    const auto decoded = DecodeBase64Url(cursor);
+    if (!decoded) {
+        return std::nullopt;
+    }
+    std::string_view text = *decoded;
+    Record record;
+    if (!TakeInt(text, record.score) || !TakeInt(text, record.play_time_ms)) {
+        return std::nullopt;
+    }
+    const size_t id_end = text.find(CURSOR_SEPARATOR);
+    if (id_end == std::string_view::npos || id_end == 0) {
+        return std::nullopt;
+    }
+    record.id = text.substr(0, id_end);
+    record.name = text.substr(id_end + 1);
+    return record;
+}
+
+bool RecordOrder::operator()(const Record& lhs, const Record& rhs) const noexcept {
+    return std::tie(rhs.score, lhs.play_time_ms, lhs.name, lhs.id)
+           < std::tie(lhs.score, rhs.play_time_ms, rhs.name, rhs.id);
+}
+
+Leaderboard::Leaderboard()
+        : version_(static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count())) {
+}
+
+void Leaderboard::Reset(std::vector<Record> records) {
+    // Дерево заполняется без блокировки, а под блокировкой только подменяется
+    Tree loaded;
+    for (auto& record : records) {
+        loaded.insert(std::move(record));
+    }
+    std::unique_lock lock{mutex_};
+    records_.swap(loaded);
+    version_.fetch_add(1, std::memory_order_release);
+}
+
+void Leaderboard::Add(Record record) {
+    std::unique_lock lock{mutex_};
+    records_.insert(std::move(record));
+    version_.fetch_add(1, std::memory_order_release);
+}
+
+Page Leaderboard::GetPage(size_t start, size_t max_items) const {
+    Page page;
+    std::shared_lock lock{mutex_};
+    page.version = version_.load(std::memory_order_relaxed);
+    if (start < records_.size()) {
+        FillPage(records_.find_by_order(start), max_items, page);
+    }
+    return page;
+}
+
+Page Leaderboard::GetPageAfter(const Record& after, size_t max_items) const {
+    Page page;
+    std::shared_lock lock{mutex_};
+    page.version = version_.load(std::memory_order_relaxed);
+    FillPage(records_.upper_bound(after), max_items, page);
+    return page;
+}
+
+void Leaderboard::FillPage(Tree::const_iterator it, size_t max_items, Page& page) const {
+    for (; it != records_.end() && page.records.size() < max_items; ++it) {
+        page.records.push_back(*it);
+    }
+}
+
+size_t Leaderboard::GetSize() const {
+    std::shared_lock lock{mutex_};
+    return records_.size();
+}
+
+}  // namespace leaderboard
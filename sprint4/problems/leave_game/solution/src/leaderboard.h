@@ -0,0 +1,80 @@
+#pragma once
+
+#include <ext/pb_ds/assoc_container.hpp>
+#include <ext/pb_ds/tree_policy.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace leaderboard {
+
+// Запись таблицы рекордов
+struct Record {
+    // Идентификатор записи в базе данных. Различает игроков с одинаковыми именем и результатом
+    std::string id;
+    std::string name;
+    int score = 0;
+    int play_time_ms = 0;
+};
+
+// Порядок таблицы рекордов: по убыванию очков, затем по возрастанию времени игры, имени и идентификатора.
+// Совпадает с порядком выборки из базы данных, а идентификатор делает его строгим
+struct RecordOrder {
+    bool operator()(const Record& lhs, const Record& rhs) const noexcept;
+};
+
+// Курсор - позиция записи в таблице рекордов (очки, время игры, идентификатор и имя) в виде строки
+// base64url. Для клиента курсор непрозрачен: он только передаётся обратно, чтобы получить следующую страницу
+std::string EncodeCursor(const Record& record);
+// Возвращает позицию, закодированную в курсоре, или std::nullopt, если курсор некорректен
+std::optional<Record> DecodeCursor(std::string_view cursor);
+
+// Страница таблицы рекордов вместе с версией таблицы, из которой она взята
+struct Page {
+    uint64_t version = 0;
+    std::vector<Record> records;
+};
+
+// Таблица рекордов в памяти. Записи хранятся в дереве порядковых статистик, поэтому запись добавляется,
+// а страница с произвольным смещением находится за O(log n) без обращения к базе данных.
+// Записи добавляются из api_strand, а страницы читаются из любых потоков
+class Leaderboard {
+public:
+    Leaderboard();
+
+    // Заменяет содержимое таблицы записями, загруженными из базы данных
+    void Reset(std::vector<Record> records);
+    void Add(Record record);
+
+    // Возвращает не больше max_items записей, начиная с позиции start
+    [[nodiscard]] Page GetPage(size_t start, size_t max_items) const;
+    // Возвращает не больше max_items записей, следующих за позицией after. Позиция может
+    // не совпадать ни с одной записью, например если курсор получен до перезапуска сервера
+    [[nodiscard]] Page GetPageAfter(const Record& after, size_t max_items) const;
+    // Версия меняется при каждом изменении таблицы. Начальная версия берётся из системных часов,
+    // поэтому версии не повторяются после перезапуска сервера
+    [[nodiscard]] uint64_t GetVersion() const noexcept {
+        return version_.load(std::memory_order_acquire);
+    }
+    [[nodiscard]] size_t GetSize() const;
+
+private:
+    using Tree = __gnu_pbds::tree<Record, __gnu_pbds::null_type, RecordOrder, __gnu_pbds::rb_tree_tag,
+                                  __gnu_pbds::tree_order_statistics_node_update>;
+
+    // Копирует в страницу записи, начиная с it. Вызывается под блокировкой
+    void FillPage(Tree::const_iterator it, size_t max_items, Page& page) const;
+
+    mutable std::shared_mutex mutex_;
+    Tree records_;
+    // Изменяется под эксклюзивной блокировкой, поэтому страница и её версия согласованы
+    std::atomic<uint64_t> version_;
+};
+
+}  // namespace leaderboard
@@ -1,66 +1,82 @@
 #include "logger.h"
 
+#include <arpa/inet.h>
+
+#include <iostream>
+
 namespace server_logging {
 using namespace std::literals;
 
-void MyFormatter(const logging::record_view &rec, logging::formatting_ostream &strm) {
-    // Извлекаем атрибуты
-    auto timestamp = logging::extract<boost::posix_time::ptime>("TimeStamp"s, rec);
-    auto message = logging::extract<std::string>("Message"s, rec);
-    auto add_data = logging::extract<json::value>("AdditionalData"s, rec);
+namespace {
 
-    // Формируем JSON-объект для лог-записи
-    boost::json::object log_entry;
+// Логгер создаётся при первом обращении и разрушается при завершении программы,
+// записав все принятые события
+AsyncLogger& GetLogger() {
+    static AsyncLogger logger{std::cout};
+    return logger;
+}
 
-    // Добавляем атрибуты в JSON-объект
-    log_entry["timestamp"s] = to_iso_extended_string(*timestamp);  // Время в формате ISO
-    log_entry["message"s] = message ? *message : "Unknown"s;        // Сообщение
-    if (add_data) {
-        log_entry["data"s] = *add_data;  // Дополнительные данные (если есть)
-    }
+LogEvent MakeEvent(LogEventType type) {
+    return {type, std::chrono::system_clock::now()};
+}
 
-    // Выводим JSON в поток
-    strm << boost::json::serialize(log_entry);
+// Форматирует адрес без выделения памяти, в отличие от address::to_string
+void AssignAddress(LogString& str, const net::ip::address& address) {
+    char buffer[INET6_ADDRSTRLEN] = {};
+    if (address.is_v4()) {
+        const auto bytes = address.to_v4().to_bytes();
+        ::inet_ntop(AF_INET, bytes.data(), buffer, sizeof(buffer));
+    } else {
+        const auto bytes = address.to_v6().to_bytes();
+        ::inet_ntop(AF_INET6, bytes.data(), buffer, sizeof(buffer));
+    }
+    str.Assign(buffer);
 }
 
+}  // namespace
+
 void InitLogging() {
-    // Добавляем консольный логгер с кастомным форматтером
-    logging::add_console_log(
-            std::cout,
-            keywords::format = &MyFormatter,
-            keywords::auto_flush = true
-    );
+    GetLogger();
+}
+
+void LogRequest(const net::ip::address& client_ip, std::string_view uri, std::string_view method) {
+    auto event = MakeEvent(LogEventType::REQUEST_RECEIVED);
+    AssignAddress(event.strings[0], client_ip);
+    event.strings[1].Assign(uri);
+    event.strings[2].Assign(method);
+    GetLogger().Log(event);
+}
 
-    // Добавляем стандартные атрибуты, такие как время записи
-    logging::add_common_attributes();
+void LogResponse(const RequestContext& context, unsigned int status_code, std::string_view content_type) {
+    using namespace std::chrono;
+    auto event = MakeEvent(LogEventType::RESPONSE_SENT);
+    event.numbers = {duration_cast<milliseconds>(context.GetResponseTime()).count(), status_code,
+                     duration_cast<microseconds>(context.GetStrandWait()).count(),
+                     duration_cast<microseconds>(context.GetHandlerTime()).count()};
+    event.strings[0].Assign(content_type);
+    GetLogger().Log(event);
 }
 
 void LogServerStart(int port, const std::string &address) {
-    boost::json::value data = {
-            {"port"s,    port},
-            {"address"s, address}
-    };
-    BOOST_LOG_TRIVIAL(info) << boost::log::add_value(additional_data, data)
-                            << "server started"s;
+    auto event = MakeEvent(LogEventType::SERVER_STARTED);
+    event.numbers[0] = port;
+    event.strings[0].Assign(address);
+    GetLogger().Log(event);
 }
 
 void LogServerExit(int code, const std::string &exception) {
-    boost::json::value data = {
-            {"code"s, code},
-            {"exception"s, exception}
-    };
-    BOOST_LOG_TRIVIAL(info) << boost::log::add_value(additional_data, data)
-                            << "server exited"s;
+    auto event = MakeEvent(LogEventType::SERVER_EXITED);
+    event.numbers[0] = code;
+    event.strings[0].Assign(exception);
+    GetLogger().Log(event);
 }
 
 void LogServerError(int error_code, const std::string &error_message, const std::string &where) {
-    json::value custom_data{
-            {"code"s,  error_code},
-            {"text"s,  error_message},
-            {"where"s, where}
-    };
-    BOOST_LOG_TRIVIAL(error) << logging::add_value(additional_data, custom_data)
-                             << "error"s;
+    auto event = MakeEvent(LogEventType::SERVER_ERROR);
+    event.numbers[0] = error_code;
+    event.strings[0].Assign(error_message);
+    event.strings[1].Assign(where);
+    GetLogger().Log(event);
 }
 
 } // namespace server_logging
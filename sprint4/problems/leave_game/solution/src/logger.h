@@ -2,95 +2,85 @@
 // boost.beast будет использовать std::string_view вместо boost::string_view
 #define BOOST_BEAST_USE_STD_STRING_VIEW
 
-#include <boost/log/trivial.hpp>
-#include <boost/log/core.hpp>
-#include <boost/log/expressions.hpp>
-#include <boost/log/utility/setup/console.hpp>
-#include <boost/log/utility/setup/common_attributes.hpp>
-#include <boost/log/utility/manipulators/add_value.hpp>
-#include <boost/log/attributes/timer.hpp>
-#include <boost/log/attributes/scoped_attribute.hpp>
-#include <boost/log/support/date_time.hpp>
-#include <boost/log/sources/logger.hpp>
-#include <boost/json.hpp>
+#include "async_logger.h"
+#include "metrics.h"
+#include "request_context.h"
+#include "request_tracer.h"
+
 #include <boost/beast/http.hpp>
+#include <boost/asio/awaitable.hpp>
 #include <boost/asio/ip/tcp.hpp>
-#include <iostream>
 
 namespace server_logging {
 
-// Определяем ключевое слово для добавления произвольных данных в лог
-BOOST_LOG_ATTRIBUTE_KEYWORD(additional_data, "AdditionalData", boost::json::value)
-
 namespace beast = boost::beast;
 namespace http = beast::http;
-namespace logging = boost::log;
-namespace keywords = boost::log::keywords;
-namespace json = boost::json;
 namespace net = boost::asio;
 using tcp = net::ip::tcp;
 
-struct LogData {
-    unsigned int status_code;
-    std::string content_type;
-};
+// Записи о запросе и ответе помещаются в буфер асинхронного логгера, не выделяя память
+void LogRequest(const net::ip::address& client_ip, std::string_view uri, std::string_view method);
+void LogResponse(const RequestContext& context, unsigned int status_code, std::string_view content_type);
 
 template<class RequestHandler>
 class LoggingRequestHandler {
-    static void LogRequest(std::string_view client_ip, std::string_view uri, std::string_view method) {
-        boost::json::value data = {
-                {"ip",     client_ip},
-                {"URI",    uri},
-                {"method", method}
-        };
-        BOOST_LOG_TRIVIAL(info) << logging::add_value(additional_data, data) << "request received";
-    }
-    static void LogResponse(unsigned int response_time_ms, unsigned int status_code, const std::string& content_type) {
-        boost::json::value data = {
-                {"response_time", response_time_ms},
-                {"code",          status_code},
-                {"content_type",  content_type}
-        };
-        BOOST_LOG_TRIVIAL(info) << boost::log::add_value(additional_data, data)
-                                << "response sent";
-    }
 public:
     explicit LoggingRequestHandler(std::shared_ptr<RequestHandler> decorated)
             : decorated_(decorated) {
     }
-    template <typename Body, typename Allocator, typename Send>
-    void operator()(const tcp::endpoint& endpoint, http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send) {
+    // RequestInfo - сведения соединения: адрес клиента, время приёма соединения и чтения запроса.
+    // send принимает ответ и необязательный обработчик завершения его записи
+    template <typename RequestInfo, typename Body, typename Allocator, typename Send>
+    net::awaitable<void> operator()(RequestInfo info, http::request<Body, http::basic_fields<Allocator>> req, Send send) {
+        // Контекст хранится в кадре сопрограммы: у каждого запроса свой хронометраж
+        RequestContext context;
+        context.accepted_at = info.accepted_at;
+        context.read_started_at = info.read_started_at;
+        context.read_finished_at = info.read_finished_at;
+
         // Получаем URI и метод запроса
         std::string_view uri = req.target();
         std::string_view method = beast::http::to_string(req.method());
-        LogRequest(endpoint.address().to_string(), uri, method);
-
-        // Замер времени начала обработки запроса
-        start_time_ = std::chrono::steady_clock::now();
-
-        // Выполняем обработку запроса через основной обработчик
-        (*decorated_)(std::move(req), std::forward<Send>(send));
-
-        // Замер времени окончания обработки запроса
-        end_time_ = std::chrono::steady_clock::now();
-        response_time_ = std::chrono::duration_cast<std::chrono::milliseconds>(end_time_ - start_time_).count();
-
-        // Получаем информацию для логирования после обработки
-        LogData log_data = (*decorated_).GetLogInfo();
-
-        LogResponse(response_time_, log_data.status_code, log_data.content_type);
+        LogRequest(info.remote_endpoint.address(), uri, method);
+
+        // Запрос отбирается в трассировку заранее: после передачи запроса обработчику его поля недоступны
+        std::shared_ptr<RequestTracer::Trace> trace;
+        if (GetRequestTracer().ShouldSample()) {
+            trace = std::make_shared<RequestTracer::Trace>();
+            trace->method = method;
+            trace->target = uri;
+        }
+
+        // Обработка завершается передачей ответа в send, поэтому здесь и фиксируется время ответа.
+        // Код и тип содержимого берутся из самого ответа, а не из общих полей обработчика
+        auto logging_send = [&context, trace = std::move(trace), send = std::move(send)](auto&& response) {
+            context.responded_at = RequestContext::Clock::now();
+            LogResponse(context, response.result_int(), response[http::field::content_type]);
+            metrics::GetServerMetrics().RecordRequest(context.api_route, response.result_int(),
+                                                      context.GetResponseTime());
+            if (context.api_route) {
+                response.set(std::string_view{"Server-Timing"}, FormatServerTiming(context));
+            }
+            if (!trace) {
+                return send(std::move(response));
+            }
+            // Контекст живёт только до конца обработки, а запись ответа может завершиться позже
+            trace->context = context;
+            trace->status = response.result_int();
+            return send(std::move(response), [trace](beast::error_code ec) {
+                trace->written_at = RequestContext::Clock::now();
+                trace->write_failed = static_cast<bool>(ec);
+                GetRequestTracer().Write(*trace);
+            });
+        };
+        co_await (*decorated_)(std::move(req), std::move(logging_send), context);
     }
 
 private:
     std::shared_ptr<RequestHandler> decorated_;
-    unsigned int response_time_{0};         // Время обработки ответа (мс)
-    std::chrono::steady_clock::time_point start_time_, end_time_; // Время начала и конца обработки
 };
 
-// Форматтер, который выводит логи в JSON-формате
-void MyFormatter(logging::record_view const &rec, logging::formatting_ostream &strm);
-
-// Функция инициализации логирования
+// Функция инициализации логирования. Создаёт логгер, выводящий JSON-записи в std::cout
 void InitLogging();
 
 void LogServerStart(int port, const std::string &address);
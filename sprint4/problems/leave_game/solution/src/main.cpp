@@ -1,11 +1,18 @@
 #include "sdk.h"
 
+#include <boost/asio/co_spawn.hpp>
 #include <boost/asio/signal_set.hpp>
 #include <boost/asio/io_context.hpp>
+#include <boost/asio/use_future.hpp>
 #include <boost/program_options.hpp>
+#include <csignal>
+#include <fstream>
 #include <iostream>
 #include <thread>
 
+#include <pthread.h>
+#include <sched.h>
+
 #include "json_loader.h"
 #include "request_handler.h"
 #include "app.h"
@@ -31,6 +38,46 @@ void RunWorkers(unsigned n, const Fn& fn) {
     fn();
 }
 
+// Привязывает текущий поток к ядру процессора. Ошибка привязки не мешает работе сервера
+void PinThreadToCore(unsigned core) {
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(core % cores, &cpu_set);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+}
+
+// По сигналу SIGUSR1 записывает сохранённые тики в файл в формате Chrome trace_event и ждёт следующего сигнала
+void DumpTickTraceOnSignal(net::signal_set& signals, std::string path) {
+    signals.async_wait([&signals, path = std::move(path)](const sys::error_code& ec,
+                                                          [[maybe_unused]] int signal_number) {
+        if (ec) {
+            return;
+        }
+        std::string trace;
+        metrics::GetTickProfiler().WriteChromeTrace(trace);
+        std::ofstream out{path, std::ios::binary | std::ios::trunc};
+        out << trace;
+        if (!out) {
+            server_logging::LogServerError(0, "failed to write "s + path, "tick trace"s);
+        }
+        DumpTickTraceOnSignal(signals, path);
+    });
+}
+
+// Периодически закрывает соединения с базой данных, простоявшие в пуле дольше idle_timeout.
+// Без этого пул сокращался бы только при возврате соединений, то есть никогда в отсутствие запросов
+void EvictIdleDbConnections(net::steady_timer& timer, postgres::ConnectionPool& pool) {
+    timer.expires_after(pool.GetSettings().idle_timeout / 2);
+    timer.async_wait([&timer, &pool](const sys::error_code& ec) {
+        if (ec) {
+            return;
+        }
+        pool.EvictIdleConnections();
+        EvictIdleDbConnections(timer, pool);
+    });
+}
+
 struct Args {
     int tick_period = 0;
     std::string config_file;
@@ -38,6 +85,16 @@ struct Args {
     std::string state_file;
     int save_state_period = 0;
     bool randomize_spawn_points = false;
+    http_handler::AdmissionSettings admission;
+    http_server::ServerLimits limits;
+    http_server::SocketSettings socket;
+    unsigned io_contexts = 0;
+    http_handler::StaticFileSettings static_files;
+    http_handler::AdminSettings admin;
+    size_t tick_trace_size = 0;
+    std::string tick_trace_file = "tick-trace.json"s;
+    server_logging::RequestTracerSettings request_trace{0.0, "request-trace.json"s};
+    postgres::ConnectionPoolSettings db_pool;
 };
 
 [[nodiscard]] std::optional<Args> ParseCommandLine(int argc, const char* const argv[]) {
@@ -53,7 +110,55 @@ struct Args {
             ("www-root,w", po::value<std::string>(&args.www_root)->value_name("dir"s), "set static files root")
             ("state-file", po::value<std::string>(&args.state_file)->value_name("file"s), "set state file path")
             ("save-state-period", po::value<int>(&args.save_state_period)->value_name("milliseconds"s), "set state period")
-            ("randomize-spawn-points", po::bool_switch(&args.randomize_spawn_points), "spawn dogs at random positions");
+            ("randomize-spawn-points", po::bool_switch(&args.randomize_spawn_points), "spawn dogs at random positions")
+            ("max-api-queue", po::value<size_t>(&args.admission.max_queue_depth)->value_name("requests"s),
+             "set max number of API requests waiting for processing (0 - unlimited)")
+            ("max-api-wait", po::value<int>()->value_name("milliseconds"s),
+             "reject API requests that waited longer (0 - unlimited)")
+            ("retry-after", po::value<int>()->value_name("seconds"s), "set Retry-After for overloaded responses")
+            ("max-connections", po::value<size_t>(&args.limits.max_connections)->value_name("connections"s),
+             "set max number of open connections (0 - unlimited)")
+            ("max-body-size", po::value<uint64_t>(&args.limits.max_body_size)->value_name("bytes"s),
+             "set max request body size")
+            ("pipeline-depth", po::value<size_t>(&args.limits.pipeline_depth)->value_name("requests"s),
+             "set max number of pipelined requests per connection awaiting response")
+            ("io-contexts", po::value<unsigned>(&args.io_contexts)->value_name("count"s),
+             "serve HTTP on count io_contexts pinned to cores, each with its own SO_REUSEPORT acceptor "
+             "(0 - one io_context shared by all threads)")
+            ("tcp-nodelay", po::value<bool>(&args.socket.tcp_nodelay)->value_name("bool"s), "set TCP_NODELAY on connections")
+            ("socket-send-buffer", po::value<int>(&args.socket.send_buffer_size)->value_name("bytes"s),
+             "set SO_SNDBUF of connections")
+            ("socket-receive-buffer", po::value<int>(&args.socket.receive_buffer_size)->value_name("bytes"s),
+             "set SO_RCVBUF of connections")
+            ("io-uring-files", po::bool_switch(&args.static_files.async_reads),
+             "read static files asynchronously via io_uring (requires GAME_SERVER_USE_IO_URING build)")
+            ("static-cache-size", po::value<uint64_t>(&args.static_files.cache.max_total_size)->value_name("bytes"s),
+             "set memory limit of static files loaded at startup (0 - serve all files from disk)")
+            ("watch-static", po::bool_switch(&args.static_files.watch),
+             "rebuild static files index when www-root changes (inotify)")
+            ("sendfile-min-size", po::value<uint64_t>(&args.static_files.sendfile_min_size)->value_name("bytes"s),
+             "send uncached static files of at least this size with sendfile() (0 - only ranges)")
+            ("admin-endpoints", po::bool_switch(&args.admin.enabled), "serve /admin/ endpoints")
+            ("admin-token", po::value<std::string>(&args.admin.token)->value_name("token"s),
+             "require Authorization: Bearer <token> on /admin/ endpoints")
+            ("tick-trace", po::value<size_t>(&args.tick_trace_size)->value_name("ticks"s),
+             "keep phases of the last ticks for /admin/tick-trace and SIGUSR1 (0 - only histograms)")
+            ("tick-trace-file", po::value<std::string>(&args.tick_trace_file)->value_name("file"s),
+             "set file the tick trace is written to on SIGUSR1")
+            ("trace-sample-rate", po::value<double>(&args.request_trace.sample_rate)->value_name("rate"s),
+             "trace this share of requests, from 0 to 1 (0 - tracing is off)")
+            ("trace-file", po::value<std::string>(&args.request_trace.file)->value_name("file"s),
+             "set file sampled request traces are appended to")
+            ("db-pool-min", po::value<size_t>(&args.db_pool.min_size)->value_name("connections"s),
+             "keep at least this many idle database connections once opened")
+            ("db-pool-max", po::value<size_t>(&args.db_pool.max_size)->value_name("connections"s),
+             "set max number of database connections (default - number of CPU cores)")
+            ("db-acquire-timeout", po::value<int>()->value_name("milliseconds"s),
+             "fail a database request that waited longer for a free connection")
+            ("db-idle-timeout", po::value<int>()->value_name("milliseconds"s),
+             "close database connections idle for longer")
+            ("db-query-timeout", po::value<int>()->value_name("milliseconds"s),
+             "abort a database query or connection attempt that takes longer");
 
     po::variables_map vm;
     po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -63,6 +168,39 @@ struct Args {
         std::cout << desc;
         return std::nullopt;
     }
+    if (vm.contains("max-api-wait"s)) {
+        args.admission.max_queue_wait = std::chrono::milliseconds(vm["max-api-wait"s].as<int>());
+    }
+    if (vm.contains("retry-after"s)) {
+        args.admission.retry_after = std::chrono::seconds(vm["retry-after"s].as<int>());
+    }
+    if (!vm.contains("db-pool-max"s)) {
+        args.db_pool.max_size = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (vm.contains("db-acquire-timeout"s)) {
+        args.db_pool.acquire_timeout = std::chrono::milliseconds(vm["db-acquire-timeout"s].as<int>());
+    }
+    if (vm.contains("db-idle-timeout"s)) {
+        args.db_pool.idle_timeout = std::chrono::milliseconds(vm["db-idle-timeout"s].as<int>());
+    }
+    if (vm.contains("db-query-timeout"s)) {
+        args.db_pool.query_timeout = std::chrono::milliseconds(vm["db-query-timeout"s].as<int>());
+        args.db_pool.connect_timeout = args.db_pool.query_timeout;
+    }
+    if (args.db_pool.max_size == 0 || args.db_pool.min_size > args.db_pool.max_size) {
+        throw std::runtime_error("Database pool max size must be positive and not less than min size"s);
+    }
+    if (args.db_pool.acquire_timeout.count() <= 0 || args.db_pool.idle_timeout.count() <= 0
+        || args.db_pool.query_timeout.count() <= 0) {
+        throw std::runtime_error("Database pool timeouts must be positive"s);
+    }
+    // Служебные точки входа доступны на том же адресе, что и игра, поэтому без токена не включаются
+    if (args.admin.enabled && args.admin.token.empty()) {
+        throw std::runtime_error("Admin endpoints require --admin-token"s);
+    }
+    if (args.request_trace.sample_rate < 0.0 || args.request_trace.sample_rate > 1.0) {
+        throw std::runtime_error("Trace sample rate must be between 0 and 1"s);
+    }
     // Проверяем наличие опций config-file  и www-root
     if (!vm.contains("config-file"s)) {
         throw std::runtime_error("Config file path has not been specified"s);
@@ -77,6 +215,8 @@ struct Args {
 }  // namespace
 
 constexpr const char DB_URL_ENV_NAME[]{"GAME_DB_URL"};
+// Сколько при остановке сервера ждать записи ушедших на покой игроков в базу данных
+constexpr std::chrono::milliseconds RETIRED_PLAYERS_FLUSH_TIMEOUT{5'000};
 
 std::string GetDbConfigFromEnv() {
     std::string config;
@@ -106,47 +246,112 @@ int main(int argc, const char* argv[]) {
                 }));
             }
 
-            // 2. Инициализируем io_context
+            // 2. Инициализируем io_context.
+            // В режиме --io-contexts HTTP-соединения обслуживаются отдельными однопоточными io_context,
+            // а ioc выполняет только игровую работу: api_strand, тикер и обработку сигналов
             const unsigned num_threads = std::thread::hardware_concurrency();
-            net::io_context ioc(num_threads);
+            const bool per_core_mode = args->io_contexts > 0;
+            net::io_context ioc(per_core_mode ? 1 : num_threads);
+            std::vector<std::unique_ptr<net::io_context>> server_contexts;
+            for (unsigned i = 0; i < args->io_contexts; ++i) {
+                server_contexts.push_back(std::make_unique<net::io_context>(1));
+            }
 
             // 3. Создаем базу данных для хранения результатов игры и добавляем в Application
-            auto database = std:: make_shared<postgres::Database>(std::make_shared<postgres::ConnectionPool>(num_threads, []() {
-                return std::make_shared<pqxx::connection>(GetDbConfigFromEnv());
-            }));
+            // Соединения открываются по мере надобности и работают в цикле событий ioc.
+            // В каждом соединении пула при открытии готовится запрос записи в таблицу рекордов, поэтому таблица
+            // создаётся раньше, отдельным соединением. Затем таблица загружается в память.
+            // Оба шага выполняются до запуска сервера: пока в ioc нет другой работы,
+            // run() возвращается, как только шаг завершён
+            const std::string db_url = GetDbConfigFromEnv();
+            auto schema_init = net::co_spawn(ioc, postgres::Database::CreateSchema(ioc.get_executor(), db_url,
+                                                                                    args->db_pool.connect_timeout),
+                                             net::use_future);
+            ioc.run();
+            ioc.restart();
+            schema_init.get();
+            auto db_pool = std::make_shared<postgres::ConnectionPool>(
+                    net::make_strand(ioc), args->db_pool,
+                    [executor = ioc.get_executor(), db_url, timeout = args->db_pool.connect_timeout]() {
+                        return postgres::Database::Connect(executor, db_url, timeout);
+                    });
+            auto database = std:: make_shared<postgres::Database>(db_pool);
             app.SetDatabase(database);
+            auto records_load = net::co_spawn(ioc, app.LoadTableOfRecords(), net::use_future);
+            ioc.run();
+            ioc.restart();
+            records_load.get();
+            net::steady_timer db_eviction_timer{ioc};
+            EvictIdleDbConnections(db_eviction_timer, *db_pool);
 
             // 4. Добавляем асинхронный обработчик сигналов SIGINT и SIGTERM
             net::signal_set signals(ioc, SIGINT, SIGTERM);
-            signals.async_wait([&ioc, &args, &listener](const sys::error_code &ec, [[maybe_unused]] int signal_number) {
-                if (!ec) {
+            // Перед остановкой ioc ожидающие записи игроки сохраняются в базу данных
+            signals.async_wait([&ioc, &server_contexts, &args, &listener, &app](const sys::error_code &ec,
+                                                                               [[maybe_unused]] int signal_number) {
+                if (ec) {
+                    return;
+                }
+                net::co_spawn(ioc, app.FlushRetiredPlayers(RETIRED_PLAYERS_FLUSH_TIMEOUT),
+                              [&ioc, &server_contexts, &args, &listener](std::exception_ptr, size_t unsaved) {
+                    if (unsaved != 0) {
+                        metrics::GetServerMetrics().retired_players_lost.Add(unsaved);
+                        server_logging::LogServerError(0, std::to_string(unsaved) + " retired players are not saved"s,
+                                                       "save retired player"s);
+                    }
                     ioc.stop();
+                    for (auto& server_context : server_contexts) {
+                        server_context->stop();
+                    }
                     if (!args->state_file.empty()) {
                         listener->Save();
                     }
                     server_logging::LogServerExit(0, "");
-                }
+                });
             });
 
+            // По SIGUSR1 сохранённые тики записываются в файл
+            metrics::GetTickProfiler().SetTraceCapacity(args->tick_trace_size);
+            net::signal_set trace_signals(ioc, SIGUSR1);
+            DumpTickTraceOnSignal(trace_signals, args->tick_trace_file);
+            server_logging::GetRequestTracer().Configure(args->request_trace);
+
             // 5. создаем strand для выполнения запросов к API
             using Strand = net::strand<net::io_context::executor_type>;
             Strand api_strand = make_strand(ioc);
 
             // 6. Создаем обработчик запросов в куче, управляемый shared_ptr
             std::shared_ptr<http_handler::RequestHandler> handler;
-            handler = std::make_shared<http_handler::RequestHandler>(game, app, fs::path{args->www_root}, api_strand, args->tick_period);
+            handler = std::make_shared<http_handler::RequestHandler>(game, app, fs::path{args->www_root}, api_strand,
+                                                                     args->tick_period, http_handler::ApiCompressionSettings{},
+                                                                     args->admission, args->static_files, args->admin);
             server_logging::LoggingRequestHandler logging_handler{handler};
 
-            // 7. Запускаем обработчик HTTP-запросов, делегируя их обработчику запросов
+            // 7. Запускаем обработчик HTTP-запросов, делегируя их обработчику запросов.
+            // sendfile() не поддерживает флаг MSG_NOSIGNAL, поэтому SIGPIPE игнорируется:
+            // запись в соединение, закрытое клиентом, не должна завершать процесс
+            std::signal(SIGPIPE, SIG_IGN);
             const auto address = net::ip::make_address("0.0.0.0");
             constexpr net::ip::port_type port = 8080;
+            auto serve_request = [&logging_handler](auto &&info, auto &&req, auto &&send) {
+                return logging_handler(std::forward<decltype(info)>(info),
+                                       std::forward<decltype(req)>(req),
+                                       std::forward<decltype(send)>(send));
+            };
 
-            http_server::ServeHttp(ioc, {address, port},
-                                   [&logging_handler](auto &&endpoint, auto &&req, auto &&send) {
-                                       logging_handler(std::forward<decltype(endpoint)>(endpoint),
-                                                       std::forward<decltype(req)>(req),
-                                                       std::forward<decltype(send)>(send));
-                                   });
+            if (per_core_mode) {
+                // Каждый io_context принимает соединения своим acceptor'ом на общем порту.
+                // Предел соединений общий для всех acceptor'ов
+                auto socket_settings = args->socket;
+                socket_settings.reuse_port = true;
+                auto connections = std::make_shared<http_server::ConnectionCounter>(args->limits.max_connections);
+                for (auto& server_context : server_contexts) {
+                    http_server::ServeHttp(*server_context, {address, port}, serve_request, args->limits,
+                                           socket_settings, connections);
+                }
+            } else {
+                http_server::ServeHttp(ioc, {address, port}, serve_request, args->limits, args->socket);
+            }
 
             // 8. Логгируем старт сервера
             server_logging::LogServerStart(port, address.to_string());
@@ -164,9 +369,27 @@ int main(int argc, const char* argv[]) {
             }
 
             // 10. Запускаем обработку асинхронных операций
-            RunWorkers(std::max(1u, num_threads), [&ioc] {
+            if (per_core_mode) {
+                // Поток каждого io_context закреплён за своим ядром, игровой поток занимает следующее ядро
+                std::vector<std::jthread> workers;
+                workers.reserve(server_contexts.size());
+                for (unsigned i = 0; i < server_contexts.size(); ++i) {
+                    workers.emplace_back([&server_context = *server_contexts[i], i] {
+                        PinThreadToCore(i);
+                        const metrics::CpuProfiler::ThreadScope profiled_thread{metrics::GetCpuProfiler()};
+                        server_context.run();
+                    });
+                }
+                PinThreadToCore(args->io_contexts);
+                const metrics::CpuProfiler::ThreadScope profiled_thread{metrics::GetCpuProfiler()};
                 ioc.run();
-            });
+            } else {
+                // Потоки io_context доступны профилировщику /admin/profile
+                RunWorkers(std::max(1u, num_threads), [&ioc] {
+                    const metrics::CpuProfiler::ThreadScope profiled_thread{metrics::GetCpuProfiler()};
+                    ioc.run();
+                });
+            }
         }
         return EXIT_SUCCESS;
     } catch (const std::exception& ex) {
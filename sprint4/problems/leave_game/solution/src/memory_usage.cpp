@@ -0,0 +1,75 @@
+#include "memory_usage.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+#include <malloc.h>
+
+namespace memory_usage {
+
+size_t EstimateHeap(const std::string& str) noexcept {
+    // Короткие строки хранятся внутри объекта строки
+    static const size_t inline_capacity = std::string{}.capacity();
+    return str.capacity() > inline_capacity ? str.capacity() + 1 : 0;
+}
+
+size_t EstimateHeap(const json::value& value) noexcept {
+    switch (value.kind()) {
+        case json::kind::string:
+            return value.get_string().capacity();
+        case json::kind::array:
+            return EstimateHeap(value.get_array());
+        case json::kind::object:
+            return EstimateHeap(value.get_object());
+        default:
+            return 0;
+    }
+}
+
+size_t EstimateHeap(const json::array& array) noexcept {
+    size_t size = array.capacity() * sizeof(json::value);
+    for (const auto& item : array) {
+        size += EstimateHeap(item);
+    }
+    return size;
+}
+
+size_t EstimateHeap(const json::object& object) noexcept {
+    size_t size = object.capacity() * sizeof(json::key_value_pair);
+    for (const auto& item : object) {
+        size += item.key().size() + EstimateHeap(item.value());
+    }
+    return size;
+}
+
+AllocatorStats GetAllocatorStats() noexcept {
+#if __GLIBC_PREREQ(2, 33)
+    const struct mallinfo2 info = mallinfo2();
+    return {info.arena, info.hblkhd, info.uordblks, info.fordblks, info.keepcost};
+#else
+    // До glibc 2.33 есть только mallinfo с полями int. Значения больше 2 ГиБ переполняют поле,
+    // поэтому оно читается как беззнаковое: так статистика верна до 4 ГиБ
+    const struct mallinfo info = mallinfo();
+    const auto to_size = [](int value) {
+        return static_cast<size_t>(static_cast<unsigned int>(value));
+    };
+    return {to_size(info.arena), to_size(info.hblkhd), to_size(info.uordblks), to_size(info.fordblks),
+            to_size(info.keepcost)};
+#endif
+}
+
+std::string GetMallocInfo() {
+    char* buffer = nullptr;
+    size_t size = 0;
+    FILE* stream = open_memstream(&buffer, &size);
+    if (!stream) {
+        return {};
+    }
+    malloc_info(0, stream);
+    std::fclose(stream);
+    const std::unique_ptr<char, decltype(&std::free)> holder{buffer, &std::free};
+    return {buffer, size};
+}
+
+}  // namespace memory_usage
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <boost/json.hpp>
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace memory_usage {
+
+namespace json = boost::json;
+
+// Оценки памяти, которую контейнер занимает в куче сверх собственного sizeof.
+// Считаются по ёмкости контейнеров и размерам узлов libstdc++, служебные данные аллокатора не учитываются.
+// Память, на которую ссылаются элементы, оценивается отдельно
+
+// Узел красно-чёрного дерева std::map: цвет и три указателя
+constexpr size_t MAP_NODE_OVERHEAD = 4 * sizeof(void*);
+// Узел std::unordered_map: указатель на следующий узел и сохранённый хеш
+constexpr size_t HASH_NODE_OVERHEAD = sizeof(void*) + sizeof(size_t);
+// Блок управления std::make_shared: указатель на таблицу виртуальных функций и два счётчика
+constexpr size_t SHARED_CONTROL_BLOCK_SIZE = sizeof(void*) + 2 * sizeof(int);
+
+size_t EstimateHeap(const std::string& str) noexcept;
+size_t EstimateHeap(const json::value& value) noexcept;
+size_t EstimateHeap(const json::array& array) noexcept;
+size_t EstimateHeap(const json::object& object) noexcept;
+
+template <typename T, typename Allocator>
+size_t EstimateHeap(const std::vector<T, Allocator>& vector) noexcept {
+    return vector.capacity() * sizeof(T);
+}
+
+template <typename Key, typename Value, typename Compare, typename Allocator>
+size_t EstimateHeap(const std::map<Key, Value, Compare, Allocator>& map) noexcept {
+    return map.size() * (MAP_NODE_OVERHEAD + sizeof(std::pair<const Key, Value>));
+}
+
+template <typename Key, typename Value, typename Hash, typename Equal, typename Allocator>
+size_t EstimateHeap(const std::unordered_map<Key, Value, Hash, Equal, Allocator>& map) noexcept {
+    return map.bucket_count() * sizeof(void*) + map.size() * (HASH_NODE_OVERHEAD + sizeof(std::pair<const Key, Value>));
+}
+
+// Объект, созданный через std::make_shared
+template <typename T>
+constexpr size_t EstimateSharedObject() noexcept {
+    return SHARED_CONTROL_BLOCK_SIZE + sizeof(T);
+}
+
+// Память карты по составляющим
+struct MapMemoryUsage {
+    size_t roads = 0;
+    size_t buildings = 0;
+    size_t offices = 0;
+    // Сетка ячеек для поиска дорог по позиции
+    size_t cells = 0;
+    // Описание типов предметов в JSON
+    size_t extra_data = 0;
+    // Идентификатор, название, индекс офисов и ценности предметов
+    size_t other = 0;
+
+    [[nodiscard]] size_t Total() const noexcept {
+        return roads + buildings + offices + cells + extra_data + other;
+    }
+};
+
+// Память игровой сессии: собаки вместе с сумками и предметы на карте
+struct SessionMemoryUsage {
+    size_t dog_count = 0;
+    size_t loot_count = 0;
+    size_t dogs = 0;
+    size_t loots = 0;
+
+    [[nodiscard]] size_t Total() const noexcept {
+        return dogs + loots;
+    }
+};
+
+// Статистика распределителя памяти glibc (mallinfo2, до glibc 2.33 - mallinfo)
+struct AllocatorStats {
+    // Память, полученная от системы через brk/sbrk и через mmap
+    size_t heap_size = 0;
+    size_t mmapped = 0;
+    // Занятая и свободная память внутри кучи
+    size_t in_use = 0;
+    size_t free = 0;
+    // Свободная память на вершине кучи, которую malloc_trim может вернуть системе
+    size_t releasable = 0;
+};
+
+AllocatorStats GetAllocatorStats() noexcept;
+// Подробная статистика арен распределителя в формате XML (malloc_info)
+std::string GetMallocInfo();
+
+}  // namespace memory_usage
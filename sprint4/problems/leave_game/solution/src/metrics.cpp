@@ -0,0 +1,216 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+
+namespace metrics {
+using namespace std::literals;
+
+namespace {
+
+// Границы корзин в выводе: 2^k мкс. Более мелкие корзины гистограммы объединяются
+constexpr unsigned MIN_EXPORTED_EXPONENT = 4;
+
+}  // namespace
+
+size_t GetShardIndex() noexcept {
+    static std::atomic<size_t> next_index{0};
+    thread_local const size_t index = next_index.fetch_add(1, std::memory_order_relaxed) % SHARD_COUNT;
+    return index;
+}
+
+uint64_t Counter::Get() const noexcept {
+    uint64_t total = 0;
+    for (const auto& shard : shards_) {
+        total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+size_t Histogram::GetBucketIndex(uint64_t value) noexcept {
+    if (value < SUB_BUCKET_COUNT) {
+        return static_cast<size_t>(value);
+    }
+    const unsigned exponent = std::bit_width(value) - 1;
+    if (exponent >= MAX_EXPONENT) {
+        return BUCKET_COUNT - 1;
+    }
+    // Старшие SUB_BUCKET_BITS + 1 бит значения: единица и номер корзины внутри интервала
+    const auto mantissa = static_cast<size_t>(value >> (exponent - SUB_BUCKET_BITS));
+    return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT + mantissa - SUB_BUCKET_COUNT;
+}
+
+uint64_t Histogram::GetBucketLowerBound(size_t index) noexcept {
+    if (index < SUB_BUCKET_COUNT) {
+        return index;
+    }
+    const auto exponent = static_cast<unsigned>(index / SUB_BUCKET_COUNT + SUB_BUCKET_BITS - 1);
+    const uint64_t mantissa = SUB_BUCKET_COUNT + index % SUB_BUCKET_COUNT;
+    return mantissa << (exponent - SUB_BUCKET_BITS);
+}
+
+Histogram::Snapshot Histogram::Collect() const noexcept {
+    Snapshot snapshot;
+    for (const auto& shard : shards_) {
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+            snapshot.buckets[i] += shard.buckets[i].load(std::memory_order_relaxed);
+        }
+        snapshot.sum += shard.sum.load(std::memory_order_relaxed);
+    }
+    for (const uint64_t bucket : snapshot.buckets) {
+        snapshot.count += bucket;
+    }
+    return snapshot;
+}
+
+void TextWriter::WriteHeader(std::string_view name, std::string_view type, std::string_view help) {
+    out_.append("# HELP "sv).append(name).append(" "sv).append(help).append("\n"sv);
+    out_.append("# TYPE "sv).append(name).append(" "sv).append(type).append("\n"sv);
+}
+
+void TextWriter::WriteValue(std::string_view name, std::string_view labels, uint64_t value) {
+    WriteName(name, labels);
+    out_.append(std::to_string(value)).append("\n"sv);
+}
+
+void TextWriter::WriteValue(std::string_view name, std::string_view labels, int64_t value) {
+    WriteName(name, labels);
+    out_.append(std::to_string(value)).append("\n"sv);
+}
+
+void TextWriter::WriteHistogram(std::string_view name, std::string_view labels, const Histogram& histogram) {
+    const auto snapshot = histogram.Collect();
+    if (snapshot.count == 0) {
+        return;
+    }
+    const std::string bucket_name = std::string{name} + "_bucket"s;
+    uint64_t cumulative = 0;
+    size_t index = 0;
+    for (unsigned exponent = MIN_EXPORTED_EXPONENT; exponent <= Histogram::MAX_EXPONENT; ++exponent) {
+        // Корзины со значениями меньше 2^exponent мкс
+        const uint64_t bound = uint64_t{1} << exponent;
+        for (; index < Histogram::BUCKET_COUNT - 1 && Histogram::GetBucketLowerBound(index) < bound; ++index) {
+            cumulative += snapshot.buckets[index];
+        }
+        WriteBucket(bucket_name, labels, FormatNumber(static_cast<double>(bound) / 1e6), cumulative);
+        // Старшие корзины ничего не добавят к сумме
+        if (cumulative == snapshot.count) {
+            break;
+        }
+    }
+    WriteBucket(bucket_name, labels, "+Inf"sv, snapshot.count);
+
+    WriteName(std::string{name} + "_sum"s, labels);
+    out_.append(FormatNumber(static_cast<double>(snapshot.sum) / 1e6)).append("\n"sv);
+    WriteName(std::string{name} + "_count"s, labels);
+    out_.append(std::to_string(snapshot.count)).append("\n"sv);
+}
+
+void TextWriter::WriteName(std::string_view name, std::string_view labels) {
+    out_.append(name);
+    if (!labels.empty()) {
+        out_.append("{"sv).append(labels).append("}"sv);
+    }
+    out_.append(" "sv);
+}
+
+void TextWriter::WriteBucket(std::string_view name, std::string_view labels, std::string_view le, uint64_t count) {
+    out_.append(name).append("{"sv);
+    if (!labels.empty()) {
+        out_.append(labels).append(","sv);
+    }
+    out_.append("le=\""sv).append(le).append("\"} "sv).append(std::to_string(count)).append("\n"sv);
+}
+
+std::string TextWriter::FormatNumber(double value) {
+    char buffer[32];
+    const auto [ptr, ec] = std::to_chars(std::begin(buffer), std::end(buffer), value);
+    return {buffer, ec == std::errc{} ? ptr : buffer};
+}
+
+void ServerMetrics::RecordRequest(std::optional<http_handler::ApiRoute> route, unsigned status,
+                                  std::chrono::steady_clock::duration duration) noexcept {
+    const size_t route_index = route ? static_cast<size_t>(*route) : ROUTE_COUNT - 1;
+    const size_t status_class = std::clamp<unsigned>(status / 100, 1, STATUS_CLASS_COUNT) - 1;
+    requests_[route_index][status_class].Record(duration);
+}
+
+std::string_view ServerMetrics::GetRouteLabel(size_t route) noexcept {
+    // Метки перечислены в порядке ApiRoute, последняя - для запросов вне API
+    static constexpr std::array<std::string_view, ROUTE_COUNT> labels{
+            "maps"sv, "map"sv, "records"sv, "join"sv, "players"sv, "state"sv, "action"sv, "tick"sv, "unknown"sv,
+            "static"sv};
+    return labels[route];
+}
+
+void ServerMetrics::Write(std::string& out) const {
+    TextWriter writer{out};
+
+    constexpr auto request_duration = "game_server_http_request_duration_seconds"sv;
+    writer.WriteHeader(request_duration, "histogram"sv,
+                       "Time from reading a request to passing its response to the connection"sv);
+    std::string labels;
+    for (size_t route = 0; route < ROUTE_COUNT; ++route) {
+        for (size_t status_class = 0; status_class < STATUS_CLASS_COUNT; ++status_class) {
+            labels.assign("route=\""sv).append(GetRouteLabel(route)).append("\",status=\""sv);
+            labels.append(std::to_string(status_class + 1)).append("xx\""sv);
+            writer.WriteHistogram(request_duration, labels, requests_[route][status_class]);
+        }
+    }
+
+    writer.WriteHeader("game_server_tick_duration_seconds"sv, "histogram"sv, "Game tick processing time"sv);
+    writer.WriteHistogram("game_server_tick_duration_seconds"sv, {}, tick_duration);
+    writer.WriteHeader("game_server_tick_lag_seconds"sv, "histogram"sv, "Delay of tick start after the tick period"sv);
+    writer.WriteHistogram("game_server_tick_lag_seconds"sv, {}, tick_lag);
+
+    writer.WriteHeader("game_server_game_sessions"sv, "gauge"sv, "Number of game sessions"sv);
+    writer.WriteValue("game_server_game_sessions"sv, {}, game_sessions.Get());
+    writer.WriteHeader("game_server_dogs"sv, "gauge"sv, "Number of dogs in all sessions"sv);
+    writer.WriteValue("game_server_dogs"sv, {}, dogs.Get());
+    writer.WriteHeader("game_server_loot_items"sv, "gauge"sv, "Number of lost items on maps"sv);
+    writer.WriteValue("game_server_loot_items"sv, {}, loot_items.Get());
+
+    writer.WriteHeader("game_server_db_pool_wait_seconds"sv, "histogram"sv, "Time waiting for a database connection"sv);
+    writer.WriteHistogram("game_server_db_pool_wait_seconds"sv, {}, db_pool_wait);
+    writer.WriteHeader("game_server_db_connections_in_use"sv, "gauge"sv, "Database connections taken from the pool"sv);
+    writer.WriteValue("game_server_db_connections_in_use"sv, {}, db_connections_in_use.Get());
+    writer.WriteHeader("game_server_db_connections_open"sv, "gauge"sv, "Open database connections"sv);
+    writer.WriteValue("game_server_db_connections_open"sv, {}, db_connections_open.Get());
+    writer.WriteHeader("game_server_db_connections_created_total"sv, "counter"sv, "Database connections opened"sv);
+    writer.WriteValue("game_server_db_connections_created_total"sv, {}, db_connections_created.Get());
+    writer.WriteHeader("game_server_db_connections_broken_total"sv, "counter"sv,
+                       "Broken database connections dropped from the pool"sv);
+    writer.WriteValue("game_server_db_connections_broken_total"sv, {}, db_connections_broken.Get());
+    writer.WriteHeader("game_server_db_connections_evicted_total"sv, "counter"sv,
+                       "Idle database connections closed by the pool"sv);
+    writer.WriteValue("game_server_db_connections_evicted_total"sv, {}, db_connections_evicted.Get());
+    writer.WriteHeader("game_server_db_pool_timeouts_total"sv, "counter"sv,
+                       "Requests for a database connection that timed out"sv);
+    writer.WriteValue("game_server_db_pool_timeouts_total"sv, {}, db_pool_timeouts.Get());
+
+    writer.WriteHeader("game_server_retired_players_total"sv, "counter"sv, "Players saved to the records table"sv);
+    writer.WriteValue("game_server_retired_players_total"sv, {}, retired_players.Get());
+    writer.WriteHeader("game_server_retired_player_save_duration_seconds"sv, "histogram"sv,
+                       "Time to save a retired player to the records table"sv);
+    writer.WriteHistogram("game_server_retired_player_save_duration_seconds"sv, {}, retired_player_save_duration);
+    writer.WriteHeader("game_server_retired_player_save_failures_total"sv, "counter"sv,
+                       "Failed attempts to save a retired player, each retried later"sv);
+    writer.WriteValue("game_server_retired_player_save_failures_total"sv, {}, retired_player_save_failures.Get());
+    writer.WriteHeader("game_server_retired_players_lost_total"sv, "counter"sv,
+                       "Retired players never saved: the write queue was full or the server stopped"sv);
+    writer.WriteValue("game_server_retired_players_lost_total"sv, {}, retired_players_lost.Get());
+    writer.WriteHeader("game_server_retired_players_queue_depth"sv, "gauge"sv,
+                       "Retired players waiting to be saved to the records table"sv);
+    writer.WriteValue("game_server_retired_players_queue_depth"sv, {}, retired_players_queue_depth.Get());
+
+    writer.WriteHeader("game_server_state_save_duration_seconds"sv, "histogram"sv, "Time to save the game state file"sv);
+    writer.WriteHistogram("game_server_state_save_duration_seconds"sv, {}, state_save_duration);
+}
+
+ServerMetrics& GetServerMetrics() {
+    static ServerMetrics metrics;
+    return metrics;
+}
+
+}  // namespace metrics
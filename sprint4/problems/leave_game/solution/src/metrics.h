@@ -0,0 +1,172 @@
+#pragma once
+
+#include "api_router.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace metrics {
+
+// Число ячеек у счётчиков и гистограмм. Каждый поток пишет в свою ячейку, поэтому потоки
+// не конкурируют за одну кэш-линию. Потоков больше, чем ячеек, - ячейки делятся, оставаясь атомарными
+constexpr size_t SHARD_COUNT = 16;
+
+// Номер ячейки текущего потока. Назначается при первом обращении по кругу
+size_t GetShardIndex() noexcept;
+
+// Монотонно растущий счётчик
+class Counter {
+public:
+    void Add(uint64_t value = 1) noexcept {
+        shards_[GetShardIndex()].value.fetch_add(value, std::memory_order_relaxed);
+    }
+    [[nodiscard]] uint64_t Get() const noexcept;
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> value{0};
+    };
+    std::array<Shard, SHARD_COUNT> shards_;
+};
+
+// Текущее значение величины, например число сессий
+class Gauge {
+public:
+    void Set(int64_t value) noexcept {
+        value_.store(value, std::memory_order_relaxed);
+    }
+    void Add(int64_t delta) noexcept {
+        value_.fetch_add(delta, std::memory_order_relaxed);
+    }
+    [[nodiscard]] int64_t Get() const noexcept {
+        return value_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<int64_t> value_{0};
+};
+
+// Гистограмма длительностей с логарифмически-линейными корзинами, как в HdrHistogram:
+// каждый интервал [2^k, 2^(k+1)) мкс делится на SUB_BUCKET_COUNT равных корзин,
+// поэтому относительная погрешность не превышает 25% во всём диапазоне от 1 мкс до 71 минуты
+class Histogram {
+public:
+    static constexpr unsigned SUB_BUCKET_BITS = 2;
+    static constexpr size_t SUB_BUCKET_COUNT = size_t{1} << SUB_BUCKET_BITS;
+    // Значения от 2^MAX_EXPONENT мкс попадают в последнюю корзину
+    static constexpr unsigned MAX_EXPONENT = 32;
+    static constexpr size_t BUCKET_COUNT = SUB_BUCKET_COUNT * (MAX_EXPONENT - SUB_BUCKET_BITS + 1);
+
+    struct Snapshot {
+        std::array<uint64_t, BUCKET_COUNT> buckets{};
+        uint64_t count = 0;
+        // Сумма значений в микросекундах
+        uint64_t sum = 0;
+    };
+
+    void Record(std::chrono::steady_clock::duration value) noexcept {
+        const auto us = std::chrono::duration_cast<std::chrono::microseconds>(value).count();
+        RecordMicroseconds(us > 0 ? static_cast<uint64_t>(us) : 0);
+    }
+    void RecordMicroseconds(uint64_t value) noexcept {
+        auto& shard = shards_[GetShardIndex()];
+        shard.buckets[GetBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+        shard.sum.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    // Суммирует ячейки всех потоков. Число значений считается по корзинам, поэтому всегда
+    // совпадает с их суммой, даже если значения записываются одновременно со сбором
+    [[nodiscard]] Snapshot Collect() const noexcept;
+
+    static size_t GetBucketIndex(uint64_t value) noexcept;
+    // Наименьшее значение, попадающее в корзину
+    static uint64_t GetBucketLowerBound(size_t index) noexcept;
+
+private:
+    struct alignas(64) Shard {
+        std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets{};
+        std::atomic<uint64_t> sum{0};
+    };
+    std::array<Shard, SHARD_COUNT> shards_;
+};
+
+// Формирует текст в формате Prometheus (text exposition format 0.0.4)
+class TextWriter {
+public:
+    explicit TextWriter(std::string& out)
+            : out_(out) {
+    }
+
+    // Выводит строки # HELP и # TYPE. Вызывается один раз перед значениями метрики
+    void WriteHeader(std::string_view name, std::string_view type, std::string_view help);
+    // labels - готовый список меток без фигурных скобок, например route="maps",status="2xx"
+    void WriteValue(std::string_view name, std::string_view labels, uint64_t value);
+    void WriteValue(std::string_view name, std::string_view labels, int64_t value);
+    // Выводит корзины с границами 2^k мкс в секундах, _sum и _count. Пустые гистограммы пропускаются
+    void WriteHistogram(std::string_view name, std::string_view labels, const Histogram& histogram);
+
+private:
+    void WriteName(std::string_view name, std::string_view labels);
+    void WriteBucket(std::string_view name, std::string_view labels, std::string_view le, uint64_t count);
+    static std::string FormatNumber(double value);
+
+    std::string& out_;
+};
+
+// Метрики сервера. Запись выполняется без блокировок и выделения памяти,
+// текст формируется только при запросе /metrics
+class ServerMetrics {
+public:
+    // Запросы к API группируются по точкам входа, остальные запросы - в группу static.
+    // Коды ответов группируются по классам 1xx-5xx
+    static constexpr size_t ROUTE_COUNT = http_handler::API_ROUTES.size() + 1;
+    static constexpr size_t STATUS_CLASS_COUNT = 5;
+
+    void RecordRequest(std::optional<http_handler::ApiRoute> route, unsigned status,
+                       std::chrono::steady_clock::duration duration) noexcept;
+
+    // Длительность выполнения тика и опоздание его начала относительно заданного периода
+    Histogram tick_duration;
+    Histogram tick_lag;
+    // Состояние игры, обновляется внутри api_strand после тиков и входа игроков
+    Gauge game_sessions;
+    Gauge dogs;
+    Gauge loot_items;
+    // Пул соединений с базой данных: ожидание соединения, число открытых и выданных соединений,
+    // открытые, оборванные и закрытые после простоя соединения, истёкшие ожидания
+    Histogram db_pool_wait;
+    Gauge db_connections_open;
+    Gauge db_connections_in_use;
+    Counter db_connections_created;
+    Counter db_connections_broken;
+    Counter db_connections_evicted;
+    Counter db_pool_timeouts;
+    // Сохранение ушедших на покой игроков в таблицу рекордов: сохранённые игроки, неудачные попытки записи
+    // и игроки, которые не будут сохранены: не поместились в очередь записи или остались в ней при остановке.
+    // Длина очереди записи обновляется при каждом её изменении
+    Counter retired_players;
+    Histogram retired_player_save_duration;
+    Counter retired_player_save_failures;
+    Counter retired_players_lost;
+    Gauge retired_players_queue_depth;
+    // Сохранение снимка игрового состояния в файл
+    Histogram state_save_duration;
+
+    void Write(std::string& out) const;
+
+private:
+    static std::string_view GetRouteLabel(size_t route) noexcept;
+
+    std::array<std::array<Histogram, STATUS_CLASS_COUNT>, ROUTE_COUNT> requests_;
+};
+
+// Метрики процесса. Создаются при первом обращении
+ServerMetrics& GetServerMetrics();
+
+}  // namespace metrics
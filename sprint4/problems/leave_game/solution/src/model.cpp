@@ -1,8 +1,10 @@
 #include "model.h"
 
+#include <atomic>
 #include <stdexcept>
 
 #include "infrastructure.h"
+#include "tick_profiler.h"
 
 using namespace std::literals;
 
@@ -65,6 +67,12 @@ std::vector<Dog::LootPtr> Dog::GetLootsInBag() const {
     return loots_in_bag_;
 }
 
+size_t Dog::EstimateHeapUsage() const noexcept {
+    // Подобранный предмет удаляется из сессии, поэтому принадлежит только сумке
+    return memory_usage::EstimateHeap(dog_name_) + memory_usage::EstimateHeap(loots_in_bag_)
+           + loots_in_bag_.size() * memory_usage::EstimateSharedObject<Loot>();
+}
+
 void Dog::ClearLootsFromBag() {
     loots_in_bag_.clear();
 }
@@ -253,6 +261,28 @@ int CustomRound(double num) {
     }
 }
 
+memory_usage::MapMemoryUsage Map::EstimateMemoryUsage() const noexcept {
+    using memory_usage::EstimateHeap;
+    memory_usage::MapMemoryUsage usage;
+    usage.roads = EstimateHeap(roads_);
+    usage.buildings = EstimateHeap(buildings_);
+    usage.offices = EstimateHeap(offices_);
+    for (const auto& office : offices_) {
+        usage.offices += EstimateHeap(*office.GetId());
+    }
+    usage.cells = EstimateHeap(cells_);
+    for (const auto& [cell, roads] : cells_) {
+        usage.cells += EstimateHeap(roads);
+    }
+    usage.extra_data = EstimateHeap(extra_data_.GetLootTypes());
+    usage.other = EstimateHeap(*id_) + EstimateHeap(name_) + EstimateHeap(warehouse_id_to_index_)
+                  + EstimateHeap(loot_values_);
+    for (const auto& [office_id, index] : warehouse_id_to_index_) {
+        usage.other += EstimateHeap(*office_id);
+    }
+    return usage;
+}
+
 std::pair<int, int> Map::GetCellIndex(const app::DogPosition &pos) {
     int cell_x = CustomRound(pos.x);
     int cell_y = CustomRound(pos.y);
@@ -464,19 +494,39 @@ void DetectCollisions(const std::shared_ptr<GameSession> &session_prt, const app
 }
 
 void Game::Tick(const std::chrono::milliseconds time_delta_ms) {
+    using metrics::TickPhase;
+    using PhaseTimer = metrics::TickProfiler::PhaseTimer;
     const auto time_delta = time_delta_ms.count();
+    auto& profiler = metrics::GetTickProfiler();
+    const metrics::TickProfiler::TickTimer tick_timer{profiler};
     app::ItemGathererProvider provider;
     for (const auto& session : sessions_) {
-        // Перемещение собак, добавление в провайдер для расчета столкновений, обработка времени простоя собаки
-        ActDogsOnTick(session, provider, time_delta);
-        // Добавление трофеев в провайдер для расчета столкновений
-        AddLootsToGathererProvider(*session, provider);
-        // Добавление баз в провайдер для расчета столкновений
-        AddOfficesToGathererProvider(*session, provider);
-        // Расчет столкновений и действия, связанные с этим
-        DetectCollisions(session, provider);
-        // Добавление случайных трофеев на дороги
-        session->AddLoots(loot_generator_ptr_->Generate(time_delta_ms, session->GetLootsCount(), session->GetDogsCount()));
+        // Этапы замеряются отдельно для каждой сессии
+        const std::string_view session_name = *session->GetMap()->GetId();
+        // Собаки перемещаются на каждом тике, поэтому состояние сессии меняется всегда
+        session->MarkStateChanged();
+        {
+            // Перемещение собак, добавление в провайдер для расчета столкновений, обработка времени простоя собаки
+            const PhaseTimer timer{profiler, TickPhase::MOVE_DOGS, session_name};
+            ActDogsOnTick(session, provider, time_delta);
+        }
+        {
+            const PhaseTimer timer{profiler, TickPhase::FILL_GATHERER_PROVIDER, session_name};
+            // Добавление трофеев в провайдер для расчета столкновений
+            AddLootsToGathererProvider(*session, provider);
+            // Добавление баз в провайдер для расчета столкновений
+            AddOfficesToGathererProvider(*session, provider);
+        }
+        {
+            // Расчет столкновений и действия, связанные с этим
+            const PhaseTimer timer{profiler, TickPhase::DETECT_COLLISIONS, session_name};
+            DetectCollisions(session, provider);
+        }
+        {
+            // Добавление случайных трофеев на дороги
+            const PhaseTimer timer{profiler, TickPhase::GENERATE_LOOT, session_name};
+            session->AddLoots(loot_generator_ptr_->Generate(time_delta_ms, session->GetLootsCount(), session->GetDogsCount()));
+        }
         /*if (session->GetLootsCount() == 0) {
             session->AddLoot(std::make_shared<app::Loot>(app::Loot({session->GetLootNextId(), 0, {1, 0}})));
         }*/
@@ -566,13 +616,32 @@ Offset Office::GetOffset() const noexcept {
     return offset_;
 }
 
+namespace {
+
+uint64_t NextStateVersion() noexcept {
+    static std::atomic<uint64_t> last_version{0};
+    return last_version.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+}  // namespace
+
 GameSession::GameSession(const Map *map)
-    : map_(map) {}
+    : map_(map)
+    , state_version_(NextStateVersion()) {}
+
+uint64_t GameSession::GetStateVersion() const noexcept {
+    return state_version_;
+}
+
+void GameSession::MarkStateChanged() noexcept {
+    state_version_ = NextStateVersion();
+}
 
 std::shared_ptr<app::Dog> GameSession::AddDog(const std::string &player_name) {
     dogs_[next_dog_id_] = std::make_shared<app::Dog>(player_name, next_dog_id_);
     auto dog_ptr = dogs_[next_dog_id_];
     next_dog_id_++;
+    MarkStateChanged();
     // Устанавливаем начальную позицию на первой дороге карты
     if (!map_->GetRoads().empty()) {
         const Road& first_road = map_->GetRoads().front();
@@ -587,9 +656,14 @@ void GameSession::AddDog(const std::shared_ptr<app::Dog> &dog_ptr) noexcept {
     if (next_dog_id_ <= dog_ptr->GetId()) {
         next_dog_id_ = dog_ptr->GetId() + 1;
     }
+    MarkStateChanged();
 }
 
 void GameSession::AddLoots(const size_t loots_count) noexcept {
+    if (loots_count == 0) {
+        return;
+    }
+    MarkStateChanged();
     for (unsigned i = 0; i < loots_count; ++i) {
         const unsigned random_road_index = loot_gen::GenerateRandomUnsigned(0, map_->GetRoads().size() - 1);
         auto road = map_->GetRoads()[random_road_index];
@@ -621,6 +695,7 @@ void GameSession::AddLoot(std::shared_ptr<app::Loot> loot_ptr) noexcept {
         next_loot_id_ = loot_ptr->GetLootId() + 1;
     }
     loots_[loot_ptr->GetLootId()] = std::move(loot_ptr);
+    MarkStateChanged();
 }
 
 size_t GameSession::GetDogsCount() const noexcept {
@@ -661,6 +736,7 @@ void GameSession::DeleteDog(std::map<unsigned, std::shared_ptr<app::Dog>>::const
         throw std::runtime_error("Dog not found"s);
     }
     dog_it = dogs_.erase(dog_it);
+    MarkStateChanged();
 }
 
 void GameSession::DeleteLoot(const std::shared_ptr<app::Loot> &loot_ptr) {
@@ -672,6 +748,20 @@ void GameSession::DeleteLoot(const std::shared_ptr<app::Loot> &loot_ptr) {
         throw std::runtime_error("Loot not found"s);
     }
     loots_.erase(id);
+    MarkStateChanged();
+}
+
+memory_usage::SessionMemoryUsage GameSession::EstimateMemoryUsage() const noexcept {
+    using memory_usage::EstimateHeap;
+    memory_usage::SessionMemoryUsage usage;
+    usage.dog_count = dogs_.size();
+    usage.loot_count = loots_.size();
+    usage.dogs = EstimateHeap(dogs_) + dogs_.size() * memory_usage::EstimateSharedObject<app::Dog>();
+    for (const auto& [id, dog] : dogs_) {
+        usage.dogs += dog->EstimateHeapUsage();
+    }
+    usage.loots = EstimateHeap(loots_) + loots_.size() * memory_usage::EstimateSharedObject<app::Loot>();
+    return usage;
 }
 
 std::shared_ptr<app::Loot> GameSession::GetLootById(unsigned loot_id) {
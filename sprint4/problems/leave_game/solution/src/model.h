@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -13,6 +14,7 @@
 #include "collision_detector.h"
 #include "extra_data.h"
 #include "loot_generator.h"
+#include "memory_usage.h"
 #include "tagged.h"
 
 using namespace std::chrono_literals;
@@ -71,6 +73,8 @@ public:
     void SetDownTime(std::chrono::milliseconds down_time);
     [[nodiscard]] std::chrono::milliseconds GetPlayTime() const;
     void SetPlayTime(std::chrono::milliseconds play_time);
+    // Память имени, сумки и предметов в ней
+    [[nodiscard]] size_t EstimateHeapUsage() const noexcept;
 
 private:
     DogId dog_id_;
@@ -206,6 +210,7 @@ public:
     [[nodiscard]] unsigned GetBagCapacity() const;
     void AddLootValue(unsigned value) noexcept;
     unsigned GetLootValue(size_t index) const;
+    [[nodiscard]] memory_usage::MapMemoryUsage EstimateMemoryUsage() const noexcept;
 
 private:
     using OfficeIdToIndex = std::unordered_map<Office::Id, size_t, util::TaggedHasher<Office::Id>>;
@@ -255,10 +260,16 @@ public:
     void DeleteDog(std::map<unsigned, std::shared_ptr<app::Dog>>::const_iterator &dog_it);
     void DeleteLoot(const std::shared_ptr<app::Loot> &loot_ptr);
     std::shared_ptr<app::Loot> GetLootById(unsigned loot_id);
-
+    [[nodiscard]] memory_usage::SessionMemoryUsage EstimateMemoryUsage() const noexcept;
+    // Версия состояния сессии: меняется при добавлении и удалении собак и трофеев, на каждом тике
+    // и при действиях игроков. Версии берутся из общего для всех сессий счётчика и не повторяются,
+    // поэтому версия новой сессии не совпадёт с версией удалённой
+    [[nodiscard]] uint64_t GetStateVersion() const noexcept;
+    void MarkStateChanged() noexcept;
 
 private:
     const Map* map_;
+    uint64_t state_version_;
     unsigned next_dog_id_{0};
     unsigned next_loot_id_{0};
     Dogs dogs_;
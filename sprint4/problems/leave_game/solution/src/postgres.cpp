@@ -1,21 +1,252 @@
 #include "postgres.h"
+#include "metrics.h"
 #include "tagged_uuid.h"
 
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/use_awaitable.hpp>
+
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <cassert>
+#include <charconv>
+
 namespace postgres {
 
 using namespace std::literals;
-using pqxx::operator"" _zv;
+namespace sys = boost::system;
+
+namespace {
+
+// Проверяет, что сервер отвечает на запросы через соединение
+net::awaitable<bool> Ping(AsyncConnection &conn, std::chrono::milliseconds timeout) {
+    try {
+        co_await conn.Execute("SELECT 1"s, {}, timeout);
+        co_return true;
+    } catch (const std::exception &) {
+        co_return false;
+    }
+}
+
+// Указатели на текстовые значения параметров запроса для libpq
+std::vector<const char *> GetParamValues(const std::vector<std::string> &params) {
+    std::vector<const char *> values;
+    values.reserve(params.size());
+    for (const auto &param : params) {
+        values.push_back(param.c_str());
+    }
+    return values;
+}
+
+// Протокол сокета libpq: TCP или Unix-сокет в зависимости от адреса сервера
+net::generic::stream_protocol GetSocketProtocol(int fd) {
+    sockaddr_storage address{};
+    socklen_t length = sizeof(address);
+    if (getsockname(fd, reinterpret_cast<sockaddr *>(&address), &length) != 0) {
+        throw DatabaseError("Failed to get the database socket address"s);
+    }
+    return {address.ss_family, 0};
+}
+
+}  // namespace
+
+int QueryResult::GetInt(int row, int column) const {
+    const auto text = GetValue(row, column);
+    int value = 0;
+    const auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc{} || ptr != text.data() + text.size()) {
+        throw DatabaseError("Invalid integer value in query result"s);
+    }
+    return value;
+}
+
+AsyncConnection::AsyncConnection(Executor executor, PGconn *conn)
+    : strand_(net::make_strand(executor))
+    , conn_(conn)
+    , socket_(strand_)
+    , deadline_(strand_) {
+}
+
+AsyncConnection::~AsyncConnection() {
+    Close();
+}
+
+net::awaitable<std::unique_ptr<AsyncConnection>> AsyncConnection::Connect(Executor executor, std::string conninfo,
+                                                                         std::chrono::milliseconds timeout) {
+    PGconn *conn = PQconnectStart(conninfo.c_str());
+    if (!conn) {
+        throw std::bad_alloc{};
+    }
+    std::unique_ptr<AsyncConnection> connection{new AsyncConnection(executor, conn)};
+    if (PQstatus(conn) == CONNECTION_BAD) {
+        connection->ThrowError("Failed to connect to the database"sv);
+    }
+    auto connect = connection->DoConnect(timeout);
+    co_await net::co_spawn(connection->strand_, std::move(connect), net::use_awaitable);
+    co_return connection;
+}
+
+net::awaitable<QueryResult> AsyncConnection::Execute(std::string sql, std::vector<std::string> params,
+                                                     std::chrono::milliseconds timeout) {
+    auto execute = DoExecute([sql = std::move(sql), params = std::move(params)](PGconn *conn) {
+        const auto values = GetParamValues(params);
+        return PQsendQueryParams(conn, sql.c_str(), static_cast<int>(values.size()), nullptr, values.data(),
+                                 nullptr, nullptr, 0);
+    }, timeout);
+    co_return co_await net::co_spawn(strand_, std::move(execute), net::use_awaitable);
+}
+
+net::awaitable<void> AsyncConnection::Prepare(std::string name, std::string sql, std::chrono::milliseconds timeout) {
+    auto prepare = DoExecute([name = std::move(name), sql = std::move(sql)](PGconn *conn) {
+        return PQsendPrepare(conn, name.c_str(), sql.c_str(), 0, nullptr);
+    }, timeout);
+    co_await net::co_spawn(strand_, std::move(prepare), net::use_awaitable);
+}
+
+net::awaitable<QueryResult> AsyncConnection::ExecutePrepared(std::string name, std::vector<std::string> params,
+                                                             std::chrono::milliseconds timeout) {
+    auto execute = DoExecute([name = std::move(name), params = std::move(params)](PGconn *conn) {
+        const auto values = GetParamValues(params);
+        return PQsendQueryPrepared(conn, name.c_str(), static_cast<int>(values.size()), values.data(),
+                                   nullptr, nullptr, 0);
+    }, timeout);
+    co_return co_await net::co_spawn(strand_, std::move(execute), net::use_awaitable);
+}
+
+net::awaitable<void> AsyncConnection::DoConnect(std::chrono::milliseconds timeout) {
+    StartDeadline(timeout);
+    // Перед первым вызовом PQconnectPoll ждём готовности сокета к записи. При переборе адресов сервера
+    // libpq может открыть новый сокет, поэтому перед каждым ожиданием сокет заново передаётся asio
+    for (auto status = PGRES_POLLING_WRITING; status != PGRES_POLLING_OK; status = PQconnectPoll(conn_.get())) {
+        if (status == PGRES_POLLING_FAILED) {
+            ThrowError("Failed to connect to the database"sv);
+        }
+        if (socket_.is_open()) {
+            socket_.release();
+        }
+        const int fd = PQsocket(conn_.get());
+        socket_.assign(GetSocketProtocol(fd), fd);
+        co_await Wait(status == PGRES_POLLING_READING ? Readiness::READ : Readiness::WRITE);
+    }
+    deadline_.cancel();
+    if (PQsetnonblocking(conn_.get(), 1) != 0) {
+        ThrowError("Failed to switch the database connection to nonblocking mode"sv);
+    }
+}
+
+net::awaitable<QueryResult> AsyncConnection::DoExecute(SendCommand send, std::chrono::milliseconds timeout) {
+    if (!IsOpen()) {
+        throw DatabaseError("Database connection is closed"s);
+    }
+    if (!send(conn_.get())) {
+        ThrowError("Failed to send query"sv);
+    }
+    StartDeadline(timeout);
+    co_await Flush();
+
+    // Результаты читаются до конца, даже после ошибки: иначе соединение не будет готово к следующему запросу
+    QueryResult result;
+    std::string error;
+    for (;;) {
+        while (PQisBusy(conn_.get())) {
+            co_await Wait(Readiness::READ);
+            if (!PQconsumeInput(conn_.get())) {
+                ThrowError("Failed to read query result"sv);
+            }
+        }
+        PGresult *next = PQgetResult(conn_.get());
+        if (!next) {
+            break;
+        }
+        const auto status = PQresultStatus(next);
+        if (status != PGRES_COMMAND_OK && status != PGRES_TUPLES_OK && error.empty()) {
+            error = PQresultErrorMessage(next);
+        }
+        result = QueryResult{next};
+    }
+    deadline_.cancel();
+    if (!error.empty()) {
+        throw DatabaseError(error);
+    }
+    co_return result;
+}
 
-ConnectionPool::ConnectionWrapper::
-ConnectionWrapper(std::shared_ptr<pqxx::connection> &&conn, PoolType &pool) noexcept: conn_{std::move(conn)}
+net::awaitable<void> AsyncConnection::Flush() {
+    // Запросы игры короткие и обычно передаются одним вызовом PQflush
+    for (int pending = PQflush(conn_.get()); pending != 0; pending = PQflush(conn_.get())) {
+        if (pending < 0) {
+            ThrowError("Failed to send query"sv);
+        }
+        co_await Wait(Readiness::WRITE);
+    }
+}
+
+net::awaitable<void> AsyncConnection::Wait(Readiness readiness) {
+    sys::error_code ec;
+    if (readiness == Readiness::READ) {
+        // Чтение с MSG_PEEK сначала проверяет сокет и только потом ждёт события, поэтому данные,
+        // пришедшие между чтением libpq и началом ожидания, не теряются. Байт остаётся в сокете для libpq
+        char byte;
+        co_await socket_.async_receive(net::buffer(&byte, 1), net::socket_base::message_peek,
+                                       net::redirect_error(net::use_awaitable, ec));
+    } else {
+        co_await socket_.async_wait(net::socket_base::wait_write, net::redirect_error(net::use_awaitable, ec));
+    }
+    if (timed_out_) {
+        Close();
+        throw DatabaseError("Database operation timed out"s);
+    }
+    // Закрытие соединения сервером обнаружит libpq при следующем чтении
+    if (ec && ec != net::error::eof) {
+        Close();
+        throw DatabaseError("Database socket error: "s + ec.message());
+    }
+}
+
+void AsyncConnection::StartDeadline(std::chrono::milliseconds timeout) {
+    timed_out_ = false;
+    deadline_.expires_after(timeout);
+    deadline_.async_wait([this](const sys::error_code &ec) {
+        // Таймер мог сработать одновременно с завершением операции и перезапуском для следующей,
+        // поэтому срок проверяется заново
+        if (ec || deadline_.expiry() > net::steady_timer::clock_type::now()) {
+            return;
+        }
+        timed_out_ = true;
+        sys::error_code ignored;
+        socket_.cancel(ignored);
+    });
+}
+
+void AsyncConnection::Close() noexcept {
+    if (socket_.is_open()) {
+        sys::error_code ignored;
+        socket_.release(ignored);
+    }
+    conn_.reset();
+}
+
+void AsyncConnection::ThrowError(std::string_view what) {
+    std::string message{what};
+    if (conn_) {
+        message.append(": "sv).append(PQerrorMessage(conn_.get()));
+    }
+    Close();
+    throw DatabaseError(message);
+}
+
+ConnectionPool::ConnectionWrapper::ConnectionWrapper(ConnectionPtr &&conn, PoolType &pool) noexcept
+    : conn_{std::move(conn)}
     , pool_{&pool} {
 }
 
-pqxx::connection & ConnectionPool::ConnectionWrapper::operator*() const & noexcept {
+AsyncConnection &ConnectionPool::ConnectionWrapper::operator*() const & noexcept {
     return *conn_;
 }
 
-pqxx::connection * ConnectionPool::ConnectionWrapper::operator->() const & noexcept {
+AsyncConnection *ConnectionPool::ConnectionWrapper::operator->() const & noexcept {
     return conn_.get();
 }
 
@@ -25,78 +256,252 @@ ConnectionPool::ConnectionWrapper::~ConnectionWrapper() {
     }
 }
 
-ConnectionPool::ConnectionWrapper ConnectionPool::GetConnection() {
-    std::unique_lock lock{mutex_};
-    // Блокируем текущий поток и ждём, пока cond_var_ не получит уведомление и не освободится
-    // хотя бы одно соединение
-    cond_var_.wait(lock, [this] {
-        return used_connections_ < pool_.size();
+ConnectionPool::ConnectionPool(Strand strand, ConnectionPoolSettings settings, ConnectionFactory connection_factory)
+    : strand_(std::move(strand))
+    , settings_(settings)
+    , connection_factory_(std::move(connection_factory)) {
+    if (settings_.max_size == 0 || settings_.min_size > settings_.max_size) {
+        throw std::invalid_argument("Invalid connection pool size");
+    }
+    idle_.reserve(settings_.max_size);
+}
+
+net::awaitable<ConnectionPool::ConnectionWrapper> ConnectionPool::GetConnection() {
+    auto conn = co_await GetConnection(settings_.acquire_timeout);
+    if (!conn) {
+        throw ConnectionPoolTimeout{};
+    }
+    co_return std::move(*conn);
+}
+
+net::awaitable<std::optional<ConnectionPool::ConnectionWrapper>> ConnectionPool::GetConnection(
+        std::chrono::milliseconds timeout) {
+    auto acquire = Acquire(timeout);
+    auto checkout = co_await net::co_spawn(strand_, std::move(acquire), net::use_awaitable);
+    if (!checkout) {
+        co_return std::nullopt;
+    }
+    // Место в пуле занято. Соединение открывается или проверяется уже вне strand пула
+    ConnectionPtr conn;
+    std::exception_ptr error;
+    try {
+        if (checkout->connection) {
+            auto validate = Validate(std::move(*checkout));
+            conn = co_await std::move(validate);
+        } else {
+            auto open = OpenConnection();
+            conn = co_await std::move(open);
+        }
+    } catch (...) {
+        error = std::current_exception();
+    }
+    if (error) {
+        ReleaseSlot();
+        std::rethrow_exception(error);
+    }
+    co_return ConnectionWrapper{std::move(conn), *this};
+}
+
+net::awaitable<std::optional<ConnectionPool::IdleConnection>> ConnectionPool::Acquire(
+        std::chrono::milliseconds timeout) {
+    auto &server_metrics = metrics::GetServerMetrics();
+    const auto wait_start = Clock::now();
+    Waiter waiter{net::steady_timer{strand_, timeout}, std::nullopt};
+    // Ждём, пока не освободится соединение или не появится место для нового.
+    // Возвращённое соединение передаётся ждущей сопрограмме вместе с местом в пуле, поэтому
+    // счётчики соединений уже учитывают его
+    while (idle_.empty() && open_connections_ >= settings_.max_size) {
+        if (waiter.timer.expiry() <= Clock::now()) {
+            server_metrics.db_pool_wait.Record(Clock::now() - wait_start);
+            server_metrics.db_pool_timeouts.Add();
+            co_return std::nullopt;
+        }
+        waiters_.push_back(&waiter);
+        sys::error_code ec;
+        co_await waiter.timer.async_wait(net::redirect_error(net::use_awaitable, ec));
+        std::erase(waiters_, &waiter);
+        if (waiter.checkout) {
+            server_metrics.db_pool_wait.Record(Clock::now() - wait_start);
+            co_return std::move(waiter.checkout);
+        }
+    }
+    IdleConnection checkout;
+    if (!idle_.empty()) {
+        checkout = std::move(idle_.back());
+        idle_.pop_back();
+    } else {
+        ++open_connections_;
+    }
+    ++used_connections_;
+    UpdateGauges();
+    server_metrics.db_pool_wait.Record(Clock::now() - wait_start);
+    co_return checkout;
+}
+
+void ConnectionPool::EvictIdleConnections() {
+    net::post(strand_, [this] {
+        // Соединения закрываются при разрушении evicted
+        std::vector<ConnectionPtr> evicted;
+        TakeExpired(Clock::now(), evicted);
+        UpdateGauges();
     });
-    // После выхода из цикла ожидания мьютекс остаётся захваченным
+}
 
-    return {std::move(pool_[used_connections_++]), *this};
+net::awaitable<ConnectionPool::ConnectionPtr> ConnectionPool::Validate(IdleConnection idle) {
+    bool alive = idle.connection->IsOpen();
+    if (alive && Clock::now() - idle.idle_since >= settings_.validation_interval) {
+        auto ping = Ping(*idle.connection, settings_.query_timeout);
+        alive = co_await std::move(ping);
+    }
+    if (alive) {
+        co_return std::move(idle.connection);
+    }
+    // Сервер закрыл соединение или оно оборвалось, пока лежало в пуле. Открываем новое на его месте
+    metrics::GetServerMetrics().db_connections_broken.Add();
+    idle.connection.reset();
+    auto open = OpenConnection();
+    co_return co_await std::move(open);
 }
 
-std::optional<ConnectionPool::ConnectionWrapper> ConnectionPool::GetConnection(std::chrono::milliseconds timeout) {
-    // Блокируем текущий поток и ждём, пока cond_var_ не получит уведомление и не освободится
-    // хотя бы одно соединение
-    std::unique_lock lock{mutex_};
-    if (!cond_var_.wait_for(lock, timeout, [this] {
-        return used_connections_ < pool_.size();
-    })) {
-        // Если тайм-аут истёк, возвращаем std::nullopt
-        return std::nullopt;
+net::awaitable<ConnectionPool::ConnectionPtr> ConnectionPool::OpenConnection() {
+    auto connect = connection_factory_();
+    auto conn = co_await std::move(connect);
+    metrics::GetServerMetrics().db_connections_created.Add();
+    co_return conn;
+}
+
+void ConnectionPool::TakeExpired(Clock::time_point now, std::vector<ConnectionPtr> &evicted) {
+    auto it = idle_.begin();
+    for (; it != idle_.end() && open_connections_ > settings_.min_size; ++it) {
+        if (now - it->idle_since < settings_.idle_timeout) {
+            break;
+        }
+        evicted.push_back(std::move(it->connection));
+        --open_connections_;
     }
-    // После выхода из цикла ожидания мьютекс остаётся захваченным
-    return ConnectionWrapper{std::move(pool_[used_connections_++]), *this};
+    metrics::GetServerMetrics().db_connections_evicted.Add(evicted.size());
+    idle_.erase(idle_.begin(), it);
+}
+
+void ConnectionPool::ReleaseSlot() {
+    net::post(strand_, [this] {
+        assert(used_connections_ != 0 && open_connections_ != 0);
+        IdleConnection slot;
+        if (!HandOff(slot)) {
+            --used_connections_;
+            --open_connections_;
+        }
+        UpdateGauges();
+    });
+}
+
+bool ConnectionPool::HandOff(IdleConnection& checkout) {
+    if (waiters_.empty()) {
+        return false;
+    }
+    Waiter* waiter = waiters_.front();
+    waiters_.pop_front();
+    waiter->checkout = std::move(checkout);
+    waiter->timer.cancel();
+    return true;
+}
+
+void ConnectionPool::UpdateGauges() const {
+    auto &server_metrics = metrics::GetServerMetrics();
+    server_metrics.db_connections_open.Set(static_cast<int64_t>(open_connections_));
+    server_metrics.db_connections_in_use.Set(static_cast<int64_t>(used_connections_));
 }
 
 void ConnectionPool::ReturnConnection(ConnectionPtr &&conn) {
-    // Возвращаем соединение обратно в пул
-    {
-        std::lock_guard lock{mutex_};
+    // Состояние пула изменяется в его strand. Там же закрываются оборванные и давно простаивающие соединения
+    net::post(strand_, [this, conn = std::move(conn)]() mutable {
         assert(used_connections_ != 0);
-        pool_[--used_connections_] = std::move(conn);
-    }
-    // Уведомляем один из ожидающих потоков об изменении состояния пула
-    cond_var_.notify_one();
+        if (!conn->IsOpen()) {
+            // Оборванное соединение в пул не возвращается, его место освобождается для нового
+            metrics::GetServerMetrics().db_connections_broken.Add();
+            conn.reset();
+        }
+        // Соединение или место оборванного соединения достаётся сопрограмме, дольше всех ждущей соединение.
+        // Если соединение никто не ждёт, оно становится свободным
+        IdleConnection returned{std::move(conn), Clock::now()};
+        if (!HandOff(returned)) {
+            if (returned.connection) {
+                idle_.push_back(std::move(returned));
+            } else {
+                --open_connections_;
+            }
+            --used_connections_;
+        }
+        std::vector<ConnectionPtr> evicted;
+        TakeExpired(Clock::now(), evicted);
+        UpdateGauges();
+    });
 }
 
-RetiredPlayersRepository::RetiredPlayersRepository(pqxx::work &transaction)
-    : transaction_(transaction) {
+RetiredPlayersRepository::RetiredPlayersRepository(AsyncConnection &connection,
+                                                   std::chrono::milliseconds query_timeout)
+    : connection_(connection)
+    , query_timeout_(query_timeout) {
 }
 
-void RetiredPlayersRepository::Save(const std::string &name, int score, int play_time) const {
-    const auto id = RetiredPlayerId::New().ToString();
-    transaction_.exec_params(
-        R"(
-                INSERT INTO retired_players (id, name, score, play_time_ms) VALUES ($1, $2, $3, $4);
-        )"_zv, id, name, score, play_time
-    );
+net::awaitable<void> RetiredPlayersRepository::Prepare(AsyncConnection &connection,
+                                                       std::chrono::milliseconds timeout) {
+    co_await connection.Prepare(std::string{SAVE_STATEMENT}, std::string{SAVE_SQL}, timeout);
 }
 
-std::vector<PlayerRecordResult> RetiredPlayersRepository::Load(int start, int max_items) const {
-    std::vector<PlayerRecordResult> result;
-    const pqxx::result query_result = transaction_.exec_params(
-        R"(
-            SELECT name, score, play_time_ms
+net::awaitable<void> RetiredPlayersRepository::Save(const RetiredPlayer &player) const {
+    std::vector<std::string> params{player.id.ToString(), player.name, std::to_string(player.score),
+                                    std::to_string(player.play_time_ms)};
+    co_await connection_.ExecutePrepared(std::string{SAVE_STATEMENT}, std::move(params), query_timeout_);
+}
+
+net::awaitable<std::vector<RetiredPlayer>> RetiredPlayersRepository::Load(std::optional<RetiredPlayer> after,
+                                                                        int max_items) const {
+    constexpr std::string_view LOAD_FIRST_SQL = R"(
+            SELECT id, name, score, play_time_ms
             FROM retired_players
-            ORDER BY score DESC, play_time_ms, name
-            LIMIT $1 OFFSET $2;
-        )"_zv, max_items, start
-    );
-    for (const auto& row : query_result) {
-        constexpr double MS_IN_S = 1000.0;
-        result.emplace_back(row[0].as<std::string>(), row[1].as<int>(), row[2].as<int>()/MS_IN_S);
+            ORDER BY score DESC, play_time_ms, name, id
+            LIMIT $1;
+    )"sv;
+    // Очки упорядочены по убыванию, а остальные поля - по возрастанию, поэтому позиция сравнивается
+    // в два шага. Условие score <= $1 задаёт начало просмотра индекса score_play_time_ms_name_idx,
+    // и предыдущие страницы не читаются
+    constexpr std::string_view LOAD_AFTER_SQL = R"(
+            SELECT id, name, score, play_time_ms
+            FROM retired_players
+            WHERE score <= $1
+              AND (score < $1 OR (play_time_ms, name, id) > ($2::integer, $3::varchar, $4::uuid))
+            ORDER BY score DESC, play_time_ms, name, id
+            LIMIT $5;
+    )"sv;
+    std::vector<RetiredPlayer> result;
+    std::string_view sql = LOAD_FIRST_SQL;
+    std::vector<std::string> params;
+    if (after) {
+        sql = LOAD_AFTER_SQL;
+        params = {std::to_string(after->score), std::to_string(after->play_time_ms), after->name,
+                  after->id.ToString()};
     }
-    return result;
+    params.push_back(std::to_string(max_items));
+    const QueryResult query_result = co_await connection_.Execute(std::string{sql}, std::move(params),
+                                                                  query_timeout_);
+    result.reserve(query_result.GetRowCount());
+    for (int row = 0; row < query_result.GetRowCount(); ++row) {
+        result.push_back({RetiredPlayerId::FromString(std::string{query_result.GetValue(row, 0)}),
+                          std::string{query_result.GetValue(row, 1)}, query_result.GetInt(row, 2),
+                          query_result.GetInt(row, 3)});
+    }
+    co_return result;
 }
 
 Database::Database(std::shared_ptr<ConnectionPool> pool_ptr)
     : pool_ptr_(std::move(pool_ptr)) {
-    const auto conn = pool_ptr_->GetConnection();
-    pqxx::work transaction{*conn};
-    transaction.exec(
+}
+
+net::awaitable<void> Database::CreateSchema(AsyncConnection::Executor executor, std::string conninfo,
+                                            std::chrono::milliseconds timeout) {
+    const auto conn = co_await AsyncConnection::Connect(executor, std::move(conninfo), timeout);
+    co_await conn->Execute(
         R"(
             CREATE TABLE IF NOT EXISTS retired_players (
                 id UUID CONSTRAINT retired_players_id_constraint PRIMARY KEY,
@@ -104,17 +509,23 @@ Database::Database(std::shared_ptr<ConnectionPool> pool_ptr)
                 score integer NOT NULL,
                 play_time_ms integer NOT NULL
             );
-        )"_zv
+        )"s, {}, timeout
     );
 
-    transaction.exec(R"(
+    co_await conn->Execute(R"(
         CREATE INDEX IF NOT EXISTS score_play_time_ms_name_idx ON retired_players (score DESC, play_time_ms, name);
-    )"_zv);
-    transaction.commit();
+    )"s, {}, timeout);
 }
 
-ConnectionPool::ConnectionWrapper Database::GetTransaction() const {
-    return  pool_ptr_->GetConnection();
+net::awaitable<std::unique_ptr<AsyncConnection>> Database::Connect(AsyncConnection::Executor executor,
+                                                                   std::string conninfo,
+                                                                   std::chrono::milliseconds timeout) {
+    auto conn = co_await AsyncConnection::Connect(executor, std::move(conninfo), timeout);
+    co_await RetiredPlayersRepository::Prepare(*conn, timeout);
+    co_return conn;
 }
-} // namespace postgres
 
+net::awaitable<ConnectionPool::ConnectionWrapper> Database::GetConnection() const {
+    return pool_ptr_->GetConnection();
+}
+} // namespace postgres
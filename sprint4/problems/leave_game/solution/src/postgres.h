@@ -1,26 +1,187 @@
 #pragma once
 
-#include <condition_variable>
-#include <pqxx/pqxx>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/generic/stream_protocol.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <libpq-fe.h>
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include "tagged_uuid.h"
 
 namespace postgres {
 
-struct PlayerRecordResult {
+namespace net = boost::asio;
+
+namespace detail {
+struct RetiredPlayerId {};
+}  // namespace detail
+
+using RetiredPlayerId = util::TaggedUUID<detail::RetiredPlayerId>;
+
+// Игрок, ушедший на покой, для записи в таблицу рекордов
+struct RetiredPlayer {
+    // Назначается при уходе игрока, поэтому запись в памяти и строка таблицы совпадают
+    RetiredPlayerId id;
     std::string name;
     int score{0};
-    double play_time{0.0};
+    int play_time_ms{0};
+};
+
+// Ошибка соединения с сервером или выполнения запроса
+class DatabaseError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// Результат запроса. Значения полей передаются сервером в текстовом виде
+class QueryResult {
+public:
+    QueryResult() = default;
+    explicit QueryResult(PGresult* result) noexcept
+            : result_(result) {
+    }
+
+    [[nodiscard]] int GetRowCount() const noexcept {
+        return PQntuples(result_.get());
+    }
+    [[nodiscard]] std::string_view GetValue(int row, int column) const noexcept {
+        return {PQgetvalue(result_.get(), row, column),
+                static_cast<size_t>(PQgetlength(result_.get(), row, column))};
+    }
+    [[nodiscard]] int GetInt(int row, int column) const;
+
+private:
+    struct Deleter {
+        void operator()(PGresult* result) const noexcept {
+            PQclear(result);
+        }
+    };
+    std::unique_ptr<PGresult, Deleter> result_;
+};
+
+// Соединение с сервером PostgreSQL, встроенное в цикл событий asio. libpq работает в неблокирующем режиме,
+// а готовности его сокета сопрограммы ждут через asio, поэтому запрос не занимает поток на время обмена с сервером.
+// Операции выполняются в strand соединения и завершаются в исполнителе вызывающей сопрограммы.
+// Соединение выполняет один запрос за раз: пул выдаёт его одной сопрограмме
+class AsyncConnection {
+public:
+    using Executor = net::io_context::executor_type;
+
+    // Открывает соединение. Установка соединения ограничена по времени timeout
+    static net::awaitable<std::unique_ptr<AsyncConnection>> Connect(Executor executor, std::string conninfo,
+                                                                    std::chrono::milliseconds timeout);
+
+    AsyncConnection(const AsyncConnection&) = delete;
+    AsyncConnection& operator=(const AsyncConnection&) = delete;
+    virtual ~AsyncConnection();
+
+    // Отправляет запрос с текстовыми параметрами ($1, $2, ...) и ждёт его результат.
+    // Запрос, не завершившийся за timeout, прерывается, а соединение закрывается
+    net::awaitable<QueryResult> Execute(std::string sql, std::vector<std::string> params,
+                                        std::chrono::milliseconds timeout);
+    // Готовит именованный запрос. Сервер разбирает и планирует его один раз, а не при каждом выполнении.
+    // Подготовленный запрос доступен до закрытия соединения
+    net::awaitable<void> Prepare(std::string name, std::string sql, std::chrono::milliseconds timeout);
+    // Выполняет запрос, подготовленный Prepare
+    net::awaitable<QueryResult> ExecutePrepared(std::string name, std::vector<std::string> params,
+                                                std::chrono::milliseconds timeout);
+
+    // Соединение установлено и не оборвано. Пул проверяет этим методом соединения, которые выдаёт и принимает
+    [[nodiscard]] virtual bool IsOpen() const noexcept {
+        return PQstatus(conn_.get()) == CONNECTION_OK;
+    }
+
+protected:
+    // Соединение владеет conn. Подклассы, заменяющие соединение в тестах пула, передают nullptr
+    AsyncConnection(Executor executor, PGconn* conn);
+
+private:
+    using Strand = net::strand<Executor>;
+    // Ожидание готовности сокета к чтению или записи
+    enum class Readiness { READ, WRITE };
+    // Передаёт команду в libpq вызовом PQsend*. Возвращает 0 при ошибке
+    using SendCommand = std::function<int(PGconn*)>;
+
+    net::awaitable<void> DoConnect(std::chrono::milliseconds timeout);
+    // Отправляет команду и ждёт её результат
+    net::awaitable<QueryResult> DoExecute(SendCommand send, std::chrono::milliseconds timeout);
+    // Передаёт серверу буферизованные libpq данные запроса
+    net::awaitable<void> Flush();
+    // Ждёт готовности сокета libpq. Сокет может смениться при установке соединения
+    net::awaitable<void> Wait(Readiness readiness);
+    // По истечении timeout отменяет ожидание сокета. Истёкшее время отмечается в timed_out_
+    void StartDeadline(std::chrono::milliseconds timeout);
+    // Закрывает соединение после ошибки, после которой его состояние неизвестно
+    void Close() noexcept;
+    [[noreturn]] void ThrowError(std::string_view what);
+
+    struct Deleter {
+        void operator()(PGconn* conn) const noexcept {
+            PQfinish(conn);
+        }
+    };
+
+    Strand strand_;
+    std::unique_ptr<PGconn, Deleter> conn_;
+    // Сокет принадлежит libpq: asio только ждёт его готовности и освобождает без закрытия
+    net::generic::stream_protocol::socket socket_;
+    net::steady_timer deadline_;
+    bool timed_out_ = false;
+};
+
+// Параметры пула соединений
+struct ConnectionPoolSettings {
+    // Пул не закрывает простаивающие соединения, если открыто не больше min_size.
+    // Соединения открываются по мере надобности, в том числе первые min_size
+    size_t min_size = 1;
+    // Наибольшее число одновременно открытых соединений
+    size_t max_size = 4;
+    // Наибольшее время ожидания свободного соединения
+    std::chrono::milliseconds acquire_timeout{5000};
+    // Соединение, простоявшее в пуле дольше, закрывается
+    std::chrono::milliseconds idle_timeout{60000};
+    // Соединение, простоявшее в пуле дольше, перед выдачей проверяется запросом к серверу
+    std::chrono::milliseconds validation_interval{10000};
+    // Наибольшее время установки соединения и выполнения одного запроса
+    std::chrono::milliseconds connect_timeout{5000};
+    std::chrono::milliseconds query_timeout{5000};
+};
+
+// Свободное соединение не появилось за время ожидания
+class ConnectionPoolTimeout : public std::runtime_error {
+public:
+    ConnectionPoolTimeout()
+            : std::runtime_error("Timed out waiting for a database connection") {
+    }
 };
 
+// Пул асинхронных соединений переменного размера. Соединения открываются при нехватке свободных
+// и закрываются после простоя. Перед выдачей соединение проверяется и при обрыве заменяется новым.
+// Состояние пула изменяется только в его strand, а сопрограммы, ждущие соединение, не занимают потоки.
+// Соединения открываются и проверяются вне strand пула
 class ConnectionPool {
     using PoolType = ConnectionPool;
-    using ConnectionPtr = std::shared_ptr<pqxx::connection>;
+    using ConnectionPtr = std::unique_ptr<AsyncConnection>;
+    using Clock = std::chrono::steady_clock;
 
 public:
+    using Strand = net::strand<net::io_context::executor_type>;
+    using ConnectionFactory = std::function<net::awaitable<ConnectionPtr>()>;
+
     class ConnectionWrapper {
     public:
-        ConnectionWrapper(std::shared_ptr<pqxx::connection>&& conn, PoolType& pool) noexcept;
+        ConnectionWrapper(ConnectionPtr&& conn, PoolType& pool) noexcept;
 
         ConnectionWrapper(const ConnectionWrapper&) = delete;
         ConnectionWrapper& operator=(const ConnectionWrapper&) = delete;
@@ -28,67 +189,137 @@ public:
         ConnectionWrapper(ConnectionWrapper&&) = default;
         ConnectionWrapper& operator=(ConnectionWrapper&&) = default;
 
-        pqxx::connection& operator*() const& noexcept;
+        AsyncConnection& operator*() const& noexcept;
 
-        pqxx::connection& operator*() const&& = delete;
+        AsyncConnection& operator*() const&& = delete;
 
-        pqxx::connection* operator->() const& noexcept;
+        AsyncConnection* operator->() const& noexcept;
 
         ~ConnectionWrapper();
 
     private:
-        std::shared_ptr<pqxx::connection> conn_;
+        ConnectionPtr conn_;
         PoolType* pool_;
     };
 
-    // ConnectionFactory is a functional object returning std::shared_ptr<pqxx::connection>
-    template <typename ConnectionFactory>
-    ConnectionPool(size_t capacity, ConnectionFactory&& connection_factory);
+    // connection_factory открывает новое соединение и выбрасывает исключение при ошибке.
+    // Пул должен жить дольше io_context, в котором выполняются его операции
+    ConnectionPool(Strand strand, ConnectionPoolSettings settings, ConnectionFactory connection_factory);
+
+    // Ждёт соединение не дольше acquire_timeout. По истечении выбрасывает ConnectionPoolTimeout
+    net::awaitable<ConnectionWrapper> GetConnection();
 
-    ConnectionWrapper GetConnection();
+    net::awaitable<std::optional<ConnectionWrapper>> GetConnection(std::chrono::milliseconds timeout);
 
-    std::optional<ConnectionWrapper> GetConnection(std::chrono::milliseconds timeout);
+    // Закрывает соединения, простоявшие дольше idle_timeout. Вызывается периодически,
+    // а также при возврате соединения в пул
+    void EvictIdleConnections();
+
+    [[nodiscard]] const ConnectionPoolSettings& GetSettings() const noexcept {
+        return settings_;
+    }
+    [[nodiscard]] Strand::inner_executor_type GetExecutor() const noexcept {
+        return strand_.get_inner_executor();
+    }
 
 private:
-    void ReturnConnection(ConnectionPtr&& conn);
+    struct IdleConnection {
+        ConnectionPtr connection;
+        Clock::time_point idle_since;
+    };
 
-    std::mutex mutex_;
-    std::condition_variable cond_var_;
-    std::vector<ConnectionPtr> pool_;
-    size_t used_connections_ = 0;
-};
+    // Сопрограмма, ждущая соединение. Отмена таймера будит её, а checkout заполняется переданным соединением
+    struct Waiter {
+        net::steady_timer timer;
+        std::optional<IdleConnection> checkout;
+    };
 
-template<typename ConnectionFactory>
-ConnectionPool::ConnectionPool(size_t capacity, ConnectionFactory &&connection_factory) {
-    pool_.reserve(capacity);
-    for (size_t i = 0; i < capacity; ++i) {
-        pool_.emplace_back(connection_factory());
-    }
-}
+    // Занимает место в пуле в strand пула. Возвращает свободное соединение либо пустое соединение,
+    // если выделено место для нового. По истечении timeout возвращает std::nullopt
+    net::awaitable<std::optional<IdleConnection>> Acquire(std::chrono::milliseconds timeout);
+    void ReturnConnection(ConnectionPtr&& conn);
+    // Проверяет соединение, взятое из пула. Оборванное соединение заменяется новым
+    net::awaitable<ConnectionPtr> Validate(IdleConnection idle);
+    net::awaitable<ConnectionPtr> OpenConnection();
+    // Переносит соединения, простоявшие дольше idle_timeout, в evicted
+    void TakeExpired(Clock::time_point now, std::vector<ConnectionPtr>& evicted);
+    // Освобождает место занятого соединения, которое не удалось открыть или проверить
+    void ReleaseSlot();
+    // Передаёт соединение или, если connection пусто, место для нового соединения сопрограмме,
+    // дольше всех ждущей соединение. Возвращает false, если соединение никто не ждёт
+    bool HandOff(IdleConnection& checkout);
+    // Обновляет число открытых и выданных соединений в метриках
+    void UpdateGauges() const;
 
-namespace detail {
-struct RetiredPlayerId {};
-}  // namespace detail
+    Strand strand_;
+    const ConnectionPoolSettings settings_;
+    const ConnectionFactory connection_factory_;
 
-using RetiredPlayerId = util::TaggedUUID<detail::RetiredPlayerId>;
+    // Остальные поля изменяются только в strand_.
+    // Свободные соединения. Соединения берутся с конца, поэтому в начале оказываются
+    // дольше всех простаивающие
+    std::vector<IdleConnection> idle_;
+    // Сопрограммы, ждущие соединение, в порядке очереди. Возвращённое соединение передаётся первой из них
+    // напрямую, поэтому новые сопрограммы не перехватывают его у ждущих
+    std::deque<Waiter*> waiters_;
+    // Открытые соединения, включая выданные и открываемые в данный момент
+    size_t open_connections_ = 0;
+    size_t used_connections_ = 0;
+};
 
+// Запись игрока выполняется подготовленным запросом: соединение должно быть открыто Database::Connect
 class RetiredPlayersRepository {
 public:
-    explicit RetiredPlayersRepository(pqxx::work& transaction);
+    // Запрос записи игрока и имя, под которым он готовится в каждом соединении
+    static constexpr std::string_view SAVE_SQL = R"(
+            INSERT INTO retired_players (id, name, score, play_time_ms) VALUES ($1, $2, $3, $4)
+            ON CONFLICT (id) DO NOTHING;
+    )";
+    static constexpr std::string_view SAVE_STATEMENT = "retired_players_save";
+
+    RetiredPlayersRepository(AsyncConnection& connection, std::chrono::milliseconds query_timeout);
+
+    // Готовит запрос записи игрока в новом соединении. Загрузка выполняется один раз при старте,
+    // поэтому её запросы не готовятся
+    static net::awaitable<void> Prepare(AsyncConnection& connection, std::chrono::milliseconds timeout);
 
-    void Save(const std::string &name, int score, int play_time) const;
+    // Повторная запись игрока с тем же идентификатором ничего не меняет, поэтому запись можно повторять
+    net::awaitable<void> Save(const RetiredPlayer& player) const;
 
-    [[nodiscard]] std::vector<PlayerRecordResult> Load(int start, int max_items) const;
+    // Загружает не больше max_items записей в порядке таблицы рекордов, следующих за записью after,
+    // или первые записи, если after не задан. Позиция ищется по индексу, поэтому время выборки
+    // не зависит от числа предыдущих записей
+    net::awaitable<std::vector<RetiredPlayer>> Load(std::optional<RetiredPlayer> after, int max_items) const;
 
 private:
-    pqxx::work& transaction_;
+    AsyncConnection& connection_;
+    std::chrono::milliseconds query_timeout_;
 };
 
 class Database {
 public:
     explicit Database(std::shared_ptr<ConnectionPool> pool_ptr);
 
-    [[nodiscard]] ConnectionPool::ConnectionWrapper GetTransaction() const;
+    // Создаёт таблицу рекордов и её индекс, если их ещё нет. Использует отдельное соединение и вызывается
+    // до открытия соединений пула: запросы, которые готовит Connect, ссылаются на таблицу
+    static net::awaitable<void> CreateSchema(AsyncConnection::Executor executor, std::string conninfo,
+                                             std::chrono::milliseconds timeout);
+    // Открывает соединение для пула и готовит в нём запросы репозиториев.
+    // timeout ограничивает установку соединения и подготовку каждого запроса
+    static net::awaitable<std::unique_ptr<AsyncConnection>> Connect(AsyncConnection::Executor executor,
+                                                                    std::string conninfo,
+                                                                    std::chrono::milliseconds timeout);
+
+    // Ждёт соединение из пула не дольше acquire_timeout. По истечении выбрасывает ConnectionPoolTimeout
+    [[nodiscard]] net::awaitable<ConnectionPool::ConnectionWrapper> GetConnection() const;
+
+    [[nodiscard]] std::chrono::milliseconds GetQueryTimeout() const noexcept {
+        return pool_ptr_->GetSettings().query_timeout;
+    }
+    // Исполнитель, в котором запускаются операции с базой данных, не относящиеся к запросам клиентов
+    [[nodiscard]] net::io_context::executor_type GetExecutor() const noexcept {
+        return pool_ptr_->GetExecutor();
+    }
 
 private:
     std::shared_ptr<ConnectionPool> pool_ptr_;
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <boost/json.hpp>
+
+#include <cstddef>
+#include <string>
+
+namespace http_handler {
+
+namespace json = boost::json;
+
+// Арена для временных JSON-объектов одного запроса: разобранного тела и
+// объектов, из которых строится ответ. Первые BUFFER_SIZE байт выделяются
+// из буфера внутри самой арены, поэтому арена, созданная на стеке, обслуживает
+// типичный запрос без обращений к куче. Память освобождается целиком вместе с ареной
+class RequestArena {
+public:
+    static constexpr size_t BUFFER_SIZE = 4096;
+
+    RequestArena() = default;
+    RequestArena(const RequestArena&) = delete;
+    RequestArena& operator=(const RequestArena&) = delete;
+
+    // Невладеющий указатель на ресурс арены. Значения, созданные с ним,
+    // не должны переживать арену
+    [[nodiscard]] json::storage_ptr Storage() noexcept {
+        return json::storage_ptr(&resource_);
+    }
+
+private:
+    alignas(std::max_align_t) unsigned char buffer_[BUFFER_SIZE];
+    json::monotonic_resource resource_{buffer_, BUFFER_SIZE};
+};
+
+// Сериализует JSON во вновь созданную строку. Тело размером до SERIALIZE_CHUNK_SIZE
+// сериализуется в буфер на стеке и копируется в строку одним выделением памяти точного размера.
+// Для больших тел строка сразу резервирует два буфера и дальше растёт вдвое, как и в json::serialize
+template <typename JsonValue>
+std::string SerializeJson(const JsonValue& value) {
+    constexpr size_t SERIALIZE_CHUNK_SIZE = 4096;
+    char chunk[SERIALIZE_CHUNK_SIZE];
+    json::serializer serializer;
+    serializer.reset(&value);
+    const auto first_part = serializer.read(chunk, SERIALIZE_CHUNK_SIZE);
+    std::string result(first_part.data(), first_part.size());
+    if (serializer.done()) {
+        return result;
+    }
+    result.reserve(2 * SERIALIZE_CHUNK_SIZE);
+    while (!serializer.done()) {
+        const auto part = serializer.read(chunk, SERIALIZE_CHUNK_SIZE);
+        result.append(part.data(), part.size());
+    }
+    return result;
+}
+
+}  // namespace http_handler
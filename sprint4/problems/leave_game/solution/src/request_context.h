@@ -0,0 +1,50 @@
+#pragma once
+
+#include "api_router.h"
+
+#include <chrono>
+#include <optional>
+
+namespace server_logging {
+
+// Хронометраж одного запроса. Контекст живёт в кадре сопрограммы LoggingRequestHandler и передаётся
+// обработчику по ссылке, поэтому одновременно обрабатываемые запросы не делят изменяемое состояние
+struct RequestContext {
+    using Clock = std::chrono::steady_clock;
+
+    // Соединение принято, получены первые байты запроса и запрос прочитан. Заполняются из сведений соединения
+    Clock::time_point accepted_at;
+    Clock::time_point read_started_at;
+    Clock::time_point read_finished_at;
+    // Запрос прочитан и передан обработчику
+    Clock::time_point received_at = Clock::now();
+    // Запрос к API поставлен в очередь api_strand и начал в нём выполняться.
+    // У запросов к файлам и запросов, отклонённых до постановки в очередь, не заполняются
+    std::optional<Clock::time_point> strand_enqueued_at;
+    std::optional<Clock::time_point> strand_started_at;
+    // Точка входа запроса к API. Для остальных запросов не заполняется
+    std::optional<http_handler::ApiRoute> api_route;
+    // Ответ передан в send. Заполняется в send, а не после возврата из обработчика
+    Clock::time_point responded_at;
+
+    [[nodiscard]] Clock::duration GetReadTime() const noexcept {
+        return read_finished_at - read_started_at;
+    }
+    // Время от получения запроса до готовности ответа
+    [[nodiscard]] Clock::duration GetResponseTime() const noexcept {
+        return responded_at - received_at;
+    }
+    // Время ожидания в очереди api_strand
+    [[nodiscard]] Clock::duration GetStrandWait() const noexcept {
+        if (!strand_enqueued_at || !strand_started_at) {
+            return Clock::duration::zero();
+        }
+        return *strand_started_at - *strand_enqueued_at;
+    }
+    // Время работы обработчика без ожидания api_strand
+    [[nodiscard]] Clock::duration GetHandlerTime() const noexcept {
+        return GetResponseTime() - GetStrandWait();
+    }
+};
+
+}  // namespace server_logging
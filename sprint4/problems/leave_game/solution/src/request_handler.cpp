@@ -1,10 +1,63 @@
 #include <algorithm>
+#include <charconv>
 
 #include "request_handler.h"
 
 using namespace std::literals;
 namespace http_handler {
 
+namespace {
+
+// Профилирование процессора через /admin/profile: длительность по умолчанию и наибольшая, в секундах,
+// и частота выборки. Частота не кратна периодам таймеров, чтобы выборка не совпадала с тиками по фазе
+constexpr int DEFAULT_PROFILE_SECONDS = 10;
+constexpr int MAX_PROFILE_SECONDS = 60;
+constexpr int PROFILE_FREQUENCY = 99;
+
+// Наибольшее число страниц таблицы рекордов в кэше. Клиенты выбирают start и maxItems произвольно,
+// поэтому при переполнении кэш очищается целиком
+constexpr size_t MAX_CACHED_RECORDS_PAGES = 256;
+
+// ETag страницы таблицы рекордов зависит только от версии таблицы: ETag относится к URL вместе с параметрами
+std::string MakeRecordsEtag(uint64_t version) {
+    char buffer[2 + 16];
+    buffer[0] = '"';
+    const auto [ptr, ec] = std::to_chars(buffer + 1, buffer + sizeof(buffer) - 1, version, 16);
+    *ptr = '"';
+    return {buffer, ptr + 1};
+}
+
+// Сравнивает строки за время, зависящее только от их длины, чтобы по времени ответа
+// нельзя было подобрать токен по символам
+bool EqualConstantTime(std::string_view lhs, std::string_view rhs) noexcept {
+    if (lhs.size() != rhs.size()) {
+        return false;
+    }
+    unsigned char diff = 0;
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        diff |= static_cast<unsigned char>(lhs[i] ^ rhs[i]);
+    }
+    return diff == 0;
+}
+
+// Разбирает целое число из параметра запроса. Значение должно занимать строку целиком
+bool ParseInt(std::string_view str, int& value) {
+    const auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+    return ec == std::errc{} && ptr == str.data() + str.size();
+}
+
+// Возвращает строковое поле JSON-объекта или nullptr, если поля нет или оно другого типа.
+// В отличие от value_to, не бросает исключений при некорректном теле запроса
+const json::string* FindStringField(const json::value& body, const char* key) {
+    if (!body.is_object()) {
+        return nullptr;
+    }
+    const json::value* field = body.get_object().if_contains(key);
+    return field ? field->if_string() : nullptr;
+}
+
+}  // namespace
+
 const std::unordered_map<std::string, std::string> FileRequestHandler::mime_types_ = {
         {".htm"s, "text/html"s}, {".html"s, "text/html"s},
         {".css"s, "text/css"s}, {".txt"s, "text/plain"s},
@@ -45,20 +98,6 @@ std::string FileRequestHandler::UrlDecode(const std::string &url) {
     return result;
 }
 
-bool FileRequestHandler::IsSubPath(fs::path path, fs::path base) {
-    // Приводим оба пути к каноничному виду (без . и ..)
-    path = fs::weakly_canonical(path);
-    base = fs::weakly_canonical(base);
-
-    // Проверяем, что все компоненты base содержатся внутри path
-    for (auto b = base.begin(), p = path.begin(); b != base.end(); ++b, ++p) {
-        if (p == path.end() || *p != *b) {
-            return false;
-        }
-    }
-    return true;
-}
-
 StringResponse FileRequestHandler::NotFoundResponse(unsigned int version) const {
     StringResponse res{http::status::not_found, version};
     res.set(http::field::content_type, "text/plain");
@@ -77,90 +116,472 @@ StringResponse FileRequestHandler::BadRequestResponse(unsigned int version) cons
     return res;
 }
 
+std::variant<const StaticEntry*, StringResponse> FileRequestHandler::ResolveFile(const StaticContent &content,
+                                                                                const HttpRequest &req) const {
+    // Параметры запроса не относятся к пути файла
+    std::string_view target = req.target();
+    target = target.substr(0, target.find('?'));
+    if (!target.starts_with('/')) {
+        return BadRequestResponse(req.version());
+    }
+
+    // Пути вне каталога статических файлов отсеяны при построении индекса
+    const StaticEntry* entry = content.index.Find(UrlDecode(std::string(target)));
+    if (!entry) {
+        return NotFoundResponse(req.version());
+    }
+    return entry;
+}
+
 FileRequestResult FileRequestHandler::GetFileResponse(const HttpRequest &req) {
-    // Получаем полный путь к статическому каталогу
-    fs::path static_root = fs::weakly_canonical(root_);
+    const auto content = GetContent();
+    auto prepared = PrepareResponse(*content, req);
+    if (auto* response = std::get_if<FileRequestResult>(&prepared)) {
+        return std::move(*response);
+    }
+    const auto& disk_read = std::get<DiskRead>(prepared);
+    return ReadFromDisk(req, *disk_read.entry, disk_read.range);
+}
 
-    // Декодируем URL получаем относительный путь
-    fs::path rel_path{UrlDecode(std::string(req.target()))};
-    rel_path = fs::weakly_canonical(rel_path);
+#ifdef BOOST_ASIO_HAS_FILE
+net::awaitable<FileRequestResult> FileRequestHandler::GetFileResponseAsync(const HttpRequest &req) {
+    const auto content = GetContent();
+    auto prepared = PrepareResponse(*content, req);
+    if (auto* response = std::get_if<FileRequestResult>(&prepared)) {
+        co_return std::move(*response);
+    }
+    const auto& disk_read = std::get<DiskRead>(prepared);
+    const StaticEntry& entry = *disk_read.entry;
+    if (disk_read.range || UseSendfile(entry)) {
+        co_return ReadFromDisk(req, entry, disk_read.range);
+    }
 
-    // Если путь абсолютный, делаем его относительным
-    if (rel_path.is_absolute()) {
-        rel_path = rel_path.relative_path();
+    // Файл читается через io_uring, не блокируя поток io_context
+    beast::error_code ec;
+    const auto executor = co_await net::this_coro::executor;
+    net::random_access_file file(executor);
+    file.open(entry.path.string(), net::random_access_file::read_only, ec);
+    if (ec) {
+        co_return NotFoundResponse(req.version());
+    }
+    const uint64_t size = file.size(ec);
+    if (ec || size > settings_.max_async_read_size) {
+        // Крупные файлы отдаются по частям через file_body, не занимая память целиком
+        co_return ReadFromDisk(req, entry, std::nullopt);
     }
 
-    // Формирование полного пути к файлу
-    fs::path full_path = fs::weakly_canonical(static_root / rel_path);
+    StringResponse res{http::status::ok, req.version()};
+    res.body().resize(size);
+    co_await net::async_read_at(file, 0, net::buffer(res.body()), net::redirect_error(net::use_awaitable, ec));
+    if (ec) {
+        co_return NotFoundResponse(req.version());
+    }
+    res.set(http::field::content_type, entry.mime_type);
+    SetValidators(res, entry, entry.etag);
+    res.prepare_payload();
+    co_return res;
+}
+#endif
 
-    // Если путь является директорией, добавляем к нему index.html
-    if (fs::is_directory(full_path)) {
-        full_path /= "index.html"s;
+std::variant<FileRequestResult, FileRequestHandler::DiskRead> FileRequestHandler::PrepareResponse(
+        const StaticContent &content, const HttpRequest &req) const {
+    auto resolved = ResolveFile(content, req);
+    if (auto* error = std::get_if<StringResponse>(&resolved)) {
+        return FileRequestResult{std::move(*error)};
     }
+    const StaticEntry& entry = *std::get<const StaticEntry*>(resolved);
+    const CachedFile* cached = content.cache.Find(entry);
+    const std::string& etag = cached ? cached->etag : entry.etag;
 
-    // Проверка, что запрашиваемый путь находится внутри каталога статических файлов
-    if (!IsSubPath(full_path, static_root)) {
-        return BadRequestResponse(req.version());
+    if (IsNotModified(req, entry, etag)) {
+        return FileRequestResult{MakeNotModifiedResponse(req, entry, cached)};
     }
 
-    // Проверка, что запрашиваемый файл существует
-    if (!fs::exists(full_path)) {
-        return NotFoundResponse(req.version());
+    std::optional<ByteRange> range;
+    const ParsedRange parsed_range = GetRequestedRange(req, entry, etag);
+    if (parsed_range.status == ParsedRange::Status::UNSATISFIABLE) {
+        return FileRequestResult{MakeRangeNotSatisfiableResponse(req.version(), entry.size)};
+    }
+    if (parsed_range.status == ParsedRange::Status::SATISFIABLE) {
+        range = parsed_range.range;
     }
 
-    // Определяем MIME-тип по расширению файла
-    std::string extension = full_path.extension().string();
-    std::string mime_type = GetMimeType(extension);
+    if (cached) {
+        return FileRequestResult{MakeCachedResponse(req, entry, *cached, range)};
+    }
+    return DiskRead{&entry, range};
+}
 
-    // Открываем файл
+FileRequestResult FileRequestHandler::ReadFromDisk(const HttpRequest &req, const StaticEntry &entry,
+                                                   const std::optional<ByteRange> &range) const {
+    // Открываем файл. Он мог быть удалён после построения индекса
     beast::error_code ec;
+    if (range) {
+        FileRangeBody::value_type body;
+        body.open(entry.path.c_str(), range->offset, range->length, ec);
+        if (ec) {
+            return NotFoundResponse(req.version());
+        }
+        FileRangeResponse res{http::status::partial_content, req.version()};
+        res.set(http::field::content_type, entry.mime_type);
+        res.set(http::field::content_range, MakeContentRange(*range, entry.size));
+        SetValidators(res, entry, entry.etag);
+        res.body() = std::move(body);
+        res.prepare_payload();
+        return res;
+    }
+    if (UseSendfile(entry)) {
+        FileRangeBody::value_type body;
+        body.open(entry.path.c_str(), ec);
+        if (ec) {
+            return NotFoundResponse(req.version());
+        }
+        FileRangeResponse res{http::status::ok, req.version()};
+        res.set(http::field::content_type, entry.mime_type);
+        SetValidators(res, entry, entry.etag);
+        res.body() = std::move(body);
+        res.prepare_payload();
+        return res;
+    }
+
     http::file_body::value_type file;
-    file.open(full_path.string().c_str(), beast::file_mode::read, ec);
+    file.open(entry.path.c_str(), beast::file_mode::read, ec);
     if (ec) {
         return NotFoundResponse(req.version());
     }
 
     // Формируем ответ с файлом
     http::response<http::file_body> res{http::status::ok, req.version()};
-    res.set(http::field::content_type, mime_type);
+    res.set(http::field::content_type, entry.mime_type);
+    SetValidators(res, entry, entry.etag);
     res.body() = std::move(file);
     res.prepare_payload();
 
     return res;
 }
 
-FileRequestHandler::FileRequestHandler(fs::path root)
-        : root_(std::move(root)) {}
+bool FileRequestHandler::IsNotModified(const HttpRequest &req, const StaticEntry &entry, std::string_view etag) {
+    // If-Modified-Since учитывается, только если клиент не прислал If-None-Match
+    const auto if_none_match = req[http::field::if_none_match];
+    if (!if_none_match.empty()) {
+        return MatchesEtag(if_none_match, etag);
+    }
+    const auto if_modified_since = req[http::field::if_modified_since];
+    if (if_modified_since.empty()) {
+        return false;
+    }
+    const auto since = ParseHttpDate(if_modified_since);
+    return since && entry.modified_at <= *since;
+}
+
+ParsedRange FileRequestHandler::GetRequestedRange(const HttpRequest &req, const StaticEntry &entry,
+                                                  std::string_view etag) {
+    const auto range = req[http::field::range];
+    if (range.empty()) {
+        return {};
+    }
+    // Если файл изменился с момента, указанного в If-Range, клиент получает его целиком
+    const auto if_range = req[http::field::if_range];
+    if (!if_range.empty() && if_range != etag && if_range != entry.last_modified) {
+        return {};
+    }
+    return ParseRange(range, entry.size);
+}
+
+bool FileRequestHandler::UseGzip(const HttpRequest &req, const CachedFile &file) {
+    return file.gzip && compression::AcceptsGzip(req[http::field::accept_encoding]);
+}
 
-FileRequestResult RequestHandler::HandleFileRequest(const HttpRequest &req) {
+std::string FileRequestHandler::MakeContentRange(const ByteRange &range, uint64_t size) {
+    return "bytes "s + std::to_string(range.offset) + "-"s + std::to_string(range.offset + range.length - 1) + "/"s
+           + std::to_string(size);
+}
+
+SharedBufferResponse FileRequestHandler::MakeCachedResponse(const HttpRequest &req, const StaticEntry &entry,
+                                                            const CachedFile &file,
+                                                            const std::optional<ByteRange> &range) const {
+    SharedBufferResponse res{range ? http::status::partial_content : http::status::ok, req.version()};
+    res.set(http::field::content_type, file.mime_type);
+    if (file.gzip) {
+        res.set(http::field::vary, "Accept-Encoding");
+    }
+    if (range) {
+        // Диапазон задаётся в байтах исходного файла, поэтому фрагмент отдаётся без сжатия
+        SetValidators(res, entry, file.etag);
+        res.set(http::field::content_range, MakeContentRange(*range, file.plain->size()));
+        res.body() = SharedBufferBody::value_type{file.plain, range->offset, range->length};
+    } else if (UseGzip(req, file)) {
+        // Сжатое представление отличается от файла побайтно, поэтому его ETag слабый
+        SetValidators(res, entry, "W/"s + file.etag);
+        res.set(http::field::content_encoding, "gzip");
+        res.body() = SharedBufferBody::value_type{file.gzip};
+    } else {
+        SetValidators(res, entry, file.etag);
+        res.body() = SharedBufferBody::value_type{file.plain};
+    }
+    res.prepare_payload();
+    return res;
+}
+
+EmptyResponse FileRequestHandler::MakeNotModifiedResponse(const HttpRequest &req, const StaticEntry &entry,
+                                                          const CachedFile *cached) const {
+    EmptyResponse res{http::status::not_modified, req.version()};
+    if (!cached) {
+        SetValidators(res, entry, entry.etag);
+    } else if (UseGzip(req, *cached)) {
+        SetValidators(res, entry, "W/"s + cached->etag);
+    } else {
+        SetValidators(res, entry, cached->etag);
+    }
+    if (cached && cached->gzip) {
+        res.set(http::field::vary, "Accept-Encoding");
+    }
+    return res;
+}
+
+EmptyResponse FileRequestHandler::MakeRangeNotSatisfiableResponse(unsigned version, uint64_t size) const {
+    EmptyResponse res{http::status::range_not_satisfiable, version};
+    res.set(http::field::content_range, "bytes */"s + std::to_string(size));
+    res.prepare_payload();
+    return res;
+}
+
+FileRequestHandler::FileRequestHandler(fs::path root, StaticFileSettings settings)
+        : root_(std::move(root))
+        , settings_(settings) {
+#ifndef BOOST_ASIO_HAS_FILE
+    if (settings_.async_reads) {
+        throw std::runtime_error("Asynchronous file reads require a build with io_uring support"s);
+    }
+#endif
+    content_.store(LoadContent(), std::memory_order_release);
+    if (settings_.watch) {
+        watcher_ = std::make_unique<StaticIndexWatcher>(root_, 500ms, [this] {
+            Rebuild();
+        });
+    }
+}
+
+void FileRequestHandler::Rebuild() {
+    content_.store(LoadContent(), std::memory_order_release);
+}
+
+std::shared_ptr<const FileRequestHandler::StaticContent> FileRequestHandler::LoadContent() const {
+    auto content = std::make_shared<StaticContent>();
+    // Каталог может отсутствовать: тогда на все запросы к файлам отвечаем 404
+    if (fs::is_directory(root_)) {
+        content->index = StaticIndex(root_, [](const fs::path& path) {
+            return GetMimeType(path.extension().string());
+        });
+        if (settings_.cache.max_total_size > 0) {
+            content->cache = StaticFileCache(content->index, settings_.cache);
+        }
+    }
+    return content;
+}
+
+std::shared_ptr<const FileRequestHandler::StaticContent> FileRequestHandler::GetContent() const {
+    return content_.load(std::memory_order_acquire);
+}
+
+uint64_t FileRequestHandler::GetCacheSize() const {
+    return GetContent()->cache.GetTotalSize();
+}
+
+net::awaitable<FileRequestResult> RequestHandler::HandleFileRequest(const HttpRequest &req) {
+#ifdef BOOST_ASIO_HAS_FILE
+    auto result = file_handler_.IsAsync() ? co_await file_handler_.GetFileResponseAsync(req)
+                                          : file_handler_.GetFileResponse(req);
+#else
     auto result = file_handler_.GetFileResponse(req);
-    unsigned int response_status_code;
-    std::string content_type;
-    std::visit([&response_status_code, &content_type](const auto& value) {
-        response_status_code = value.result_int();
-        content_type = value[http::field::content_type];
-    }, result);
-    response_status_code_ = response_status_code;
-    content_type_ = std::move(content_type);
-    return result;
+#endif
+    co_return result;
 }
 
-StringResponse RequestHandler::HandleApiRequest(const HttpRequest &req) {
-    StringResponse result = api_handler_.GetApiResponse(req);
-    response_status_code_ = result.result_int();
-    content_type_ = result[http::field::content_type];
-    return result;
+bool RequestHandler::IsMetricsRequest(const HttpRequest &req) {
+    std::string_view target = req.target();
+    return target.substr(0, target.find('?')) == "/metrics"sv;
+}
+
+StringResponse RequestHandler::MakeTextResponse(const HttpRequest &req, http::status status, std::string_view text) {
+    StringResponse res{status, req.version()};
+    res.set(http::field::content_type, "text/plain");
+    if (status == http::status::method_not_allowed) {
+        res.set(http::field::allow, "GET, HEAD");
+    }
+    res.keep_alive(req.keep_alive());
+    res.body() = text;
+    res.prepare_payload();
+    return res;
 }
 
-server_logging::LogData RequestHandler::GetLogInfo() const {
-    return {response_status_code_, content_type_};
+StringResponse RequestHandler::HandleMetricsRequest(const HttpRequest &req) const {
+    if (req.method() != http::verb::get && req.method() != http::verb::head) {
+        return MakeTextResponse(req, http::status::method_not_allowed, "Method Not Allowed"sv);
+    }
+
+    std::string body;
+    metrics::GetServerMetrics().Write(body);
+    metrics::TextWriter writer{body};
+    metrics::GetTickProfiler().WriteMetrics(writer);
+    // Очередь к api_strand принадлежит обработчику, поэтому её показатели дописываются здесь
+    const auto stats = admission_.GetStats();
+    writer.WriteHeader("game_server_api_queue_depth"sv, "gauge"sv, "API requests waiting for api_strand"sv);
+    writer.WriteValue("game_server_api_queue_depth"sv, {}, static_cast<uint64_t>(stats.queue_depth));
+    writer.WriteHeader("game_server_api_rejected_total"sv, "counter"sv, "API requests rejected as overloaded"sv);
+    writer.WriteValue("game_server_api_rejected_total"sv, R"(reason="queue_depth")"sv, stats.rejected_by_depth);
+    writer.WriteValue("game_server_api_rejected_total"sv, R"(reason="queue_wait")"sv, stats.rejected_by_wait);
+
+    StringResponse res{http::status::ok, req.version()};
+    res.set(http::field::content_type, "text/plain; version=0.0.4");
+    res.set(http::field::cache_control, "no-cache");
+    res.keep_alive(req.keep_alive());
+    const auto size = body.size();
+    if (req.method() != http::verb::head) {
+        res.body() = std::move(body);
+    }
+    res.content_length(size);
+    return res;
+}
+
+bool RequestHandler::IsAdminAuthorized(const HttpRequest &req) const {
+    constexpr std::string_view BEARER_PREFIX = "Bearer "sv;
+    const std::string_view authorization = req[http::field::authorization];
+    if (admin_.token.empty() || !authorization.starts_with(BEARER_PREFIX)) {
+        return false;
+    }
+    return EqualConstantTime(authorization.substr(BEARER_PREFIX.size()), admin_.token);
+}
+
+net::awaitable<StringResponse> RequestHandler::HandleAdminRequest(const HttpRequest &req) const {
+    // Токен проверяется до разбора пути, поэтому без токена нельзя узнать и набор служебных точек входа
+    if (!IsAdminAuthorized(req)) {
+        auto res = MakeTextResponse(req, http::status::unauthorized, "Unauthorized"sv);
+        res.set(http::field::www_authenticate, "Bearer");
+        co_return res;
+    }
+    std::string_view target = req.target();
+    std::string_view query;
+    if (const auto question = target.find('?'); question != std::string_view::npos) {
+        query = target.substr(question + 1);
+        target = target.substr(0, question);
+    }
+    if (target != "/admin/tick-trace"sv && target != "/admin/profile"sv && target != "/admin/memory"sv
+        && target != "/admin/malloc-info"sv) {
+        co_return MakeTextResponse(req, http::status::not_found, "Not Found"sv);
+    }
+    if (req.method() != http::verb::get && req.method() != http::verb::head) {
+        co_return MakeTextResponse(req, http::status::method_not_allowed, "Method Not Allowed"sv);
+    }
+    if (target == "/admin/profile"sv) {
+        co_return co_await GetCpuProfile(req, query);
+    }
+    if (target == "/admin/memory"sv) {
+        co_return co_await GetMemoryUsage(req);
+    }
+    if (target == "/admin/malloc-info"sv) {
+        co_return MakeAdminResponse(req, "application/xml"sv, memory_usage::GetMallocInfo(), {});
+    }
+    std::string trace;
+    metrics::GetTickProfiler().WriteChromeTrace(trace);
+    co_return MakeAdminResponse(req, "application/json"sv, std::move(trace), "tick-trace.json"sv);
+}
+
+StringResponse RequestHandler::MakeAdminResponse(const HttpRequest &req, std::string_view content_type,
+                                                 std::string body, std::string_view file_name) {
+    StringResponse res{http::status::ok, req.version()};
+    res.set(http::field::content_type, content_type);
+    res.set(http::field::cache_control, "no-cache");
+    if (!file_name.empty()) {
+        res.set(http::field::content_disposition, "attachment; filename=\""s.append(file_name).append("\""sv));
+    }
+    res.keep_alive(req.keep_alive());
+    const auto size = body.size();
+    if (req.method() != http::verb::head) {
+        res.body() = std::move(body);
+    }
+    res.content_length(size);
+    return res;
+}
+
+net::awaitable<StringResponse> RequestHandler::GetCpuProfile(const HttpRequest &req, std::string_view query) {
+    int seconds = DEFAULT_PROFILE_SECONDS;
+    bool valid_params = true;
+    ForEachQueryParam(query, [&](std::string_view key, std::string_view value) {
+        if (key == "seconds"sv) {
+            valid_params = ParseInt(value, seconds) && valid_params;
+        }
+    });
+    if (!valid_params || seconds < 1 || seconds > MAX_PROFILE_SECONDS) {
+        co_return MakeTextResponse(req, http::status::bad_request, "Invalid parameter seconds"sv);
+    }
+
+    auto& profiler = metrics::GetCpuProfiler();
+    if (!profiler.Start(PROFILE_FREQUENCY, std::chrono::seconds{seconds})) {
+        co_return MakeTextResponse(req, http::status::conflict, "Profiling is already running"sv);
+    }
+    // Сопрограмма ждёт по таймеру, не занимая поток. Профилирование останавливается и при отмене ожидания
+    net::steady_timer timer{co_await net::this_coro::executor, std::chrono::seconds{seconds}};
+    sys::error_code ec;
+    co_await timer.async_wait(net::redirect_error(net::use_awaitable, ec));
+    co_return MakeAdminResponse(req, "text/plain"sv, profiler.Stop(), "profile.folded"sv);
+}
+
+net::awaitable<StringResponse> RequestHandler::GetMemoryUsage(const HttpRequest &req) const {
+    // Игровое состояние и кэш ответов API меняются только внутри api_strand
+    auto estimate = [this]() -> net::awaitable<json::object> {
+        co_return api_handler_.EstimateMemoryUsage();
+    };
+    json::object usage = co_await net::co_spawn(api_strand_, std::move(estimate), net::use_awaitable);
+
+    const uint64_t static_file_cache = file_handler_.GetCacheSize();
+    usage["staticFileCache"] = static_file_cache;
+    usage["total"] = usage["total"].to_number<uint64_t>() + static_file_cache;
+    const auto allocator = memory_usage::GetAllocatorStats();
+    usage["allocator"] = json::object{
+            {"heapSize", allocator.heap_size},
+            {"mmapped", allocator.mmapped},
+            {"inUse", allocator.in_use},
+            {"free", allocator.free},
+            {"releasable", allocator.releasable},
+    };
+    co_return MakeAdminResponse(req, "application/json"sv, json::serialize(usage), {});
+}
+
+net::awaitable<StringResponse> RequestHandler::HandleApiRequestInStrand(const HttpRequest& req, unsigned version,
+                                                                        bool keep_alive,
+                                                                        server_logging::RequestContext& context) {
+    // При переполненной очереди к api_strand отвечаем сразу, не дожидаясь strand
+    const auto enqueued_at = admission_.TryEnqueue();
+    if (!enqueued_at) {
+        co_return ReportOverloaded(version, keep_alive);
+    }
+    context.strand_enqueued_at = *enqueued_at;
+    // Запрос и контекст живут в кадре вызывающей сопрограммы, которая ждёт завершения обработки
+    co_return co_await net::co_spawn(
+            api_strand_,
+            [this, &req, &context, version, keep_alive, enqueued_at = *enqueued_at]() -> net::awaitable<StringResponse> {
+                // Этот assert не выстрелит, так как сопрограмма выполняется внутри strand
+                assert(api_strand_.running_in_this_thread());
+                const auto started_at = server_logging::RequestContext::Clock::now();
+                context.strand_started_at = started_at;
+                // Клиент, чей запрос слишком долго ждал в очереди, скорее всего уже не ждёт ответа
+                if (!admission_.Dequeue(enqueued_at, started_at)) {
+                    co_return ReportOverloaded(version, keep_alive);
+                }
+                co_return api_handler_.GetApiResponse(req);
+            },
+            net::use_awaitable);
 }
 
 RequestHandler::RequestHandler(model::Game &game, app::Application &app, fs::path root, Strand api_strand,
-                               int tick_period)
-        : file_handler_(std::move(root)),
-          api_handler_(game, app, tick_period),
-          api_strand_(std::move(api_strand)) {
+                               int tick_period, ApiCompressionSettings compression, AdmissionSettings admission,
+                               StaticFileSettings static_files, AdminSettings admin)
+        : file_handler_(std::move(root), static_files),
+          api_handler_(game, app, tick_period, compression),
+          api_strand_(std::move(api_strand)),
+          admission_(admission),
+          admin_(admin) {
 }
 
 StringResponse RequestHandler::ReportServerError(unsigned int version, bool keep_alive) const {
@@ -172,137 +593,262 @@ StringResponse RequestHandler::ReportServerError(unsigned int version, bool keep
     return res;
 }
 
+StringResponse RequestHandler::ReportOverloaded(unsigned int version, bool keep_alive) const {
+    StringResponse res{http::status::service_unavailable, version};
+    res.set(http::field::content_type, "application/json");
+    res.set(http::field::cache_control, "no-cache");
+    res.set(http::field::retry_after, std::to_string(admission_.GetRetryAfter().count()));
+    res.keep_alive(keep_alive);
+    res.body() = R"({"code":"serviceUnavailable","message":"Server is overloaded"})"s;
+    res.prepare_payload();
+    return res;
+}
+
 template<typename... Headers>
 StringResponse ApiRequestHandler::GetErrorResponse(const HttpRequest &req, http::status status, const std::string &code,
                                                    const std::string &message, const Headers&... headers) const {
-    json::object error_json{
+    RequestArena arena;
+    json::object error_json({
             {"code"s, code},
             {"message"s, message}
-    };
+    }, arena.Storage());
     StringResponse res{status, req.version()};
     res.set(http::field::content_type, "application/json");
 //    res.set(http::field::cache_control, "no-cache");
     (res.set(headers.first, headers.second), ...);
-    res.body() = json::serialize(error_json);
+    res.body() = SerializeJson(error_json);
     res.prepare_payload();
 
     return res;
 }
 
+StringResponse ApiRequestHandler::GetMethodNotAllowed(const HttpRequest &req, ApiRoute route,
+                                                      const std::string &message) const {
+    return GetErrorResponse(req, http::status::method_not_allowed, "invalidMethod"s, message,
+                            std::make_pair(http::field::allow, std::string{GetRouteSpec(route).allow}),
+                            std::make_pair(http::field::cache_control, "no-cache"s));
+}
+
 StringResponse ApiRequestHandler::GetApiResponse(const HttpRequest &req) const {
-    const std::string target = std::string(req.target());
-    if (target == "/api/v1/maps"s || target == "/api/v1/maps/"s) {
-        return GetMaps(req);
-    } else if (target.starts_with("/api/v1/maps/"s)) {
-        return GetMapById(req);
-    } else if (target.starts_with("/api/v1/game/records"s)) {
-        return GetTableOfRecords(req);
-    } else if (target == "/api/v1/game/join"s || target == "/api/v1/game/join/"s) {
-        return HandleJoinGame(req);
-    } else if (target == "/api/v1/game/players"s || target == "/api/v1/game/players/"s) {
-        return GetPlayers(req);
-    } else if (target == "/api/v1/game/state"s || target == "/api/v1/game/state/"s) {
-        return GetGameState(req);
-    } else if (target == "/api/v1/game/player/action"s || target == "/api/v1/game/player/action/"s) {
-        return HandleMovePlayers(req);
-    } else if (target == "/api/v1/game/tick"s || target == "/api/v1/game/tick/"s) {
-        if (tick_period_) {
-            return GetErrorResponse(req, http::status::bad_request, "badRequest"s, "Invalid endpoint"s);
-        } else {
+    // Маршрут определяется одним проходом по цели запроса без копирования строк
+    const RouteMatch match = MatchApiRoute(req.target());
+    switch (match.route) {
+        case ApiRoute::MAPS:
+            return GetMaps(req);
+        case ApiRoute::MAP_BY_ID:
+            return GetMapById(req, match.param);
+        case ApiRoute::RECORDS:
+            // Обрабатывается вне api_strand сопрограммой GetTableOfRecords
+            break;
+        case ApiRoute::JOIN:
+            return HandleJoinGame(req);
+        case ApiRoute::PLAYERS:
+            return GetPlayers(req);
+        case ApiRoute::STATE:
+            return GetGameState(req);
+        case ApiRoute::ACTION:
+            return HandleMovePlayers(req);
+        case ApiRoute::TICK:
+            if (tick_period_) {
+                return GetErrorResponse(req, http::status::bad_request, "badRequest"s, "Invalid endpoint"s);
+            }
             return HandleTimeControl(req);
-        }
-    } else if (target.starts_with("/api/")) {
-        return GetErrorResponse(req, http::status::bad_request, "badRequest"s, "Bad request"s);
+        case ApiRoute::UNKNOWN:
+            break;
     }
-    return GetErrorResponse(req, http::status::bad_request, "badRequest"s, "Unknown API endpoint"s);
+    return GetErrorResponse(req, http::status::bad_request, "badRequest"s, "Bad request"s);
 }
 
 StringResponse ApiRequestHandler::GetMaps(const HttpRequest &req) const {
 
     // Проверяем метод GET или HEAD
-    if (req.method() != http::verb::get && req.method() != http::verb::head) {
-        return GetErrorResponse(req, http::status::method_not_allowed, "invalidMethod"s, "Invalid method"s,
-                                std::make_pair(http::field::allow, "GET, HEAD"s),
-                                std::make_pair(http::field::cache_control, "no-cache"s));
-    }
-
-    json::array maps_json;
-    for (const auto& map : game_.GetMaps()) {
-        maps_json.push_back({
-            {OFFICE_ID, *map.GetId()},
-            {"name"s, map.GetName()}
-        });
+    if (!IsMethodAllowed(ApiRoute::MAPS, req.method())) {
+        return GetMethodNotAllowed(req, ApiRoute::MAPS, "Invalid method"s);
     }
 
-    return GetJsonResponse(req, maps_json);
+    return GetEncodedResponse(req, maps_body_);
 }
 
-StringResponse ApiRequestHandler::GetMapById(const HttpRequest &req) const {
+StringResponse ApiRequestHandler::GetMapById(const HttpRequest &req, std::string_view map_id) const {
     // Проверяем метод GET или HEAD
-    if (req.method() != http::verb::get && req.method() != http::verb::head) {
-        return GetErrorResponse(req, http::status::method_not_allowed, "invalidMethod"s, "Invalid method"s,
-                                std::make_pair(http::field::allow, "GET, HEAD"s),
-                                std::make_pair(http::field::cache_control, "no-cache"s));
+    if (!IsMethodAllowed(ApiRoute::MAP_BY_ID, req.method())) {
+        return GetMethodNotAllowed(req, ApiRoute::MAP_BY_ID, "Invalid method"s);
     }
 
-    const std::string target = std::string(req.target());
-    const std::string map_id_str = target.substr(strlen("/api/v1/maps/"));
-    const auto map_id = model::Map::Id{map_id_str};
-
-    const json::object map_json = app_.GetMapsById(map_id);
-    if (map_json.empty()) {
+    const auto it = map_bodies_.find(map_id);
+    if (it == map_bodies_.end()) {
         return GetErrorResponse(req, http::status::not_found, "mapNotFound"s, "Map not found"s,
             std::make_pair(http::field::cache_control, "no-cache"s));
     }
 
-    return GetJsonResponse(req, map_json);
+    return GetEncodedResponse(req, it->second);
 }
 
-StringResponse ApiRequestHandler::GetTableOfRecords(const HttpRequest &req) const {
+StringResponse ApiRequestHandler::GetTableOfRecords(const HttpRequest &req, std::string_view query) const {
     // Проверяем метод GET
-    if (req.method() != http::verb::get) {
-        return GetErrorResponse(req, http::status::method_not_allowed, "invalidMethod"s, "Invalid request"s,
-                                std::make_pair(http::field::allow, "GET"s),
-                                std::make_pair(http::field::cache_control, "no-cache"s));
-    }
-    const std::string target = std::string(req.target());
-    std::string query_string;
-    if (target != "/api/v1/game/records") {
-        query_string = target.substr(strlen("/api/v1/game/records?"));
+    if (!IsMethodAllowed(ApiRoute::RECORDS, req.method())) {
+        return GetMethodNotAllowed(req, ApiRoute::RECORDS, "Invalid request"s);
     }
     int start = 0;
     int max_items = 100;
-    if (!query_string.empty()) {
-        // Парсим URL-строку запроса
-        auto params = ParseQueryString(query_string);
-        try {
-            for (const auto& [key, value] : params) {
-                if (key == "start"s) {
-                    start = std::stoi(value);
-                    continue;
-                }
-                if (key == "maxItems"s) {
-                    max_items = std::stoi(value);
-                }
+    std::string_view cursor;
+    // Разбираем параметры запроса прямо в буфере цели запроса
+    bool valid_start = true;
+    bool valid_max_items = true;
+    ForEachQueryParam(query, [&](std::string_view key, std::string_view value) {
+        if (key == "start"sv) {
+            valid_start = ParseInt(value, start) && valid_start;
+        } else if (key == "maxItems"sv) {
+            valid_max_items = ParseInt(value, max_items) && valid_max_items;
+        } else if (key == "cursor"sv) {
+            cursor = value;
+        }
+    });
+    if (!valid_start || start < 0) {
+        return GetErrorResponse(req, http::status::bad_request, "Bad request"s, "Invalid parameter start"s);
+    }
+    // Проверяем на валидность параметр maxItems. Если maxItems > 100 возвращаем ошибку 400 Bad Request
+    if (!valid_max_items || max_items < 0 || max_items > 100) {
+        return GetErrorResponse(req, http::status::bad_request, "Bad request"s, "Invalid parameter maxItems"s);
+    }
+    // Курсор задаёт позицию вместо start
+    std::optional<leaderboard::Record> after;
+    if (!cursor.empty()) {
+        after = leaderboard::DecodeCursor(cursor);
+        if (!after || start != 0) {
+            return GetErrorResponse(req, http::status::bad_request, "Bad request"s, "Invalid parameter cursor"s);
+        }
+    }
+    const auto page = FindRecordsPage(static_cast<size_t>(start), static_cast<size_t>(max_items), cursor, after);
+    // Сжатый и несжатый варианты страницы различаются побайтно, поэтому ETag сжатого варианта слабый
+    const bool gzip = !page->body.gzip.empty() && compression::AcceptsGzip(req[http::field::accept_encoding]);
+    const std::string etag = (gzip ? "W/"s : ""s) + MakeRecordsEtag(page->version);
+    // Клиент, у которого уже есть страница текущей версии таблицы, получает ответ без тела
+    if (MatchesEtag(req[http::field::if_none_match], etag)) {
+        StringResponse res{http::status::not_modified, req.version()};
+        res.set(http::field::etag, etag);
+        res.set(http::field::cache_control, "no-cache");
+        res.set(http::field::vary, "Accept-Encoding");
+        res.keep_alive(req.keep_alive());
+        return res;
+    }
+    StringResponse res = GetEncodedResponse(req, page->body);
+    res.set(http::field::etag, etag);
+    // Следующая страница запрашивается по курсору, поэтому её выборка не зависит от глубины
+    if (!page->next_cursor.empty()) {
+        res.set(http::field::link, "</api/v1/game/records?cursor="s + page->next_cursor + "&maxItems="s
+                                   + std::to_string(max_items) + ">; rel=\"next\""s);
+    }
+    return res;
+}
+
+std::shared_ptr<const ApiRequestHandler::CachedRecordsPage> ApiRequestHandler::FindRecordsPage(
+        size_t start, size_t max_items, std::string_view cursor, const std::optional<leaderboard::Record>& after) const {
+    const auto key = std::make_tuple(std::string{cursor}, start, max_items);
+    const uint64_t version = app_.GetTableOfRecordsVersion();
+    {
+        std::lock_guard lock{records_cache_mutex_};
+        if (records_cache_version_ == version) {
+            if (const auto it = records_cache_.find(key); it != records_cache_.end()) {
+                return it->second;
             }
-        } catch (const std::exception&) {
-            return GetErrorResponse(req, http::status::bad_request, "Bad request"s, "Invalid parameter maxItems"s);
         }
-        // Проверяем на валидность параметр maxItems. Если maxItems > 100 возвращаем ошибку 400 Bad Request
-        if (max_items > 100) {
-            return GetErrorResponse(req, http::status::bad_request, "Bad request"s, "Invalid parameter maxItems"s);
+    }
+    // Страница сериализуется и сжимается вне блокировки, чтобы не задерживать чтение других страниц
+    auto page = app_.GetTableOfRecords(start, max_items, after);
+    auto cached = std::make_shared<const CachedRecordsPage>(
+            CachedRecordsPage{page.version, compression::EncodeBody(SerializeJson(page.records), compression_.records),
+                              std::move(page.next_cursor)});
+    std::lock_guard lock{records_cache_mutex_};
+    // Версия таблицы только растёт: страница старой версии отдаётся, но в кэш не попадает
+    if (page.version > records_cache_version_ || records_cache_.size() >= MAX_CACHED_RECORDS_PAGES) {
+        records_cache_.clear();
+        records_cache_version_ = std::max(records_cache_version_, page.version);
+    }
+    if (page.version == records_cache_version_) {
+        records_cache_.insert_or_assign(key, cached);
+    }
+    return cached;
+}
+
+json::object ApiRequestHandler::EstimateMemoryUsage() const {
+    using memory_usage::EstimateHeap;
+    const auto usage = app_.EstimateMemoryUsage();
+    uint64_t total = 0;
+
+    json::object maps;
+    for (const auto& [id, map] : usage.maps) {
+        maps[id] = json::object{
+                {"roads", map.roads},
+                {"buildings", map.buildings},
+                {"offices", map.offices},
+                {"cells", map.cells},
+                {"extraData", map.extra_data},
+                {"other", map.other},
+                {"total", map.Total()},
+        };
+        total += map.Total();
+    }
+    json::object sessions;
+    for (const auto& [map_id, session] : usage.sessions) {
+        sessions[map_id] = json::object{
+                {"dogCount", session.dog_count},
+                {"lootCount", session.loot_count},
+                {"dogs", session.dogs},
+                {"loots", session.loots},
+                {"total", session.Total()},
+        };
+        total += session.Total();
+    }
+
+    // Сериализованные ответы: описания карт готовятся при старте, состояние сессий - по запросам
+    const auto encoded_size = [](const compression::EncodedBody& body) {
+        return EstimateHeap(body.plain) + EstimateHeap(body.gzip);
+    };
+    size_t serialized = encoded_size(maps_body_) + EstimateHeap(map_bodies_) + EstimateHeap(state_cache_);
+    for (const auto& [id, body] : map_bodies_) {
+        serialized += EstimateHeap(id) + encoded_size(body);
+    }
+    for (const auto& [session, state] : state_cache_) {
+        serialized += encoded_size(state.body);
+    }
+    {
+        std::lock_guard lock{records_cache_mutex_};
+        serialized += EstimateHeap(records_cache_);
+        for (const auto& [key, page] : records_cache_) {
+            serialized += EstimateHeap(std::get<0>(key)) + memory_usage::EstimateSharedObject<CachedRecordsPage>()
+                          + encoded_size(page->body) + EstimateHeap(page->next_cursor);
         }
     }
-    // Получаем таблицу рекордов в json
-    const json::array table_of_records_json = app_.GetTableOfRecords(start, max_items);
-    // Формируем JSON-ответ
-    return GetJsonResponse(req, table_of_records_json);
+    total += usage.tokens + serialized;
+
+    return json::object{
+            {"maps", std::move(maps)},
+            {"sessions", std::move(sessions)},
+            {"tokens", usage.tokens},
+            {"serializedResponses", serialized},
+            {"total", total},
+    };
 }
 
-ApiRequestHandler::ApiRequestHandler(model::Game &game, app::Application &app, int tick_period)
+ApiRequestHandler::ApiRequestHandler(model::Game &game, app::Application &app, int tick_period,
+                                     ApiCompressionSettings compression)
         : game_(game)
         , app_(app)
-        , tick_period_(tick_period) {}
+        , tick_period_(tick_period)
+        , compression_(compression) {
+    // Карты не меняются во время работы сервера, поэтому их JSON сериализуется и сжимается один раз
+    json::array maps_json;
+    for (const auto& map : game_.GetMaps()) {
+        maps_json.push_back({
+            {OFFICE_ID, *map.GetId()},
+            {"name"s, map.GetName()}
+        });
+        map_bodies_.emplace(*map.GetId(),
+                            compression::EncodeBody(SerializeJson(app_.GetMapsById(map.GetId())), compression_.maps));
+    }
+    maps_body_ = compression::EncodeBody(SerializeJson(maps_json), compression_.maps);
+}
 
 StringResponse ApiRequestHandler::HandleJoinGame(const HttpRequest &req) const {
     // Проверяем заголовок Content-Type
@@ -312,31 +858,28 @@ StringResponse ApiRequestHandler::HandleJoinGame(const HttpRequest &req) const {
     }
 
     // Проверяем метод POST
-    if (req.method() != http::verb::post) {
-        return GetErrorResponse(req, http::status::method_not_allowed, "invalidMethod"s, "Method must be POST"s,
-                                std::make_pair(http::field::allow, "POST"s),
-                                std::make_pair(http::field::cache_control, "no-cache"s));
+    if (!IsMethodAllowed(ApiRoute::JOIN, req.method())) {
+        return GetMethodNotAllowed(req, ApiRoute::JOIN, "Method must be POST"s);
     }
 
-    // Парсим JSON-тело запроса
-    json::value body;
-    try {
-        body = json::parse(req.body());
-    } catch (const std::exception&) {
+    // Парсим JSON-тело запроса в арене запроса
+    RequestArena arena;
+    sys::error_code ec;
+    const json::value body = json::parse(req.body(), ec, arena.Storage());
+    if (ec) {
         return GetErrorResponse(req, http::status::bad_request, "invalidJson"s, "Invalid JSON format"s,
                                 std::make_pair(http::field::cache_control, "no-cache"s));
     }
 
     // Извлекаем поля user_name и map_id
-    std::string user_name;
-    std::string map_id_str;
-    try {
-        user_name = json::value_to<std::string>(body.at("userName"s));
-        map_id_str = json::value_to<std::string>(body.at("mapId"s));
-    } catch (const std::exception&) {
+    const json::string* user_name_json = FindStringField(body, "userName");
+    const json::string* map_id_json = FindStringField(body, "mapId");
+    if (!user_name_json || !map_id_json) {
         return GetErrorResponse(req, http::status::bad_request, "invalidArgument"s, "User_name and map_id are required"s,
                                 std::make_pair(http::field::cache_control, "no-cache"s));
     }
+    const std::string user_name{user_name_json->data(), user_name_json->size()};
+    const std::string map_id_str{map_id_json->data(), map_id_json->size()};
 
     // Проверяем поле user_name на пустое значение
     if (user_name.empty()) {
@@ -364,13 +907,11 @@ StringResponse ApiRequestHandler::HandleJoinGame(const HttpRequest &req) const {
 }
 
 StringResponse ApiRequestHandler::GetPlayers(const HttpRequest &req) const {
-    return ExecuteAuthorized(req, [req, this](const app::Token& token){
+    return ExecuteAuthorized(req, [&req, this](const app::Token& token){
 
         // Проверяем метод GET или HEAD
-        if (req.method() != http::verb::get && req.method() != http::verb::head) {
-            return GetErrorResponse(req, http::status::method_not_allowed, "invalidMethod"s, "Invalid method"s,
-                                    std::make_pair(http::field::allow, "GET, HEAD"s),
-                                    std::make_pair(http::field::cache_control, "no-cache"s));
+        if (!IsMethodAllowed(ApiRoute::PLAYERS, req.method())) {
+            return GetMethodNotAllowed(req, ApiRoute::PLAYERS, "Invalid method"s);
         }
 
         // Проверяем наличие игроков по предъявленному токену
@@ -394,23 +935,51 @@ StringResponse ApiRequestHandler::GetPlayers(const HttpRequest &req) const {
 
 StringResponse ApiRequestHandler::GetGameState(const HttpRequest &req) const {
     // Проверка метода GET, HEAD
-    if (req.method() != http::verb::get && req.method() != http::verb::head) {
-        return GetErrorResponse(req, http::status::method_not_allowed, "invalidMethod"s, "Invalid method"s,
-                                std::make_pair(http::field::allow, "GET, HEAD"s),
-                                std::make_pair(http::field::cache_control, "no-cache"s));
+    if (!IsMethodAllowed(ApiRoute::STATE, req.method())) {
+        return GetMethodNotAllowed(req, ApiRoute::STATE, "Invalid method"s);
     }
-    return ExecuteAuthorized(req, [req, this](const app::Token& token) {
+    return ExecuteAuthorized(req, [&req, this](const app::Token& token) {
 
-        const json::object json_body = app_.GameState(token);
-        if (json_body.empty()) {
+        const compression::EncodedBody* state_body = FindStateBody(token);
+        if (!state_body) {
             return GetErrorResponse(req, http::status::unauthorized, "unknownToken"s, "Player token has not been found"s,
                                     std::make_pair(http::field::cache_control, "no-cache"s));
         }
 
-        return GetJsonResponse(req, json_body);
+        return GetEncodedResponse(req, *state_body);
     });
 }
 
+const compression::EncodedBody* ApiRequestHandler::FindStateBody(const app::Token &token) const {
+    const auto session = app_.GetDogTokens().FindSessionByToken(token);
+    if (!session) {
+        return nullptr;
+    }
+    // Состояние одинаково для всех игроков сессии, поэтому сериализуем и сжимаем его
+    // один раз для каждой версии состояния сессии и отдаём всем клиентам
+    const auto state_version = session->GetStateVersion();
+    if (!state_cache_.contains(session.get())) {
+        std::erase_if(state_cache_, [](const auto& item) {
+            return item.second.session.expired();
+        });
+    }
+    auto [it, inserted] = state_cache_.try_emplace(session.get());
+    CachedState& cached = it->second;
+    if (inserted) {
+        cached.session = session;
+    }
+    if (inserted || cached.version != state_version) {
+        const json::object json_body = app_.GameState(token);
+        if (json_body.empty()) {
+            state_cache_.erase(it);
+            return nullptr;
+        }
+        cached.body = compression::EncodeBody(SerializeJson(json_body), compression_.state);
+        cached.version = state_version;
+    }
+    return &cached.body;
+}
+
 std::optional<app::Token> ApiRequestHandler::TryExtractToken(const HttpRequest &req) const {
     // Проверяем наличие и валидность заголовка Authorization
     if (req.find(http::field::authorization) == req.end() || !req[http::field::authorization].starts_with("Bearer "s)) {
@@ -429,38 +998,34 @@ std::optional<app::Token> ApiRequestHandler::TryExtractToken(const HttpRequest &
 }
 
 StringResponse ApiRequestHandler::HandleMovePlayers(const HttpRequest &req) const {
-    return ExecuteAuthorized(req, [req, this](const app::Token& token) {
+    return ExecuteAuthorized(req, [&req, this](const app::Token& token) {
 
         // Проверка метода POST
-        if (req.method() != http::verb::post) {
-            return GetErrorResponse(req, http::status::method_not_allowed, "invalidMethod"s, "Invalid method"s,
-                                    std::make_pair(http::field::allow, "POST"s),
-                                    std::make_pair(http::field::cache_control, "no-cache"s));
+        if (!IsMethodAllowed(ApiRoute::ACTION, req.method())) {
+            return GetMethodNotAllowed(req, ApiRoute::ACTION, "Invalid method"s);
         }
         // Проверка заголовка Content-Type
         if (req["Content-Type"] != "application/json") {
             return GetErrorResponse(req, http::status::bad_request, "invalidArgument"s, "Invalid content type"s,
                                     std::make_pair(http::field::cache_control, "no-cache"s));
         }
-        // Парсим JSON
-        json::value body;
-        try {
-            body = boost::json::parse(req.body());
-        } catch (const std::exception&) {
+        // Парсим JSON в арене запроса
+        RequestArena arena;
+        sys::error_code ec;
+        const json::value body = json::parse(req.body(), ec, arena.Storage());
+        if (ec) {
             return GetErrorResponse(req, http::status::bad_request, "invalidArgument"s, "Invalid JSON"s,
                                     std::make_pair(http::field::cache_control, "no-cache"s));
         }
         // Пытаемся получить значение move
-        std::string move;
-        try {
-            move = json::value_to<std::string>(body.at("move"));
-        } catch (const std::exception&) {
+        const json::string* move = FindStringField(body, "move");
+        if (!move) {
             return GetErrorResponse(req, http::status::bad_request, "invalidArgument"s, "Failed to parse move request JSON"s,
                                     std::make_pair(http::field::cache_control, "no-cache"s));
         }
 
         // Обрабатываем move и получаем результат
-        auto move_players_result = app_.MovePlayers(token, move);
+        auto move_players_result = app_.MovePlayers(token, std::string_view{move->data(), move->size()});
         if (move_players_result == app::MovePlayersResult::UNKNOWN_TOKEN) {
             return GetErrorResponse(req, http::status::unauthorized, "unknownToken"s, "Player token has not been found"s,
                                     std::make_pair(http::field::cache_control, "no-cache"s));
@@ -481,34 +1046,30 @@ StringResponse ApiRequestHandler::HandleTimeControl(const HttpRequest &req) cons
     }
 
     // Проверяем метод POST
-    if (req.method() != http::verb::post) {
-        return GetErrorResponse(req, http::status::method_not_allowed, "invalidMethod"s, "Method must be POST"s,
-                                std::make_pair(http::field::allow, "POST"s),
-                                std::make_pair(http::field::cache_control, "no-cache"s));
+    if (!IsMethodAllowed(ApiRoute::TICK, req.method())) {
+        return GetMethodNotAllowed(req, ApiRoute::TICK, "Method must be POST"s);
     }
 
-    // Парсим JSON
-    json::value body;
-    try {
-        body = boost::json::parse(req.body());
-    } catch (const std::exception&) {
+    // Парсим JSON в арене запроса
+    RequestArena arena;
+    sys::error_code ec;
+    const json::value body = json::parse(req.body(), ec, arena.Storage());
+    if (ec) {
         return GetErrorResponse(req, http::status::bad_request, "invalidArgument"s, "Invalid JSON"s,
                                 std::make_pair(http::field::cache_control, "no-cache"s));
     }
     // Пытаемся получить значение timeDelta
-    int time_delta;
-    try {
-        if (!body.at("timeDelta"s).is_int64()) {
-            return GetErrorResponse(req, http::status::bad_request, "invalidArgument"s,
-                                    "'timeDelta' must be an integer"s,
-                                    std::make_pair(http::field::cache_control, "no-cache"s));
-        }
-        time_delta = json::value_to<int>(body.at("timeDelta"s));
-    } catch (const std::exception&) {
+    const json::value* time_delta = body.is_object() ? body.get_object().if_contains("timeDelta") : nullptr;
+    if (!time_delta) {
         return GetErrorResponse(req, http::status::bad_request, "invalidArgument"s, "Failed to parse tick request JSON"s,
                                 std::make_pair(http::field::cache_control, "no-cache"s));
     }
-    std::chrono::milliseconds time_delta_ms(time_delta);
+    if (!time_delta->is_int64()) {
+        return GetErrorResponse(req, http::status::bad_request, "invalidArgument"s,
+                                "'timeDelta' must be an integer"s,
+                                std::make_pair(http::field::cache_control, "no-cache"s));
+    }
+    std::chrono::milliseconds time_delta_ms(time_delta->get_int64());
     app_.Tick(time_delta_ms);
 
     return GetJsonResponse(req, boost::json::object{});
@@ -524,41 +1085,36 @@ StringResponse ApiRequestHandler::ExecuteAuthorized(const HttpRequest &req, Fn &
     }
 }
 
+template<typename JsonBody>
+StringResponse ApiRequestHandler::GetJsonResponse(const HttpRequest &req, const JsonBody &body,
+                                                  const compression::GzipSettings &settings) const {
+    return GetEncodedResponse(req, compression::EncodeBody(SerializeJson(body), settings));
+}
+
 template<typename JsonBody>
 StringResponse ApiRequestHandler::GetJsonResponse(const HttpRequest &req, const JsonBody &body) const {
+    return GetJsonResponse(req, body, compression_.other);
+}
+
+template<typename Body>
+StringResponse ApiRequestHandler::GetEncodedResponse(const HttpRequest &req, Body &&body) const {
     StringResponse res{http::status::ok, req.version()};
     res.set(http::field::content_type, "application/json");
     res.set(http::field::cache_control, "no-cache");
+    res.set(http::field::vary, "Accept-Encoding");
     res.keep_alive(req.keep_alive());
-    res.body() = json::serialize(body);
+    // Временные тела перемещаем в ответ, закэшированные - копируем
+    if (!body.gzip.empty() && compression::AcceptsGzip(req[http::field::accept_encoding])) {
+        res.set(http::field::content_encoding, "gzip");
+        res.body() = std::forward<Body>(body).gzip;
+    } else {
+        res.body() = std::forward<Body>(body).plain;
+    }
     res.prepare_payload();
 
     return res;
 }
 
-std::map<std::string, std::string> ParseQueryString(const std::string &query) {
-    std::map<std::string, std::string> result;
-    size_t start = 0, end = 0;
-
-    while ((end = query.find('&', start)) != std::string::npos) {
-        auto token = query.substr(start, end - start);
-        auto pos = token.find('=');
-        if (pos != std::string::npos) {
-            result[token.substr(0, pos)] = token.substr(pos + 1);
-        }
-        start = end + 1;
-    }
-
-    // Last parameter
-    auto token = query.substr(start);
-    auto pos = token.find('=');
-    if (pos != std::string::npos) {
-        result[token.substr(0, pos)] = token.substr(pos + 1);
-    }
-
-    return result;
-}
-
 Ticker::Ticker(Ticker::Strand strand, std::chrono::milliseconds period,
                std::function<void(std::chrono::milliseconds)> handler)
         : strand_{strand}
@@ -588,11 +1144,15 @@ void Ticker::OnTick(sys::error_code ec) {
     if (!ec) {
         auto this_tick = Clock::now();
         auto delta = duration_cast<milliseconds>(this_tick - last_tick_);
+        auto& server_metrics = metrics::GetServerMetrics();
+        // Опоздание - время от срабатывания таймера до запуска обработчика в strand
+        server_metrics.tick_lag.Record(this_tick - timer_.expiry());
         last_tick_ = this_tick;
         try {
             handler_(delta);
         } catch (...) {
         }
+        server_metrics.tick_duration.Record(Clock::now() - this_tick);
         ScheduleTick();
     }
 }
@@ -3,12 +3,36 @@
 #include "http_server.h"
 #include "json_loader.h"
 #include "logger.h"
+#include "metrics.h"
+#include "tick_profiler.h"
+#include "cpu_profiler.h"
+#include "memory_usage.h"
+#include "request_context.h"
 #include "app.h"
-
+#include "admission_control.h"
+#include "api_router.h"
+#include "compression.h"
+#include "file_range_body.h"
+#include "http_conditional.h"
+#include "request_arena.h"
+#include "shared_buffer_body.h"
+#include "static_file_cache.h"
+#include "static_index.h"
+
+#include <boost/asio/awaitable.hpp>
+#ifdef BOOST_ASIO_HAS_FILE
+#include <boost/asio/random_access_file.hpp>
+#include <boost/asio/read_at.hpp>
+#endif
 #include <boost/json.hpp>
 
+#include <map>
+#include <memory>
 #include <utility>
+#include <atomic>
+#include <mutex>
 #include <optional>
+#include <tuple>
 #include <variant>
 
 namespace http_handler {
@@ -20,13 +44,14 @@ namespace net = boost::asio;
 
 namespace fs = std::filesystem;
 
-using HttpRequest = http::request<http::string_body>;
+using HttpRequest = http_server::HttpRequest;
 using EmptyResponse = http::response<http::empty_body>;
 using StringResponse = http::response<http::string_body>;
 using FileResponse = http::response<http::file_body>;
-using FileRequestResult = std::variant<EmptyResponse, StringResponse, FileResponse>;
-
-std::map<std::string, std::string> ParseQueryString(const std::string& query);
+using SharedBufferResponse = http::response<SharedBufferBody>;
+using FileRangeResponse = http::response<FileRangeBody>;
+using FileRequestResult = std::variant<EmptyResponse, StringResponse, FileResponse, SharedBufferResponse,
+                                       FileRangeResponse>;
 
 class Ticker : public std::enable_shared_from_this<Ticker> {
 public:
@@ -52,30 +77,95 @@ private:
     std::chrono::steady_clock::time_point last_tick_;
 };
 
+// Параметры сжатия ответов для каждой точки входа API
+struct ApiCompressionSettings {
+    // Описания карт не меняются, поэтому сжимаются один раз при старте максимальным уровнем
+    compression::GzipSettings maps{512, 9};
+    compression::GzipSettings state{512, 6};
+    compression::GzipSettings records{1024, 6};
+    compression::GzipSettings other{1024, 1};
+};
+
 class ApiRequestHandler {
 public:
-    explicit ApiRequestHandler(model::Game &game, app::Application &app, int tick_period);
+    explicit ApiRequestHandler(model::Game &game, app::Application &app, int tick_period,
+                               ApiCompressionSettings compression = {});
 
 
-    // Обработка запросов к API
+    // Обработка запросов к API, кроме таблицы рекордов
     [[nodiscard]] StringResponse GetApiResponse(const HttpRequest& req) const;
+    // Обработка запроса таблицы рекордов. Выполняется вне api_strand: таблица читается из памяти
+    [[nodiscard]] StringResponse GetTableOfRecords(const HttpRequest& req, std::string_view query) const;
+    // Оценка памяти игрового состояния и кэша сериализованных ответов в JSON. Вызывается внутри api_strand
+    [[nodiscard]] json::object EstimateMemoryUsage() const;
 
 private:
+    // Хешер, позволяющий искать по std::string_view без создания std::string
+    struct StringHasher {
+        using is_transparent = void;
+        size_t operator()(std::string_view str) const noexcept {
+            return std::hash<std::string_view>{}(str);
+        }
+    };
+
+    // Состояние сессии, сериализованное для определённой версии состояния этой сессии
+    struct CachedState {
+        uint64_t version{0};
+        compression::EncodedBody body;
+        // Запись удаляется из кэша, когда сессии больше нет
+        std::weak_ptr<const model::GameSession> session;
+    };
+    // Страница таблицы рекордов, сериализованная для определённой версии таблицы, и курсор следующей страницы
+    struct CachedRecordsPage {
+        uint64_t version{0};
+        compression::EncodedBody body;
+        std::string next_cursor;
+    };
+    // Курсор, start и maxItems запроса страницы таблицы рекордов
+    using RecordsPageKey = std::tuple<std::string, size_t, size_t>;
+
     model::Game& game_;
     app::Application& app_;
     int tick_period_;
+    ApiCompressionSettings compression_;
+    // Тела ответов со списком карт и с описанием каждой карты готовятся при старте
+    compression::EncodedBody maps_body_;
+    std::unordered_map<std::string, compression::EncodedBody, StringHasher, std::equal_to<>> map_bodies_;
+    // Обращения к кэшу выполняются только внутри api_strand. Записи удалённых сессий
+    // вытесняются при добавлении в кэш новой сессии
+    mutable std::unordered_map<const model::GameSession*, CachedState> state_cache_;
+    // Страницы таблицы рекордов, сериализованные для последней версии таблицы, по курсору, start и maxItems.
+    // Запросы таблицы рекордов выполняются вне api_strand, поэтому кэш защищён мьютексом.
+    // При смене версии таблицы кэш очищается
+    mutable std::mutex records_cache_mutex_;
+    mutable uint64_t records_cache_version_{0};
+    mutable std::map<RecordsPageKey, std::shared_ptr<const CachedRecordsPage>> records_cache_;
 
     template<typename... Headers>
     [[nodiscard]] StringResponse GetErrorResponse(const HttpRequest &req, http::status status, const std::string &code,
                                                   const std::string &message, const Headers&... headers) const;
+    // Ответ 405 с заголовком Allow, взятым из таблицы маршрутов
+    [[nodiscard]] StringResponse GetMethodNotAllowed(const HttpRequest &req, ApiRoute route, const std::string &message) const;
 
+    template<typename JsonBody>
+    [[nodiscard]] StringResponse GetJsonResponse(const HttpRequest& req, const JsonBody &body,
+                                                 const compression::GzipSettings& settings) const;
     template<typename JsonBody>
     [[nodiscard]] StringResponse GetJsonResponse(const HttpRequest& req, const JsonBody &body) const;
+    // Формирует JSON-ответ из готового тела, выбирая сжатый вариант, если клиент его принимает
+    template<typename Body>
+    [[nodiscard]] StringResponse GetEncodedResponse(const HttpRequest& req, Body&& body) const;
+    // Возвращает тело ответа с состоянием сессии игрока, сериализуя его не чаще одного раза за версию
+    [[nodiscard]] const compression::EncodedBody* FindStateBody(const app::Token& token) const;
+    // Возвращает сериализованную страницу таблицы рекордов вместе с версией таблицы.
+    // Страница сериализуется не чаще одного раза за версию. after - позиция, закодированная в cursor
+    [[nodiscard]] std::shared_ptr<const CachedRecordsPage> FindRecordsPage(
+            size_t start, size_t max_items, std::string_view cursor,
+            const std::optional<leaderboard::Record>& after) const;
     // Обработка запроса на получение списка карт
     [[nodiscard]] StringResponse GetMaps (const HttpRequest& req) const;
     // Обработка запроса на получение карты по ID
-    [[nodiscard]] StringResponse GetMapById (const HttpRequest& req) const;
-    [[nodiscard]] StringResponse GetTableOfRecords(const HttpRequest& req) const;
+    [[nodiscard]] StringResponse GetMapById (const HttpRequest& req, std::string_view map_id) const;
     [[nodiscard]] StringResponse HandleJoinGame(const HttpRequest& req) const;
     [[nodiscard]] std::optional<app::Token> TryExtractToken(const HttpRequest& req) const;
     template <typename Fn>
@@ -86,21 +176,107 @@ private:
     [[nodiscard]] StringResponse HandleTimeControl(const HttpRequest& req) const;
 };
 
+// Параметры отдачи статических файлов
+struct StaticFileSettings {
+    // Читать файлы асинхронно через io_uring. Требует сборки с GAME_SERVER_USE_IO_URING
+    bool async_reads = false;
+    // Файлы большего размера читаются по частям через file_body
+    uint64_t max_async_read_size = 8 * 1024 * 1024;
+    // Файлы, загружаемые в память при старте. max_total_size = 0 отключает кэш
+    StaticFileCacheSettings cache;
+    // Перестраивать индекс и кэш после изменений в каталоге статических файлов
+    bool watch = false;
+    // Файлы не меньше этого размера, не попавшие в кэш, отправляются через sendfile() без копирования
+    // в память процесса. Меньшие файлы отдаются через file_body. 0 - sendfile только для диапазонов
+    uint64_t sendfile_min_size = 64 * 1024;
+};
+
+// Служебные точки входа /admin/. Они раскрывают внутреннее состояние сервера, поэтому по умолчанию выключены.
+// Выключенные точки входа обрабатываются как запросы к статическим файлам.
+// Включённые точки входа отвечают только на запросы с заголовком Authorization: Bearer <token>
+struct AdminSettings {
+    bool enabled = false;
+    std::string token;
+};
+
 class FileRequestHandler {
 public:
-    explicit FileRequestHandler(fs::path root);
+    explicit FileRequestHandler(fs::path root, StaticFileSettings settings = {});
 
     [[nodiscard]] FileRequestResult GetFileResponse(const HttpRequest& req);
+#ifdef BOOST_ASIO_HAS_FILE
+    // Читает файл целиком через net::random_access_file в исполнителе вызывающей сопрограммы
+    [[nodiscard]] net::awaitable<FileRequestResult> GetFileResponseAsync(const HttpRequest& req);
+#endif
+    [[nodiscard]] bool IsAsync() const noexcept {
+        return settings_.async_reads;
+    }
+    // Объём файлов в кэше без учёта сжатых вариантов
+    [[nodiscard]] uint64_t GetCacheSize() const;
+    // Заново обходит каталог и заменяет индекс вместе с кэшем.
+    // Запросы, начавшиеся до замены, дообслуживаются по прежнему индексу
+    void Rebuild();
 
 private:
+    // Индекс и кэш файлов одного обхода каталога
+    struct StaticContent {
+        StaticIndex index;
+        StaticFileCache cache;
+    };
+    // Файл, который нужно прочитать с диска, и запрошенный диапазон байт
+    struct DiskRead {
+        const StaticEntry* entry;
+        std::optional<ByteRange> range;
+    };
+
     fs::path root_;
+    StaticFileSettings settings_;
+    // Содержимое неизменяемо, поэтому запросы читают указатель без мьютекса, а наблюдатель атомарно его заменяет
+    std::atomic<std::shared_ptr<const StaticContent>> content_;
+    // Объявлен последним: поток наблюдателя останавливается раньше, чем разрушаются остальные поля
+    std::unique_ptr<StaticIndexWatcher> watcher_;
+
+    [[nodiscard]] std::shared_ptr<const StaticContent> LoadContent() const;
+    [[nodiscard]] std::shared_ptr<const StaticContent> GetContent() const;
+    // Находит файл, соответствующий запросу. Если файл не может быть отдан, возвращает ответ с ошибкой
+    [[nodiscard]] std::variant<const StaticEntry*, StringResponse> ResolveFile(const StaticContent& content,
+                                                                               const HttpRequest& req) const;
+    // Формирует ответ, не читая файл с диска: ошибку, 304, 416 или ответ из кэша.
+    // Если файла нет в кэше, возвращает DiskRead
+    [[nodiscard]] std::variant<FileRequestResult, DiskRead> PrepareResponse(const StaticContent& content,
+                                                                          const HttpRequest& req) const;
+    // Отдаёт запрошенный диапазон или крупный файл через FileRangeBody, остальные файлы - через file_body
+    [[nodiscard]] FileRequestResult ReadFromDisk(const HttpRequest& req, const StaticEntry& entry,
+                                                 const std::optional<ByteRange>& range) const;
+    // Ответ из кэша: сжатый вариант выбирается, если клиент принимает gzip и не запросил диапазон
+    [[nodiscard]] SharedBufferResponse MakeCachedResponse(const HttpRequest& req, const StaticEntry& entry,
+                                                          const CachedFile& file,
+                                                          const std::optional<ByteRange>& range) const;
+    [[nodiscard]] EmptyResponse MakeNotModifiedResponse(const HttpRequest& req, const StaticEntry& entry,
+                                                        const CachedFile* cached) const;
+    [[nodiscard]] EmptyResponse MakeRangeNotSatisfiableResponse(unsigned version, uint64_t size) const;
+
+    // Проверяет If-None-Match и If-Modified-Since: у клиента есть актуальная копия файла
+    static bool IsNotModified(const HttpRequest& req, const StaticEntry& entry, std::string_view etag);
+    // Разбирает Range с учётом If-Range
+    static ParsedRange GetRequestedRange(const HttpRequest& req, const StaticEntry& entry, std::string_view etag);
+    static bool UseGzip(const HttpRequest& req, const CachedFile& file);
+    [[nodiscard]] bool UseSendfile(const StaticEntry& entry) const noexcept {
+        return settings_.sendfile_min_size > 0 && entry.size >= settings_.sendfile_min_size;
+    }
+    static std::string MakeContentRange(const ByteRange& range, uint64_t size);
+    // Заголовки, по которым клиент проверяет актуальность своей копии файла
+    template <typename Response>
+    static void SetValidators(Response& res, const StaticEntry& entry, std::string_view etag) {
+        res.set(http::field::etag, etag);
+        res.set(http::field::last_modified, entry.last_modified);
+        res.set(http::field::accept_ranges, "bytes");
+    }
 
     // MIME типы для статических файлов
     static const std::unordered_map<std::string, std::string> mime_types_;
     // Функция для декодирования URL
     static std::string UrlDecode(const std::string& url);
-    // Возвращает true, если каталог p содержится внутри base_path.
-    static bool IsSubPath(fs::path path, fs::path base);
     // Функция для определения MIME-типа по расширению файла
     static std::string GetMimeType(const std::string& extension);
     [[nodiscard]] StringResponse NotFoundResponse(unsigned int version) const;
@@ -111,58 +287,86 @@ class RequestHandler : public std::enable_shared_from_this<RequestHandler> {
 public:
     using Strand = net::strand<net::io_context::executor_type>;
 
-    RequestHandler(model::Game &game, app::Application &app, fs::path root, Strand api_strand, int tick_period);
+    RequestHandler(model::Game &game, app::Application &app, fs::path root, Strand api_strand, int tick_period,
+                   ApiCompressionSettings compression = {}, AdmissionSettings admission = {},
+                   StaticFileSettings static_files = {}, AdminSettings admin = {});
 
     RequestHandler(const RequestHandler&) = delete;
     RequestHandler& operator=(const RequestHandler&) = delete;
 
+    // Сопрограмма обработки запроса. Ответ отправляется через send, возвращающую awaitable записи.
+    // Запрос и send хранятся в кадре сопрограммы до окончания записи ответа.
+    // В context отмечается время ожидания и начала выполнения запроса к API в api_strand
     template <typename Body, typename Allocator, typename Send>
-    void operator()(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send) {
+    net::awaitable<void> operator()(http::request<Body, http::basic_fields<Allocator>> req, Send send,
+                                    server_logging::RequestContext& context) {
         auto version = req.version();
         auto keep_alive = req.keep_alive();
 
+        // Внутри обработчика исключения нельзя использовать co_await, поэтому ответ отправляется после try
+        FileRequestResult response;
         try {
             if (req.target().starts_with("/api/")) {
-                auto handle = [self = shared_from_this(), send,
-                        req = std::forward<decltype(req)>(req), version, keep_alive] {
-                    try {
-                        // Этот assert не выстрелит, так как лямбда-функция будет выполняться внутри strand
-                        assert(self->api_strand_.running_in_this_thread());
-                        return send(self->HandleApiRequest(req));
-                    } catch (...) {
-                        send(self->ReportServerError(version, keep_alive));
-                    }
-                };
-                return net::dispatch(api_strand_, handle);
+                const RouteMatch match = MatchApiRoute(req.target());
+                context.api_route = match.route;
+                if (match.route == ApiRoute::RECORDS) {
+                    // Таблица рекордов не зависит от состояния игры и читается из памяти вне api_strand,
+                    // поэтому не задерживает тики и другие запросы к API
+                    response = api_handler_.GetTableOfRecords(req, match.query);
+                } else {
+                    response = co_await HandleApiRequestInStrand(req, version, keep_alive, context);
+                }
+            } else if (IsMetricsRequest(req)) {
+                response = HandleMetricsRequest(req);
+            } else if (admin_.enabled && req.target().starts_with("/admin/")) {
+                response = co_await HandleAdminRequest(req);
+            } else {
+                // Возвращаем результат обработки запроса к файлу
+                response = co_await HandleFileRequest(req);
             }
-            // Возвращаем результат обработки запроса к файлу
-            return std::visit(
-                    [&send](auto&& result) {
-                        send(std::forward<decltype(result)>(result));
-                    },
-                    HandleFileRequest(req));
         } catch (...) {
-            send(ReportServerError(version, keep_alive));
+            response = ReportServerError(version, keep_alive);
         }
+        co_await std::visit(
+                [&send](auto& result) {
+                    return send(std::move(result));
+                },
+                response);
     }
 
-    // Метод для получения информации для логирования
-    server_logging::LogData GetLogInfo() const;
-
 private:
     ApiRequestHandler api_handler_;
     FileRequestHandler file_handler_;
 
     Strand api_strand_;
-
-    // Данные для логирования
-    unsigned int response_status_code_{0};          // Код ответа
-    std::string content_type_;             // Тип контента
+    AdmissionController admission_;
+    AdminSettings admin_;
 
     // Обработка запросов на статические файлы
-    FileRequestResult HandleFileRequest(const HttpRequest& req);
-    StringResponse HandleApiRequest(const HttpRequest& req);
+    net::awaitable<FileRequestResult> HandleFileRequest(const HttpRequest& req);
+    static bool IsMetricsRequest(const HttpRequest& req);
+    // Метрики сервера в текстовом формате Prometheus. Не требует api_strand
+    StringResponse HandleMetricsRequest(const HttpRequest& req) const;
+    // /admin/tick-trace - последние тики в формате Chrome trace_event,
+    // /admin/profile?seconds=N - стеки потоков за N секунд в свёрнутом формате для flamegraph.pl,
+    // /admin/memory - оценка памяти по подсистемам, картам и сессиям вместе со статистикой распределителя,
+    // /admin/malloc-info - статистика арен распределителя в XML
+    net::awaitable<StringResponse> HandleAdminRequest(const HttpRequest& req) const;
+    // Запрос к служебной точке входа содержит токен из AdminSettings
+    [[nodiscard]] bool IsAdminAuthorized(const HttpRequest& req) const;
+    // Ответ служебной точки входа. Непустое file_name предлагает клиенту сохранить ответ в файл
+    static StringResponse MakeAdminResponse(const HttpRequest& req, std::string_view content_type, std::string body,
+                                            std::string_view file_name);
+    static net::awaitable<StringResponse> GetCpuProfile(const HttpRequest& req, std::string_view query);
+    net::awaitable<StringResponse> GetMemoryUsage(const HttpRequest& req) const;
+    // Ответ служебной точки входа с текстом ошибки. Ответ 405 содержит заголовок Allow: GET, HEAD
+    static StringResponse MakeTextResponse(const HttpRequest& req, http::status status, std::string_view text);
+    // Выполняет запрос к API внутри api_strand и возвращает ответ в исполнитель вызывающей сопрограммы
+    net::awaitable<StringResponse> HandleApiRequestInStrand(const HttpRequest& req, unsigned version, bool keep_alive,
+                                                            server_logging::RequestContext& context);
     StringResponse ReportServerError(unsigned version, bool keep_alive) const;
+    // Ответ 503 с заголовком Retry-After при перегрузке api_strand
+    StringResponse ReportOverloaded(unsigned version, bool keep_alive) const;
 };
 
 }  // namespace http_handler
@@ -0,0 +1,111 @@
+#include "request_tracer.h"
+
+#include "json_string.h"
+#include "trace_event.h"
+
+#include <charconv>
+#include <random>
+#include <stdexcept>
+
+namespace server_logging {
+using namespace std::literals;
+
+namespace {
+
+void AppendMilliseconds(std::string& out, RequestContext::Clock::duration value) {
+    char buffer[32];
+    const auto [ptr, ec] = std::to_chars(std::begin(buffer), std::end(buffer),
+                                         std::chrono::duration<double, std::milli>(value).count(),
+                                         std::chars_format::fixed, 3);
+    out.append(buffer, ec == std::errc{} ? ptr : buffer);
+}
+
+void AppendTiming(std::string& out, std::string_view name, RequestContext::Clock::duration value) {
+    if (!out.empty()) {
+        out.append(", "sv);
+    }
+    out.append(name).append(";dur="sv);
+    AppendMilliseconds(out, value);
+}
+
+void AppendSpan(std::string& out, std::string_view name, uint64_t track, RequestContext::Clock::time_point start,
+                RequestContext::Clock::time_point end, std::string_view args = {}) {
+    out += ',';
+    metrics::AppendCompleteEvent(out, name, "request"sv, metrics::REQUEST_TRACE_PID, track, start, end - start, args);
+}
+
+}  // namespace
+
+void RequestTracer::Configure(const RequestTracerSettings& settings) {
+    std::lock_guard lock{mutex_};
+    sample_rate_ = settings.sample_rate;
+    if (sample_rate_ <= 0.0) {
+        return;
+    }
+    file_.open(settings.file, std::ios::out | std::ios::trunc);
+    if (!file_) {
+        throw std::runtime_error("Failed to open request trace file "s + settings.file);
+    }
+    file_ << '[';
+    file_.flush();
+    first_trace_ = true;
+}
+
+bool RequestTracer::ShouldSample() const noexcept {
+    if (sample_rate_ <= 0.0) {
+        return false;
+    }
+    thread_local std::minstd_rand generator{std::random_device{}()};
+    return std::uniform_real_distribution<double>{}(generator) < sample_rate_;
+}
+
+void RequestTracer::Write(const Trace& trace) {
+    const uint64_t track = next_track_.fetch_add(1, std::memory_order_relaxed);
+    std::string events;
+    AppendEvents(events, trace, track);
+    std::lock_guard lock{mutex_};
+    if (file_.is_open()) {
+        file_ << (first_trace_ ? "\n"sv : ",\n"sv) << events;
+        file_.flush();
+        first_trace_ = false;
+    }
+}
+
+void RequestTracer::AppendEvents(std::string& out, const Trace& trace, uint64_t track) {
+    const auto& context = trace.context;
+    std::string args = R"("method":)"s;
+    util::AppendJsonString(args, trace.method);
+    args.append(R"(,"target":)"sv);
+    util::AppendJsonString(args, trace.target);
+    args.append(R"(,"status":)"sv).append(std::to_string(trace.status));
+    if (trace.write_failed) {
+        args.append(R"(,"write_failed":true)"sv);
+    }
+
+    metrics::AppendInstantEvent(out, "accept"sv, "request"sv, metrics::REQUEST_TRACE_PID, track,
+                                context.accepted_at);
+    AppendSpan(out, "request"sv, track, context.read_started_at, trace.written_at, args);
+    AppendSpan(out, "read"sv, track, context.read_started_at, context.read_finished_at);
+    if (context.strand_enqueued_at && context.strand_started_at) {
+        AppendSpan(out, "strand_wait"sv, track, *context.strand_enqueued_at, *context.strand_started_at);
+    }
+    AppendSpan(out, "handler"sv, track, context.strand_started_at.value_or(context.received_at),
+               context.responded_at);
+    AppendSpan(out, "write"sv, track, context.responded_at, trace.written_at);
+}
+
+RequestTracer& GetRequestTracer() {
+    static RequestTracer tracer;
+    return tracer;
+}
+
+std::string FormatServerTiming(const RequestContext& context) {
+    std::string value;
+    AppendTiming(value, "read"sv, context.GetReadTime());
+    AppendTiming(value, "queue"sv, context.GetStrandWait());
+    AppendTiming(value, "app"sv, context.GetHandlerTime());
+    AppendTiming(value, "total"sv, context.GetReadTime() + context.GetResponseTime());
+    return value;
+}
+
+}  // namespace server_logging
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "request_context.h"
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace server_logging {
+
+struct RequestTracerSettings {
+    // Доля трассируемых запросов от 0 до 1. 0 - трассировка выключена
+    double sample_rate = 0.0;
+    std::string file;
+};
+
+// Выборочная трассировка запросов. Этапы запроса от приёма соединения до записи ответа пишутся в файл
+// в формате Chrome trace_event (JSON Array Format), который открывается в Perfetto и chrome://tracing.
+// Массив не закрывается, как допускает формат, поэтому файл остаётся корректным и после аварийного завершения.
+// Запрос записывается в файл под мьютексом из потока, записавшего ответ, - поэтому трассируется лишь доля запросов
+class RequestTracer {
+public:
+    // Трассировка одного запроса. Заполняется при отправке ответа и записывается после его записи в сокет
+    struct Trace {
+        RequestContext context;
+        std::string method;
+        std::string target;
+        unsigned status = 0;
+        RequestContext::Clock::time_point written_at;
+        bool write_failed = false;
+    };
+
+    // Открывает файл трассировки. Выбрасывает std::runtime_error, если файл не удалось открыть
+    void Configure(const RequestTracerSettings& settings);
+    // Решает, трассировать ли очередной запрос
+    [[nodiscard]] bool ShouldSample() const noexcept;
+    void Write(const Trace& trace);
+
+    // Дописывает события запроса, разделённые запятыми. Этапы запроса отображаются на отдельной дорожке track
+    static void AppendEvents(std::string& out, const Trace& trace, uint64_t track);
+
+private:
+    double sample_rate_ = 0.0;
+    std::atomic<uint64_t> next_track_{1};
+    std::mutex mutex_;
+    std::ofstream file_;
+    bool first_trace_ = true;
+};
+
+// Трассировщик процесса. Создаётся при первом обращении
+RequestTracer& GetRequestTracer();
+
+// Значение заголовка Server-Timing с длительностями этапов запроса в миллисекундах:
+// чтение, ожидание api_strand, работа обработчика и общее время до готовности ответа
+std::string FormatServerTiming(const RequestContext& context);
+
+}  // namespace server_logging
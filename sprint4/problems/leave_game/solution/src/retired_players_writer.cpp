@@ -0,0 +1,116 @@
+#include "retired_players_writer.h"
+#include "logger.h"
+#include "metrics.h"
+
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/use_awaitable.hpp>
+
+#include <algorithm>
+#include <exception>
+
+namespace app {
+using namespace std::literals;
+namespace sys = boost::system;
+
+RetiredPlayersWriter::RetiredPlayersWriter(Executor executor, Settings settings, WriteFunction write)
+    : strand_(net::make_strand(executor))
+    , settings_(settings)
+    , write_(std::move(write))
+    , retry_timer_(strand_) {
+}
+
+bool RetiredPlayersWriter::Enqueue(postgres::RetiredPlayer player) {
+    {
+        std::lock_guard lock{mutex_};
+        if (pending_.size() >= settings_.max_pending) {
+            metrics::GetServerMetrics().retired_players_lost.Add();
+            return false;
+        }
+        pending_.push_back({std::move(player), Clock::now()});
+        metrics::GetServerMetrics().retired_players_queue_depth.Set(static_cast<int64_t>(pending_.size()));
+        if (running_) {
+            return true;
+        }
+        running_ = true;
+    }
+    net::co_spawn(strand_, Run(), [](std::exception_ptr error) {
+        if (!error) {
+            return;
+        }
+        try {
+            std::rethrow_exception(error);
+        } catch (const std::exception& ex) {
+            server_logging::LogServerError(0, ex.what(), "save retired player"s);
+        }
+    });
+    return true;
+}
+
+net::awaitable<size_t> RetiredPlayersWriter::Flush(std::chrono::milliseconds timeout) {
+    auto flush = DoFlush(timeout);
+    co_return co_await net::co_spawn(strand_, std::move(flush), net::use_awaitable);
+}
+
+size_t RetiredPlayersWriter::GetPendingCount() const {
+    std::lock_guard lock{mutex_};
+    return pending_.size();
+}
+
+net::awaitable<void> RetiredPlayersWriter::Run() {
+    auto retry_delay = settings_.initial_retry_delay;
+    while (true) {
+        PendingPlayer next;
+        {
+            std::lock_guard lock{mutex_};
+            if (pending_.empty()) {
+                running_ = false;
+                break;
+            }
+            next = pending_.front();
+        }
+        // Игрок удаляется из очереди только после успешной записи
+        bool written = false;
+        try {
+            co_await write_(next.player);
+            written = true;
+        } catch (const std::exception& ex) {
+            server_logging::LogServerError(0, ex.what(), "save retired player"s);
+            metrics::GetServerMetrics().retired_player_save_failures.Add();
+        }
+        if (!written) {
+            retry_timer_.expires_after(retry_delay);
+            sys::error_code ec;
+            co_await retry_timer_.async_wait(net::redirect_error(net::use_awaitable, ec));
+            retry_delay = std::min(retry_delay * 2, settings_.max_retry_delay);
+            continue;
+        }
+        retry_delay = settings_.initial_retry_delay;
+        {
+            std::lock_guard lock{mutex_};
+            pending_.pop_front();
+            metrics::GetServerMetrics().retired_players_queue_depth.Set(static_cast<int64_t>(pending_.size()));
+        }
+        auto& server_metrics = metrics::GetServerMetrics();
+        server_metrics.retired_player_save_duration.Record(Clock::now() - next.retired_at);
+        server_metrics.retired_players.Add();
+    }
+    for (auto* waiter : flush_waiters_) {
+        waiter->cancel();
+    }
+}
+
+net::awaitable<size_t> RetiredPlayersWriter::DoFlush(std::chrono::milliseconds timeout) {
+    net::steady_timer timer{strand_, timeout};
+    // Ожидающий повтора игрок записывается сразу, не дожидаясь конца паузы
+    retry_timer_.cancel();
+    while (GetPendingCount() != 0 && timer.expiry() > Clock::now()) {
+        flush_waiters_.push_back(&timer);
+        sys::error_code ec;
+        co_await timer.async_wait(net::redirect_error(net::use_awaitable, ec));
+        std::erase(flush_waiters_, &timer);
+    }
+    co_return GetPendingCount();
+}
+
+}  // namespace app
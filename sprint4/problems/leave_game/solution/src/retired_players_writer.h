@@ -0,0 +1,78 @@
+#pragma once
+
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+#include "postgres.h"
+
+namespace app {
+
+namespace net = boost::asio;
+
+// Очередь записи игроков, ушедших на покой, в таблицу рекордов базы данных.
+// Игрок остаётся в очереди, пока запись не удастся: после ошибки запись повторяется с паузой,
+// которая удваивается до max_retry_delay. Записывает одна сопрограмма, поэтому при недоступной базе данных
+// сопрограммы не накапливаются. Очередь ограничена: игрок, не поместившийся в неё, не сохраняется
+class RetiredPlayersWriter {
+public:
+    using Executor = net::io_context::executor_type;
+    // Записывает игрока в базу данных. Запись повторяется, поэтому должна быть идемпотентной
+    using WriteFunction = std::function<net::awaitable<void>(const postgres::RetiredPlayer&)>;
+
+    struct Settings {
+        size_t max_pending = 10'000;
+        std::chrono::milliseconds initial_retry_delay{100};
+        std::chrono::milliseconds max_retry_delay{10'000};
+    };
+
+    RetiredPlayersWriter(Executor executor, Settings settings, WriteFunction write);
+
+    RetiredPlayersWriter(const RetiredPlayersWriter&) = delete;
+    RetiredPlayersWriter& operator=(const RetiredPlayersWriter&) = delete;
+
+    // Ставит игрока в очередь записи. Возвращает false, если очередь заполнена. Вызывается из любого потока
+    bool Enqueue(postgres::RetiredPlayer player);
+    // Ждёт, пока очередь не опустеет, но не дольше timeout. Ожидающий повтора игрок записывается сразу.
+    // Возвращает число игроков, оставшихся незаписанными. Вызывается при остановке сервера
+    net::awaitable<size_t> Flush(std::chrono::milliseconds timeout);
+
+    [[nodiscard]] size_t GetPendingCount() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct PendingPlayer {
+        postgres::RetiredPlayer player;
+        Clock::time_point retired_at;
+    };
+
+    // Записывает игроков из очереди, пока она не опустеет. Выполняется в strand_
+    net::awaitable<void> Run();
+    net::awaitable<size_t> DoFlush(std::chrono::milliseconds timeout);
+
+    net::strand<Executor> strand_;
+    const Settings settings_;
+    const WriteFunction write_;
+
+    // Очередь пополняется из api_strand, а разбирается в strand_
+    mutable std::mutex mutex_;
+    std::deque<PendingPlayer> pending_;
+    // Сопрограмма записи запущена
+    bool running_ = false;
+
+    // Остальные поля используются только в strand_.
+    // Пауза перед повтором записи. Отмена таймера повторяет запись сразу
+    net::steady_timer retry_timer_;
+    // Таймеры сопрограмм Flush. Отмена таймера сообщает, что очередь опустела
+    std::deque<net::steady_timer*> flush_waiters_;
+};
+
+}  // namespace app
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <new>
+#include <utility>
+
+namespace http_server {
+
+// Пул памяти одного соединения. Освобождённые блоки не возвращаются в кучу,
+// а попадают в список свободных блоков своего размерного класса и выдаются повторно.
+// После первых запросов соединения keep-alive память запросов берётся только из пула.
+// Пул не потокобезопасен: им пользуется только executor сессии
+class RecyclingPool {
+public:
+    // Размерные классы: 64, 128, ..., 64 * 2^(CLASS_COUNT-1) байт. Крупные блоки берутся из кучи
+    static constexpr size_t MIN_BLOCK_SIZE = 64;
+    static constexpr size_t CLASS_COUNT = 8;
+    static constexpr size_t MAX_BLOCK_SIZE = MIN_BLOCK_SIZE << (CLASS_COUNT - 1);
+
+    RecyclingPool() = default;
+    RecyclingPool(const RecyclingPool&) = delete;
+    RecyclingPool& operator=(const RecyclingPool&) = delete;
+
+    ~RecyclingPool() {
+        for (FreeBlock*& head : free_lists_) {
+            while (head) {
+                ::operator delete(std::exchange(head, head->next));
+            }
+        }
+    }
+
+    void* Allocate(size_t size) {
+        const size_t size_class = GetSizeClass(size);
+        if (size_class == CLASS_COUNT) {
+            return ::operator new(size);
+        }
+        if (FreeBlock* block = free_lists_[size_class]) {
+            free_lists_[size_class] = block->next;
+            return block;
+        }
+        return ::operator new(MIN_BLOCK_SIZE << size_class);
+    }
+
+    void Deallocate(void* ptr, size_t size) noexcept {
+        const size_t size_class = GetSizeClass(size);
+        if (size_class == CLASS_COUNT) {
+            return ::operator delete(ptr);
+        }
+        free_lists_[size_class] = new (ptr) FreeBlock{free_lists_[size_class]};
+    }
+
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    // Возвращает номер размерного класса или CLASS_COUNT для блоков, не помещающихся в пул
+    static constexpr size_t GetSizeClass(size_t size) noexcept {
+        size_t size_class = 0;
+        for (size_t block_size = MIN_BLOCK_SIZE; block_size < size; block_size <<= 1) {
+            if (++size_class == CLASS_COUNT) {
+                break;
+            }
+        }
+        return size_class;
+    }
+
+    std::array<FreeBlock*, CLASS_COUNT> free_lists_{};
+};
+
+// Аллокатор стандартной библиотеки поверх пула соединения.
+// Объекты, созданные с ним, не должны переживать сессию, которой принадлежит пул
+template <typename T>
+class RecyclingAllocator {
+public:
+    using value_type = T;
+
+    explicit RecyclingAllocator(RecyclingPool& pool) noexcept
+            : pool_(&pool) {
+    }
+
+    template <typename U>
+    RecyclingAllocator(const RecyclingAllocator<U>& other) noexcept  // NOLINT(google-explicit-constructor)
+            : pool_(other.pool_) {
+    }
+
+    T* allocate(size_t n) {
+        static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+        return static_cast<T*>(pool_->Allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* ptr, size_t n) noexcept {
+        pool_->Deallocate(ptr, n * sizeof(T));
+    }
+
+    template <typename U>
+    bool operator==(const RecyclingAllocator<U>& other) const noexcept {
+        return pool_ == other.pool_;
+    }
+
+private:
+    template <typename U>
+    friend class RecyclingAllocator;
+
+    RecyclingPool* pool_;
+};
+
+}  // namespace http_server
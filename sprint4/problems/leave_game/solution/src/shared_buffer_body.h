@@ -0,0 +1,79 @@
+#pragma once
+// boost.beast будет использовать std::string_view вместо boost::string_view
+#define BOOST_BEAST_USE_STD_STRING_VIEW
+
+#include <boost/asio/buffer.hpp>
+#include <boost/beast/core/error.hpp>
+#include <boost/beast/http/message.hpp>
+#include <boost/optional.hpp>
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace http_handler {
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace net = boost::asio;
+
+// Тело ответа, ссылающееся на неизменяемый буфер, который разделяют все ответы.
+// Запись тела не копирует данные и не обращается к файловой системе
+struct SharedBufferBody {
+    class value_type {
+    public:
+        value_type() = default;
+
+        explicit value_type(std::shared_ptr<const std::string> data)
+                : data_(std::move(data))
+                , view_(data_ ? std::string_view{*data_} : std::string_view{}) {
+        }
+
+        // Фрагмент буфера [offset, offset + length)
+        value_type(std::shared_ptr<const std::string> data, size_t offset, size_t length)
+                : data_(std::move(data))
+                , view_(std::string_view{*data_}.substr(offset, length)) {
+        }
+
+        [[nodiscard]] std::string_view View() const noexcept {
+            return view_;
+        }
+
+    private:
+        std::shared_ptr<const std::string> data_;
+        std::string_view view_;
+    };
+
+    static std::uint64_t size(const value_type& body) noexcept {
+        return body.View().size();
+    }
+
+    class writer {
+    public:
+        using const_buffers_type = net::const_buffer;
+
+        template <bool isRequest, class Fields>
+        writer(const http::header<isRequest, Fields>&, const value_type& body)
+                : body_(body) {
+        }
+
+        void init(beast::error_code& ec) {
+            ec = {};
+        }
+
+        boost::optional<std::pair<const_buffers_type, bool>> get(beast::error_code& ec) {
+            ec = {};
+            if (done_ || body_.View().empty()) {
+                return boost::none;
+            }
+            done_ = true;
+            return {{net::const_buffer(body_.View().data(), body_.View().size()), false}};
+        }
+
+    private:
+        const value_type& body_;
+        bool done_ = false;
+    };
+};
+
+}  // namespace http_handler
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <vector>
+
+namespace server_logging {
+
+// Кольцевой буфер без блокировок для одного производителя и одного потребителя.
+// Ёмкость округляется вверх до степени двойки, чтобы индекс вычислялся маской
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity)
+            : slots_(std::bit_ceil(std::max<size_t>(capacity, 2)))
+            , mask_(slots_.size() - 1) {
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Вызывается только потоком-производителем. Возвращает false, если буфер заполнен
+    bool TryPush(const T& value) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == slots_.size()) {
+            return false;
+        }
+        slots_[tail & mask_] = value;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Вызывается только потоком-потребителем. Передаёт в fn все элементы, записанные к моменту вызова,
+    // и возвращает их количество. Место в буфере освобождается после обработки всех элементов
+    template <typename Fn>
+    size_t ConsumeAll(Fn&& fn) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        const size_t tail = tail_.load(std::memory_order_acquire);
+        const size_t count = tail - head;
+        for (; head != tail; ++head) {
+            fn(slots_[head & mask_]);
+        }
+        head_.store(head, std::memory_order_release);
+        return count;
+    }
+
+    [[nodiscard]] size_t Capacity() const noexcept {
+        return slots_.size();
+    }
+
+private:
+    std::vector<T> slots_;
+    const size_t mask_;
+    // Индексы растут неограниченно; производитель и потребитель пишут их из разных потоков,
+    // поэтому они разнесены по разным кэш-линиям
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+};
+
+}  // namespace server_logging
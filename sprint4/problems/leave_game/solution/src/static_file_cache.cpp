@@ -0,0 +1,88 @@
+#include "static_file_cache.h"
+
+#include "compression.h"
+
+#include <boost/uuid/detail/sha1.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+namespace http_handler {
+
+using namespace std::literals;
+
+namespace {
+
+std::string ReadFile(const fs::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Failed to read static file "s + path.string());
+    }
+    return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+}
+
+}  // namespace
+
+StaticFileCache::StaticFileCache(const StaticIndex& index, const StaticFileCacheSettings& settings)
+        : files_(index.GetFiles().size()) {
+    // Сначала кэшируем мелкие файлы: при ограниченном размере кэша они дают больше попаданий
+    std::vector<const StaticEntry*> candidates;
+    for (const auto& entry : index.GetFiles()) {
+        if (entry.size <= settings.max_file_size) {
+            candidates.push_back(&entry);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const StaticEntry* lhs, const StaticEntry* rhs) {
+        return lhs->size < rhs->size;
+    });
+
+    for (const StaticEntry* entry : candidates) {
+        if (total_size_ + entry->size > settings.max_total_size) {
+            break;
+        }
+        auto content = std::make_shared<const std::string>(ReadFile(entry->path));
+
+        auto file = std::make_unique<CachedFile>();
+        file->mime_type = entry->mime_type;
+        file->etag = MakeEtag(*content);
+        file->last_write_time = entry->last_write_time;
+        if (settings.gzip_level > 0 && content->size() >= settings.gzip_min_size && IsCompressible(file->mime_type)) {
+            auto gzip = compression::GzipCompress(*content, settings.gzip_level);
+            if (gzip.size() < content->size()) {
+                file->gzip = std::make_shared<const std::string>(std::move(gzip));
+            }
+        }
+        total_size_ += content->size();
+        file->plain = std::move(content);
+
+        files_[entry->id] = std::move(file);
+        ++file_count_;
+    }
+}
+
+bool StaticFileCache::IsCompressible(std::string_view mime_type) {
+    return mime_type.starts_with("text/"sv) || mime_type == "application/json"sv || mime_type == "application/xml"sv
+           || mime_type == "image/svg+xml"sv || mime_type == "application/manifest+json"sv;
+}
+
+std::string StaticFileCache::MakeEtag(std::string_view content) {
+    boost::uuids::detail::sha1 sha1;
+    sha1.process_bytes(content.data(), content.size());
+    boost::uuids::detail::sha1::digest_type digest;
+    sha1.get_digest(digest);
+
+    std::ostringstream etag;
+    etag << '"' << std::hex << std::setfill('0');
+    for (const unsigned int word : digest) {
+        etag << std::setw(8) << word;
+    }
+    etag << '"';
+    return etag.str();
+}
+
+}  // namespace http_handler
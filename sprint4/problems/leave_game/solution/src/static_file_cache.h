@@ -0,0 +1,70 @@
+#pragma once
+
+#include "static_index.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace http_handler {
+
+namespace fs = std::filesystem;
+
+// Статический файл, загруженный в память. Буферы неизменяемы и разделяются ответами
+struct CachedFile {
+    std::shared_ptr<const std::string> plain;
+    // nullptr, если файл не сжимается или сжатие невыгодно
+    std::shared_ptr<const std::string> gzip;
+    // Сильный ETag, вычисленный по SHA-1 содержимого, вместе с кавычками
+    std::string etag;
+    std::string mime_type;
+    fs::file_time_type last_write_time;
+};
+
+struct StaticFileCacheSettings {
+    // Суммарный размер файлов в кэше. Файлы, не поместившиеся в кэш, читаются с диска
+    uint64_t max_total_size = 64 * 1024 * 1024;
+    // Файлы крупнее этого размера не кэшируются
+    uint64_t max_file_size = 16 * 1024 * 1024;
+    // Уровень gzip для предварительного сжатия. 0 - не сжимать
+    int gzip_level = 9;
+    // Файлы короче порога не сжимаются
+    size_t gzip_min_size = 256;
+};
+
+// Кэш статических файлов каталога. Заполняется при создании и затем не меняется,
+// поэтому доступен из любого потока без блокировок
+class StaticFileCache {
+public:
+    StaticFileCache() = default;
+    // Загружает файлы индекса, пока не будет достигнут предел размера кэша
+    StaticFileCache(const StaticIndex& index, const StaticFileCacheSettings& settings);
+
+    // Возвращает содержимое файла индекса или nullptr, если файл не поместился в кэш
+    [[nodiscard]] const CachedFile* Find(const StaticEntry& entry) const {
+        return entry.id < files_.size() ? files_[entry.id].get() : nullptr;
+    }
+
+    [[nodiscard]] size_t GetFileCount() const noexcept {
+        return file_count_;
+    }
+    [[nodiscard]] uint64_t GetTotalSize() const noexcept {
+        return total_size_;
+    }
+
+    // Сжимать имеет смысл только текстовые форматы: изображения и архивы уже сжаты
+    static bool IsCompressible(std::string_view mime_type);
+    // Сильный ETag из SHA-1 содержимого. Не зависит от сборки и времени изменения файла
+    static std::string MakeEtag(std::string_view content);
+
+private:
+    // Элементы соответствуют файлам индекса
+    std::vector<std::unique_ptr<const CachedFile>> files_;
+    size_t file_count_ = 0;
+    uint64_t total_size_ = 0;
+};
+
+}  // namespace http_handler
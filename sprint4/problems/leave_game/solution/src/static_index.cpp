@@ -0,0 +1,162 @@
+#include "static_index.h"
+
+#include "http_conditional.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <array>
+#include <optional>
+#include <sstream>
+#include <system_error>
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace http_handler {
+
+using namespace std::literals;
+
+namespace {
+
+// Возвращает true, если канонический путь path находится внутри канонического каталога base
+bool IsInside(const fs::path& path, const fs::path& base) {
+    const auto [base_end, path_it] = std::mismatch(base.begin(), base.end(), path.begin(), path.end());
+    return base_end == base.end() && path_it != path.end();
+}
+
+StaticEntry MakeEntry(size_t id, fs::path path, std::string mime_type) {
+    StaticEntry entry{id, std::move(path), std::move(mime_type)};
+    entry.size = fs::file_size(entry.path);
+    entry.last_write_time = fs::last_write_time(entry.path);
+    entry.modified_at = std::chrono::floor<std::chrono::seconds>(
+            std::chrono::file_clock::to_sys(entry.last_write_time));
+    entry.last_modified = FormatHttpDate(entry.modified_at);
+
+    std::ostringstream etag;
+    etag << '"' << std::hex << entry.last_write_time.time_since_epoch().count() << '-' << entry.size << '"';
+    entry.etag = etag.str();
+    return entry;
+}
+
+}  // namespace
+
+StaticIndex::StaticIndex(const fs::path& root, const MimeTypeResolver& get_mime_type) {
+    const fs::path canonical_root = fs::canonical(root);
+    for (const auto& dir_entry :
+         fs::recursive_directory_iterator(canonical_root, fs::directory_options::skip_permission_denied)) {
+        if (!dir_entry.is_regular_file()) {
+            continue;
+        }
+        // Символическая ссылка может вести за пределы каталога
+        fs::path path = fs::canonical(dir_entry.path());
+        if (!IsInside(path, canonical_root)) {
+            continue;
+        }
+
+        const size_t id = files_.size();
+        const fs::path rel_path = dir_entry.path().lexically_relative(canonical_root);
+        files_.push_back(MakeEntry(id, path, get_mime_type(path)));
+
+        AddPath("/"s + rel_path.generic_string(), id);
+        if (rel_path.filename() == "index.html"sv) {
+            // Каталог доступен как с завершающей косой чертой, так и без неё
+            const std::string dir = rel_path.parent_path().generic_string();
+            AddPath("/"s + dir, id);
+            if (!dir.empty()) {
+                AddPath("/"s + dir + "/"s, id);
+            }
+        }
+    }
+}
+
+const StaticEntry* StaticIndex::Find(std::string_view url_path) const {
+    auto it = paths_.find(url_path);
+    if (it == paths_.end()) {
+        // Пути с "." и ".." приводятся к нормальному виду без обращений к файловой системе.
+        // Переход выше корня отбрасывается: "/../a" превращается в "/a"
+        const std::string normal = fs::path(url_path).lexically_normal().generic_string();
+        it = paths_.find(normal);
+        if (it == paths_.end()) {
+            return nullptr;
+        }
+    }
+    return &files_[it->second];
+}
+
+void StaticIndex::AddPath(std::string url_path, size_t id) {
+    paths_.emplace(std::move(url_path), id);
+}
+
+StaticIndexWatcher::StaticIndexWatcher(fs::path root, std::chrono::milliseconds debounce,
+                                       std::function<void()> on_change)
+        : root_(std::move(root))
+        , debounce_(debounce)
+        , on_change_(std::move(on_change))
+        , inotify_fd_(::inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) {
+    if (inotify_fd_ < 0) {
+        throw std::system_error(errno, std::generic_category(), "inotify_init1"s);
+    }
+    AddWatches();
+    thread_ = std::jthread([this](std::stop_token stop_token) {
+        Run(std::move(stop_token));
+    });
+}
+
+StaticIndexWatcher::~StaticIndexWatcher() {
+    // Поток должен завершиться до закрытия дескриптора, который он опрашивает
+    thread_.request_stop();
+    thread_.join();
+    ::close(inotify_fd_);
+}
+
+void StaticIndexWatcher::AddWatches() {
+    constexpr uint32_t mask = IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO
+                              | IN_ATTRIB | IN_DELETE_SELF;
+    // Повторное добавление каталога лишь обновляет маску уже существующего наблюдения
+    ::inotify_add_watch(inotify_fd_, root_.c_str(), mask);
+    std::error_code ec;
+    for (auto it = fs::recursive_directory_iterator(root_, fs::directory_options::skip_permission_denied, ec);
+         !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if (it->is_directory()) {
+            ::inotify_add_watch(inotify_fd_, it->path().c_str(), mask);
+        }
+    }
+}
+
+void StaticIndexWatcher::Run(std::stop_token stop_token) {
+    using Clock = std::chrono::steady_clock;
+    // Период проверки запроса на остановку потока
+    constexpr auto stop_check_period = 200ms;
+
+    std::optional<Clock::time_point> deadline;
+    std::array<char, 4096> events;
+    while (!stop_token.stop_requested()) {
+        auto timeout = stop_check_period;
+        if (deadline) {
+            const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(*deadline - Clock::now());
+            timeout = std::clamp(remaining, 0ms, stop_check_period);
+        }
+
+        pollfd fd{inotify_fd_, POLLIN, 0};
+        if (::poll(&fd, 1, static_cast<int>(timeout.count())) > 0) {
+            // Содержимое событий не важно: после любого изменения индекс строится заново
+            while (::read(inotify_fd_, events.data(), events.size()) > 0) {
+            }
+            deadline = Clock::now() + debounce_;
+            continue;
+        }
+        if (deadline && Clock::now() >= *deadline) {
+            deadline.reset();
+            try {
+                AddWatches();
+                on_change_();
+            } catch (const std::exception& ex) {
+                // Сервер продолжает работать с прежним индексом
+                server_logging::LogServerError(0, ex.what(), "static index"s);
+            }
+        }
+    }
+}
+
+}  // namespace http_handler
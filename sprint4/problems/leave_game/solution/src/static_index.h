@@ -0,0 +1,87 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace http_handler {
+
+namespace fs = std::filesystem;
+
+// Статический файл, найденный при обходе каталога
+struct StaticEntry {
+    // Номер файла в индексе. По нему кэш находит содержимое файла
+    size_t id = 0;
+    // Канонический путь к файлу
+    fs::path path;
+    std::string mime_type;
+    uint64_t size = 0;
+    fs::file_time_type last_write_time;
+    // Время изменения с точностью до секунды, как в заголовке Last-Modified
+    std::chrono::system_clock::time_point modified_at;
+    std::string last_modified;
+    // ETag, вычисленный по времени изменения и размеру, вместе с кавычками
+    std::string etag;
+};
+
+// Индекс статических файлов: отображение декодированного пути URL на файл.
+// Строится обходом каталога, после чего запрос к файлу обслуживается одним поиском в хеш-таблице
+// без обращений к файловой системе. Проверка выхода за пределы каталога выполняется при построении
+class StaticIndex {
+public:
+    using MimeTypeResolver = std::function<std::string(const fs::path&)>;
+
+    StaticIndex() = default;
+    // Обходит каталог root. Ссылки на файлы вне каталога в индекс не попадают
+    StaticIndex(const fs::path& root, const MimeTypeResolver& get_mime_type);
+
+    // Ищет файл по декодированному пути URL. Путь каталога соответствует его index.html
+    [[nodiscard]] const StaticEntry* Find(std::string_view url_path) const;
+
+    [[nodiscard]] const std::vector<StaticEntry>& GetFiles() const noexcept {
+        return files_;
+    }
+
+private:
+    struct StringHasher {
+        using is_transparent = void;
+        size_t operator()(std::string_view str) const noexcept {
+            return std::hash<std::string_view>{}(str);
+        }
+    };
+
+    void AddPath(std::string url_path, size_t id);
+
+    std::vector<StaticEntry> files_;
+    std::unordered_map<std::string, size_t, StringHasher, std::equal_to<>> paths_;
+};
+
+// Следит за изменениями в каталоге через inotify и вызывает on_change после того,
+// как изменения прекратились на время debounce. Обработчик вызывается в потоке наблюдателя
+class StaticIndexWatcher {
+public:
+    StaticIndexWatcher(fs::path root, std::chrono::milliseconds debounce, std::function<void()> on_change);
+    ~StaticIndexWatcher();
+
+    StaticIndexWatcher(const StaticIndexWatcher&) = delete;
+    StaticIndexWatcher& operator=(const StaticIndexWatcher&) = delete;
+
+private:
+    void Run(std::stop_token stop_token);
+    // inotify не следит за подкаталогами, поэтому каждый каталог добавляется отдельно
+    void AddWatches();
+
+    fs::path root_;
+    std::chrono::milliseconds debounce_;
+    std::function<void()> on_change_;
+    int inotify_fd_ = -1;
+    std::jthread thread_;
+};
+
+}  // namespace http_handler
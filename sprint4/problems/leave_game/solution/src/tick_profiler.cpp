@@ -0,0 +1,118 @@
+#include "tick_profiler.h"
+
+#include "json_string.h"
+#include "trace_event.h"
+
+#include <new>
+
+namespace metrics {
+using namespace std::literals;
+
+namespace {
+
+void AppendPhaseEvent(std::string& out, std::string_view name, std::string_view session,
+                      TickProfiler::Clock::time_point start, TickProfiler::Clock::duration duration) {
+    std::string args;
+    if (!session.empty()) {
+        args.append(R"("session":)"sv);
+        util::AppendJsonString(args, session);
+    }
+    AppendCompleteEvent(out, name, "tick"sv, TICK_TRACE_PID, 1, start, duration, args);
+}
+
+}  // namespace
+
+std::string_view GetTickPhaseName(TickPhase phase) noexcept {
+    switch (phase) {
+        case TickPhase::MOVE_DOGS:
+            return "move_dogs"sv;
+        case TickPhase::FILL_GATHERER_PROVIDER:
+            return "fill_gatherer_provider"sv;
+        case TickPhase::DETECT_COLLISIONS:
+            return "detect_collisions"sv;
+        case TickPhase::GENERATE_LOOT:
+            return "generate_loot"sv;
+        case TickPhase::RETIRE_DOG:
+            return "retire_dog"sv;
+    }
+    return "unknown"sv;
+}
+
+void TickProfiler::SetTraceCapacity(size_t tick_count) {
+    std::lock_guard lock{traces_mutex_};
+    traces_.clear();
+    traces_.resize(tick_count);
+    next_trace_ = 0;
+    trace_count_ = 0;
+    tracing_.store(tick_count > 0, std::memory_order_relaxed);
+}
+
+void TickProfiler::AddPhase(TickPhase phase, std::string_view session, Clock::time_point start,
+                            Clock::duration duration) noexcept {
+    phases_[static_cast<size_t>(phase)].Record(duration);
+    if (!in_tick_ || !tracing_.load(std::memory_order_relaxed)) {
+        return;
+    }
+    try {
+        current_.events.push_back({phase, session, start, duration});
+    } catch (const std::bad_alloc&) {
+        // Профилирование не должно прерывать тик: событие теряется
+    }
+}
+
+void TickProfiler::EndTick(Clock::time_point start, Clock::duration duration) {
+    in_tick_ = false;
+    if (!tracing_.load(std::memory_order_relaxed)) {
+        current_.events.clear();
+        return;
+    }
+    current_.start = start;
+    current_.duration = duration;
+    {
+        std::lock_guard lock{traces_mutex_};
+        if (!traces_.empty()) {
+            // Буфер вытесненного тика становится буфером следующего
+            std::swap(traces_[next_trace_], current_);
+            next_trace_ = (next_trace_ + 1) % traces_.size();
+            trace_count_ = std::min(trace_count_ + 1, traces_.size());
+        }
+    }
+    current_.events.clear();
+}
+
+void TickProfiler::WriteChromeTrace(std::string& out) const {
+    std::lock_guard lock{traces_mutex_};
+    out.append(R"({"displayTimeUnit":"ms","traceEvents":[)"sv);
+    bool first = true;
+    const size_t oldest = (next_trace_ + traces_.size() - trace_count_) % std::max<size_t>(traces_.size(), 1);
+    for (size_t i = 0; i < trace_count_; ++i) {
+        const auto& tick = traces_[(oldest + i) % traces_.size()];
+        if (!first) {
+            out += ',';
+        }
+        first = false;
+        AppendPhaseEvent(out, "tick"sv, {}, tick.start, tick.duration);
+        for (const auto& event : tick.events) {
+            out += ',';
+            AppendPhaseEvent(out, GetTickPhaseName(event.phase), event.session, event.start, event.duration);
+        }
+    }
+    out.append("]}"sv);
+}
+
+void TickProfiler::WriteMetrics(TextWriter& writer) const {
+    constexpr auto name = "game_server_tick_phase_duration_seconds"sv;
+    writer.WriteHeader(name, "histogram"sv, "Time of a game tick phase for one session"sv);
+    std::string labels;
+    for (size_t phase = 0; phase < TICK_PHASE_COUNT; ++phase) {
+        labels.assign("phase=\""sv).append(GetTickPhaseName(static_cast<TickPhase>(phase))).append("\""sv);
+        writer.WriteHistogram(name, labels, phases_[phase]);
+    }
+}
+
+TickProfiler& GetTickProfiler() {
+    static TickProfiler profiler;
+    return profiler;
+}
+
+}  // namespace metrics
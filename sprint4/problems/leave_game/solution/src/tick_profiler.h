@@ -0,0 +1,124 @@
+#pragma once
+
+#include "metrics.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace metrics {
+
+// Этапы игрового тика. Сохранение ушедшего игрока выполняется внутри перемещения собак
+enum class TickPhase : uint8_t {
+    MOVE_DOGS,
+    FILL_GATHERER_PROVIDER,
+    DETECT_COLLISIONS,
+    GENERATE_LOOT,
+    RETIRE_DOG
+};
+
+constexpr size_t TICK_PHASE_COUNT = static_cast<size_t>(TickPhase::RETIRE_DOG) + 1;
+
+std::string_view GetTickPhaseName(TickPhase phase) noexcept;
+
+// Профилировщик тиков. Длительность каждого этапа каждой сессии попадает в гистограмму этапа.
+// По запросу профилировщик хранит события последних тиков для выгрузки в формате Chrome trace_event,
+// который открывается в Perfetto и chrome://tracing.
+// Тики выполняются последовательно внутри api_strand, поэтому события текущего тика пишутся без блокировок,
+// а мьютекс защищает только кольцо завершённых тиков
+class TickProfiler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Замеряет этап тика от создания до разрушения
+    class PhaseTimer {
+    public:
+        // Строка session должна жить дольше профилировщика: используется идентификатор карты
+        PhaseTimer(TickProfiler& profiler, TickPhase phase, std::string_view session) noexcept
+                : profiler_(profiler)
+                , phase_(phase)
+                , session_(session)
+                , start_(Clock::now()) {
+        }
+        PhaseTimer(const PhaseTimer&) = delete;
+        PhaseTimer& operator=(const PhaseTimer&) = delete;
+        ~PhaseTimer() {
+            profiler_.AddPhase(phase_, session_, start_, Clock::now() - start_);
+        }
+
+    private:
+        TickProfiler& profiler_;
+        TickPhase phase_;
+        std::string_view session_;
+        Clock::time_point start_;
+    };
+
+    // Отмечает границы тика. События этапов вне тика в трассировку не попадают
+    class TickTimer {
+    public:
+        explicit TickTimer(TickProfiler& profiler) noexcept
+                : profiler_(profiler)
+                , start_(Clock::now()) {
+            profiler_.in_tick_ = true;
+        }
+        TickTimer(const TickTimer&) = delete;
+        TickTimer& operator=(const TickTimer&) = delete;
+        ~TickTimer() {
+            profiler_.EndTick(start_, Clock::now() - start_);
+        }
+
+    private:
+        TickProfiler& profiler_;
+        Clock::time_point start_;
+    };
+
+    // Хранить события последних tick_count тиков. 0 - не хранить, только гистограммы
+    void SetTraceCapacity(size_t tick_count);
+    // Записывает сохранённые тики в формате Chrome trace_event JSON, от старых к новым
+    void WriteChromeTrace(std::string& out) const;
+    // Выводит гистограммы этапов в формате Prometheus
+    void WriteMetrics(TextWriter& writer) const;
+
+    [[nodiscard]] const Histogram& GetPhaseHistogram(TickPhase phase) const noexcept {
+        return phases_[static_cast<size_t>(phase)];
+    }
+
+private:
+    struct TraceEvent {
+        TickPhase phase;
+        std::string_view session;
+        Clock::time_point start;
+        Clock::duration duration;
+    };
+    struct TickTrace {
+        Clock::time_point start;
+        Clock::duration duration{};
+        std::vector<TraceEvent> events;
+    };
+
+    void AddPhase(TickPhase phase, std::string_view session, Clock::time_point start,
+                  Clock::duration duration) noexcept;
+    void EndTick(Clock::time_point start, Clock::duration duration);
+
+    std::array<Histogram, TICK_PHASE_COUNT> phases_;
+    std::atomic<bool> tracing_{false};
+    // Состояние текущего тика. Используется только потоком, выполняющим тик
+    bool in_tick_ = false;
+    TickTrace current_;
+
+    mutable std::mutex traces_mutex_;
+    // Кольцо завершённых тиков. Буферы событий переиспользуются, поэтому после заполнения кольца
+    // трассировка не выделяет память
+    std::vector<TickTrace> traces_;
+    size_t next_trace_ = 0;
+    size_t trace_count_ = 0;
+};
+
+// Профилировщик тиков процесса. Создаётся при первом обращении
+TickProfiler& GetTickProfiler();
+
+}  // namespace metrics
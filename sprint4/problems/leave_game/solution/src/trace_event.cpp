@@ -0,0 +1,53 @@
+#include "trace_event.h"
+#include "json_string.h"
+
+#include <charconv>
+
+namespace metrics {
+using namespace std::literals;
+using util::AppendJsonString;
+
+namespace {
+
+// Время в формате trace_event: микросекунды с дробной частью
+void AppendMicroseconds(std::string& out, std::chrono::nanoseconds value) {
+    char buffer[32];
+    const auto [ptr, ec] = std::to_chars(std::begin(buffer), std::end(buffer),
+                                         static_cast<double>(value.count()) / 1000.0, std::chars_format::fixed, 3);
+    out.append(buffer, ec == std::errc{} ? ptr : buffer);
+}
+
+void AppendEventStart(std::string& out, std::string_view name, std::string_view category, std::string_view phase,
+                      int pid, uint64_t tid, TraceClock::time_point time) {
+    out.append(R"({"name":)"sv);
+    AppendJsonString(out, name);
+    out.append(R"(,"cat":)"sv);
+    AppendJsonString(out, category);
+    out.append(R"(,"ph":")"sv).append(phase);
+    out.append(R"(","pid":)"sv).append(std::to_string(pid));
+    out.append(R"(,"tid":)"sv).append(std::to_string(tid));
+    out.append(R"(,"ts":)"sv);
+    AppendMicroseconds(out, time.time_since_epoch());
+}
+
+}  // namespace
+
+void AppendCompleteEvent(std::string& out, std::string_view name, std::string_view category, int pid, uint64_t tid,
+                         TraceClock::time_point start, TraceClock::duration duration, std::string_view args) {
+    AppendEventStart(out, name, category, "X"sv, pid, tid, start);
+    out.append(R"(,"dur":)"sv);
+    AppendMicroseconds(out, duration);
+    if (!args.empty()) {
+        out.append(R"(,"args":{)"sv).append(args).append("}"sv);
+    }
+    out += '}';
+}
+
+void AppendInstantEvent(std::string& out, std::string_view name, std::string_view category, int pid, uint64_t tid,
+                        TraceClock::time_point time) {
+    AppendEventStart(out, name, category, "i"sv, pid, tid, time);
+    // Мгновенное событие отображается только на дорожке своего потока
+    out.append(R"(,"s":"t"})"sv);
+}
+
+}  // namespace metrics
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace metrics {
+
+// Формат Chrome trace_event: https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU
+// Время событий берётся от steady_clock, поэтому трассировки тиков и запросов одного процесса
+// можно открыть вместе на общей шкале времени
+using TraceClock = std::chrono::steady_clock;
+
+// Процессы трассировки: тики и запросы отображаются отдельными группами дорожек
+constexpr int TICK_TRACE_PID = 1;
+constexpr int REQUEST_TRACE_PID = 2;
+
+// Дописывает событие длительности ("ph":"X"). args - готовое содержимое объекта args без фигурных скобок
+void AppendCompleteEvent(std::string& out, std::string_view name, std::string_view category, int pid, uint64_t tid,
+                         TraceClock::time_point start, TraceClock::duration duration, std::string_view args = {});
+
+// Дописывает мгновенное событие ("ph":"i") на дорожке потока tid
+void AppendInstantEvent(std::string& out, std::string_view name, std::string_view category, int pid, uint64_t tid,
+                        TraceClock::time_point time);
+
+}  // namespace metrics
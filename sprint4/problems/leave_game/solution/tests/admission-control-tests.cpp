@@ -0,0 +1,58 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/admission_control.h"
+
+using namespace std::literals;
+using http_handler::AdmissionController;
+using http_handler::AdmissionSettings;
+
+SCENARIO("API admission control") {
+    const auto now = AdmissionController::Clock::now();
+
+    GIVEN("a controller with a queue of two requests") {
+        AdmissionController admission{AdmissionSettings{2, 100ms, 3s}};
+
+        WHEN("the queue is full") {
+            const auto first = admission.TryEnqueue(now);
+            const auto second = admission.TryEnqueue(now);
+            const auto third = admission.TryEnqueue(now);
+            THEN("extra requests are rejected") {
+                REQUIRE(first);
+                REQUIRE(second);
+                CHECK_FALSE(third);
+                CHECK(admission.GetStats().queue_depth == 2);
+                CHECK(admission.GetStats().rejected_by_depth == 1);
+            }
+            AND_WHEN("a request leaves the queue") {
+                CHECK(admission.Dequeue(*first, now + 10ms));
+                THEN("a new request is admitted") {
+                    CHECK(admission.TryEnqueue(now));
+                }
+            }
+        }
+
+        WHEN("a request waits longer than allowed") {
+            const auto enqueued_at = admission.TryEnqueue(now);
+            REQUIRE(enqueued_at);
+            THEN("it is rejected when dequeued and wait time is tracked") {
+                CHECK_FALSE(admission.Dequeue(*enqueued_at, now + 150ms));
+                const auto stats = admission.GetStats();
+                CHECK(stats.queue_depth == 0);
+                CHECK(stats.rejected_by_wait == 1);
+                CHECK(stats.last_wait == 150ms);
+                CHECK(stats.max_wait == 150ms);
+                CHECK(admission.GetRetryAfter() == 3s);
+            }
+        }
+    }
+
+    GIVEN("a controller without limits") {
+        AdmissionController admission{AdmissionSettings{0, 0ms, 1s}};
+        THEN("requests are never rejected") {
+            for (int i = 0; i < 1000; ++i) {
+                REQUIRE(admission.TryEnqueue(now));
+            }
+            CHECK(admission.Dequeue(now, now + 1h));
+        }
+    }
+}
@@ -0,0 +1,93 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <array>
+#include <string>
+
+#include "../src/api_router.h"
+
+using namespace std::literals;
+using http_handler::ApiRoute;
+using http_handler::MatchApiRoute;
+
+// Маршруты разбираются на этапе компиляции
+static_assert(MatchApiRoute("/api/v1/maps").route == ApiRoute::MAPS);
+static_assert(MatchApiRoute("/api/v1/game/player/action/").route == ApiRoute::ACTION);
+static_assert(http_handler::IsMethodAllowed(ApiRoute::STATE, http_handler::http::verb::head));
+static_assert(!http_handler::IsMethodAllowed(ApiRoute::JOIN, http_handler::http::verb::get));
+
+SCENARIO("API route matching") {
+    GIVEN("targets of known endpoints") {
+        THEN("routes are matched with and without trailing slash") {
+            CHECK(MatchApiRoute("/api/v1/maps/"sv).route == ApiRoute::MAPS);
+            CHECK(MatchApiRoute("/api/v1/game/join"sv).route == ApiRoute::JOIN);
+            CHECK(MatchApiRoute("/api/v1/game/join/"sv).route == ApiRoute::JOIN);
+            CHECK(MatchApiRoute("/api/v1/game/players"sv).route == ApiRoute::PLAYERS);
+            CHECK(MatchApiRoute("/api/v1/game/state"sv).route == ApiRoute::STATE);
+            CHECK(MatchApiRoute("/api/v1/game/tick/"sv).route == ApiRoute::TICK);
+            CHECK(MatchApiRoute("/api/v1/game/records"sv).route == ApiRoute::RECORDS);
+        }
+        THEN("map id and query string are split off without copying") {
+            const auto map_match = MatchApiRoute("/api/v1/maps/map1"sv);
+            CHECK(map_match.route == ApiRoute::MAP_BY_ID);
+            CHECK(map_match.param == "map1"sv);
+
+            const auto records_match = MatchApiRoute("/api/v1/game/records?start=10&maxItems=5"sv);
+            CHECK(records_match.route == ApiRoute::RECORDS);
+            CHECK(records_match.query == "start=10&maxItems=5"sv);
+        }
+    }
+    GIVEN("targets of unknown endpoints") {
+        THEN("they are not matched") {
+            CHECK(MatchApiRoute("/api/v1/game/recordsXYZ"sv).route == ApiRoute::UNKNOWN);
+            CHECK(MatchApiRoute("/api/v1/game/player"sv).route == ApiRoute::UNKNOWN);
+            CHECK(MatchApiRoute("/api/v1/game/join//"sv).route == ApiRoute::UNKNOWN);
+            CHECK(MatchApiRoute("/api/v2/maps"sv).route == ApiRoute::UNKNOWN);
+            CHECK(MatchApiRoute("/index.html"sv).route == ApiRoute::UNKNOWN);
+        }
+    }
+}
+
+SCENARIO("Query string parsing") {
+    GIVEN("a query string") {
+        std::string keys;
+        std::string values;
+        http_handler::ForEachQueryParam("start=1&broken&maxItems=20"sv, [&](std::string_view key, std::string_view value) {
+            keys += key;
+            keys += ';';
+            values += value;
+            values += ';';
+        });
+        THEN("parameters without value are skipped") {
+            CHECK(keys == "start;maxItems;"s);
+            CHECK(values == "1;20;"s);
+        }
+    }
+}
+
+// Запуск: game_server_tests "[benchmark]"
+TEST_CASE("API routing cost per request", "[.][benchmark]") {
+    constexpr std::array TARGETS{
+        "/api/v1/game/state"sv,
+        "/api/v1/game/player/action"sv,
+        "/api/v1/maps/town"sv,
+        "/api/v1/game/records?start=0&maxItems=100"sv,
+    };
+
+    BENCHMARK("MatchApiRoute") {
+        unsigned routes = 0;
+        for (const auto target : TARGETS) {
+            routes += static_cast<unsigned>(MatchApiRoute(target).route);
+        }
+        return routes;
+    };
+
+    BENCHMARK("MatchApiRoute + query parsing") {
+        int sum = 0;
+        const auto match = MatchApiRoute(TARGETS.back());
+        http_handler::ForEachQueryParam(match.query, [&sum](std::string_view, std::string_view value) {
+            sum += static_cast<int>(value.size());
+        });
+        return sum;
+    };
+}
@@ -0,0 +1,137 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <sstream>
+#include <thread>
+
+#include "../src/async_logger.h"
+
+using namespace std::literals;
+using namespace server_logging;
+
+namespace {
+
+size_t CountLines(const std::string& text, std::string_view substring) {
+    size_t count = 0;
+    std::istringstream lines{text};
+    for (std::string line; std::getline(lines, line);) {
+        if (line.find(substring) != std::string::npos) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+}  // namespace
+
+SCENARIO("Single-producer single-consumer ring") {
+    GIVEN("a ring with capacity rounded up to a power of two") {
+        SpscRing<int> ring{3};
+        REQUIRE(ring.Capacity() == 4);
+
+        THEN("values are consumed in FIFO order") {
+            CHECK(ring.TryPush(1));
+            CHECK(ring.TryPush(2));
+            std::vector<int> values;
+            CHECK(ring.ConsumeAll([&values](int value) {
+                values.push_back(value);
+            }) == 2);
+            CHECK(values == std::vector{1, 2});
+        }
+        THEN("a full ring rejects values until they are consumed") {
+            for (int i = 0; i < 4; ++i) {
+                CHECK(ring.TryPush(i));
+            }
+            CHECK_FALSE(ring.TryPush(4));
+            ring.ConsumeAll([](int) {});
+            CHECK(ring.TryPush(5));
+        }
+    }
+}
+
+SCENARIO("Log event formatting") {
+    GIVEN("a request event") {
+        LogEvent event{LogEventType::REQUEST_RECEIVED, std::chrono::system_clock::now()};
+        event.strings[0].Assign("127.0.0.1"sv);
+        event.strings[1].Assign("/api/v1/maps?name=\"a\\b\""sv);
+        event.strings[2].Assign("GET"sv);
+
+        THEN("it is formatted as a JSON object with escaped strings") {
+            std::string out;
+            FormatLogEvent(event, out);
+            CHECK(out.starts_with("{\"timestamp\":\""sv));
+            CHECK(out.ends_with(R"(","message":"request received","data":{"ip":"127.0.0.1",)"
+                                R"("URI":"/api/v1/maps?name=\"a\\b\"","method":"GET"}})"sv));
+        }
+    }
+    GIVEN("a response event") {
+        LogEvent event{LogEventType::RESPONSE_SENT, std::chrono::system_clock::now()};
+        event.numbers = {15, 404, 1200, 13800};
+        event.strings[0].Assign("application/json"sv);
+
+        THEN("numbers are written without quotes") {
+            std::string out;
+            FormatLogEvent(event, out);
+            CHECK(out.ends_with(R"("data":{"response_time":15,"code":404,"content_type":"application/json",)"
+                                R"("strand_wait_us":1200,"handler_time_us":13800}})"sv));
+        }
+    }
+    GIVEN("a string with control characters") {
+        LogEvent event{LogEventType::REQUEST_RECEIVED, std::chrono::system_clock::now()};
+        event.strings[1].Assign("/a\n\r\t\x01"sv);
+
+        THEN("common ones are written as short escapes and the rest as \\u00XX") {
+            std::string out;
+            FormatLogEvent(event, out);
+            CHECK(out.find(R"("URI":"/a\n\r\t\u0001")"sv) != std::string::npos);
+        }
+    }
+    GIVEN("a string longer than the event capacity") {
+        const std::string long_uri(1000, 'a');
+        const LogString str{long_uri};
+
+        THEN("it is truncated") {
+            CHECK(str.View() == std::string_view{long_uri}.substr(0, LogString::CAPACITY));
+        }
+    }
+}
+
+SCENARIO("Asynchronous logger") {
+    GIVEN("events logged from several threads") {
+        std::ostringstream output;
+        {
+            AsyncLogger logger{output};
+            std::vector<std::jthread> threads;
+            for (int t = 0; t < 4; ++t) {
+                threads.emplace_back([&logger] {
+                    LogEvent event{LogEventType::SERVER_ERROR, std::chrono::system_clock::now()};
+                    event.strings[1].Assign("test"sv);
+                    for (int i = 0; i < 100; ++i) {
+                        logger.Log(event);
+                    }
+                });
+            }
+        }
+
+        THEN("every event is written when the logger stops") {
+            CHECK(CountLines(output.str(), R"("message":"error")"sv) == 400);
+        }
+    }
+    GIVEN("a logger with a tiny ring that drains rarely") {
+        std::ostringstream output;
+        uint64_t dropped = 0;
+        {
+            AsyncLogger logger{output, {.ring_capacity = 2, .idle_period = 1s}};
+            const LogEvent event{LogEventType::SERVER_STARTED, std::chrono::system_clock::now()};
+            for (int i = 0; i < 1000; ++i) {
+                logger.Log(event);
+            }
+            dropped = logger.GetDroppedCount();
+        }
+
+        THEN("overflowing events are dropped and reported") {
+            CHECK(dropped > 0);
+            CHECK(CountLines(output.str(), R"("message":"server started")"sv) + dropped == 1000);
+            CHECK(CountLines(output.str(), R"("message":"log events dropped")"sv) >= 1);
+        }
+    }
+}
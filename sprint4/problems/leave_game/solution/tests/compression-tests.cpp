@@ -0,0 +1,68 @@
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/compression.h"
+
+using namespace std::literals;
+
+namespace {
+
+std::string GzipDecompress(const std::string& data) {
+    namespace io = boost::iostreams;
+    io::filtering_istream in;
+    in.push(io::gzip_decompressor());
+    in.push(io::array_source(data.data(), data.size()));
+    return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+}
+
+}  // namespace
+
+SCENARIO("Accept-Encoding negotiation") {
+    using compression::AcceptsGzip;
+
+    GIVEN("Accept-Encoding header values") {
+        THEN("gzip is accepted when listed with non-zero quality") {
+            CHECK(AcceptsGzip("gzip"sv));
+            CHECK(AcceptsGzip("gzip, deflate, br"sv));
+            CHECK(AcceptsGzip("deflate;q=1.0, GZIP;q=0.5"sv));
+            CHECK(AcceptsGzip("br, *"sv));
+        }
+        THEN("gzip is rejected when absent or explicitly forbidden") {
+            CHECK_FALSE(AcceptsGzip(""sv));
+            CHECK_FALSE(AcceptsGzip("identity"sv));
+            CHECK_FALSE(AcceptsGzip("gzip;q=0"sv));
+            CHECK_FALSE(AcceptsGzip("gzip; q=0.000, *"sv));
+            CHECK_FALSE(AcceptsGzip("*;q=0"sv));
+        }
+    }
+}
+
+SCENARIO("Response body encoding") {
+    using compression::EncodeBody;
+
+    GIVEN("a repetitive body longer than the threshold") {
+        std::string body;
+        for (int i = 0; i < 200; ++i) {
+            body += R"({"pos":[1.0,2.0],"speed":[0.0,0.0],"dir":"U"})"s;
+        }
+        WHEN("the body is encoded") {
+            const auto encoded = EncodeBody(body, {512, 6});
+            THEN("the gzip variant is smaller and decompresses to the original") {
+                REQUIRE_FALSE(encoded.gzip.empty());
+                CHECK(encoded.gzip.size() < body.size());
+                CHECK(encoded.plain == body);
+                CHECK(GzipDecompress(encoded.gzip) == body);
+            }
+        }
+    }
+
+    GIVEN("a body shorter than the threshold") {
+        const auto encoded = EncodeBody(R"({"maps":[]})"s, {512, 6});
+        THEN("it is not compressed") {
+            CHECK(encoded.gzip.empty());
+            CHECK(encoded.plain == R"({"maps":[]})"s);
+        }
+    }
+}
@@ -0,0 +1,226 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/asio/use_future.hpp>
+
+#include "../src/postgres.h"
+
+using namespace std::literals;
+using postgres::AsyncConnection;
+using postgres::ConnectionPool;
+
+namespace {
+
+namespace net = boost::asio;
+
+// Соединение без сервера. Пул узнаёт о его состоянии только через IsOpen
+class FakeConnection : public AsyncConnection {
+public:
+    FakeConnection(Executor executor, int& closed)
+            : AsyncConnection(executor, nullptr)
+            , closed_(closed) {
+    }
+    ~FakeConnection() override {
+        ++closed_;
+    }
+
+    [[nodiscard]] bool IsOpen() const noexcept override {
+        return open;
+    }
+
+    bool open = true;
+
+private:
+    int& closed_;
+};
+
+// Пул, открывающий поддельные соединения. Первые failures попыток открыть соединение завершаются ошибкой
+struct PoolFixture {
+    explicit PoolFixture(postgres::ConnectionPoolSettings settings)
+            : pool(net::make_strand(ioc), settings, [this]() -> net::awaitable<std::unique_ptr<AsyncConnection>> {
+                ++opened;
+                if (failures > 0) {
+                    --failures;
+                    throw postgres::DatabaseError("Connection refused"s);
+                }
+                co_return std::make_unique<FakeConnection>(ioc.get_executor(), closed);
+            }) {
+    }
+
+    // Выполняет сопрограмму теста до завершения всех операций пула
+    template <typename Awaitable>
+    void Run(Awaitable test) {
+        auto done = net::co_spawn(ioc, std::move(test), net::use_future);
+        ioc.run();
+        done.get();
+    }
+
+    static postgres::ConnectionPoolSettings MakeSettings(size_t min_size, size_t max_size) {
+        postgres::ConnectionPoolSettings settings;
+        settings.min_size = min_size;
+        settings.max_size = max_size;
+        settings.acquire_timeout = 50ms;
+        // Проверка запросом к серверу поддельным соединениям недоступна
+        settings.validation_interval = 1h;
+        return settings;
+    }
+
+    net::io_context ioc;
+    int opened = 0;
+    int closed = 0;
+    int failures = 0;
+    ConnectionPool pool;
+};
+
+net::awaitable<void> Sleep(std::chrono::milliseconds duration) {
+    net::steady_timer timer{co_await net::this_coro::executor, duration};
+    co_await timer.async_wait(net::use_awaitable);
+}
+
+// Возвращает true, если выполнение awaitable завершилось исключением Exception
+template <typename Exception, typename T>
+net::awaitable<bool> Throws(net::awaitable<T> awaitable) {
+    try {
+        co_await std::move(awaitable);
+    } catch (const Exception&) {
+        co_return true;
+    }
+    co_return false;
+}
+
+// Ждёт соединение и проверяет, что получено именно expected
+net::awaitable<bool> WaitForConnection(ConnectionPool& pool, const AsyncConnection* expected) {
+    auto conn = co_await pool.GetConnection(5s);
+    co_return conn && &**conn == expected;
+}
+
+// Ждёт соединение и отмечает в order, что получила его
+net::awaitable<void> TakeConnection(ConnectionPool& pool, std::vector<std::string>& order, std::string name) {
+    auto conn = co_await pool.GetConnection(5s);
+    if (conn) {
+        order.push_back(std::move(name));
+    }
+}
+
+}  // namespace
+
+SCENARIO("Connection pool") {
+    GIVEN("a pool of one connection") {
+        PoolFixture fixture{PoolFixture::MakeSettings(0, 1)};
+        auto& pool = fixture.pool;
+
+        WHEN("the connection is busy") {
+            THEN("waiting for another one times out") {
+                fixture.Run([&pool]() -> net::awaitable<void> {
+                    auto conn = co_await pool.GetConnection();
+                    const auto started_at = std::chrono::steady_clock::now();
+                    auto second = co_await pool.GetConnection(30ms);
+                    CHECK_FALSE(second.has_value());
+                    CHECK(std::chrono::steady_clock::now() - started_at >= 30ms);
+                    const bool timed_out = co_await Throws<postgres::ConnectionPoolTimeout>(pool.GetConnection());
+                    CHECK(timed_out);
+                }());
+                CHECK(fixture.opened == 1);
+            }
+
+            THEN("a waiter gets the connection as soon as it is returned") {
+                std::optional<bool> got_same;
+                std::chrono::steady_clock::time_point released_at;
+                std::chrono::steady_clock::time_point got_at;
+                fixture.Run([&]() -> net::awaitable<void> {
+                    auto conn = std::make_optional(co_await pool.GetConnection());
+                    // Ожидающая сопрограмма запускается сразу и ждёт, пока соединение занято
+                    net::co_spawn(fixture.ioc, WaitForConnection(pool, &**conn),
+                                  [&](std::exception_ptr, bool same) {
+                                      got_same = same;
+                                      got_at = std::chrono::steady_clock::now();
+                                  });
+                    co_await Sleep(10ms);
+                    CHECK_FALSE(got_same.has_value());
+                    released_at = std::chrono::steady_clock::now();
+                    conn.reset();
+                }());
+                REQUIRE(got_same.has_value());
+                CHECK(*got_same);
+                CHECK(got_at - released_at < 1s);
+                CHECK(fixture.opened == 1);
+            }
+        }
+
+        WHEN("a new request arrives right after the connection is returned to a waiter") {
+            THEN("the waiter gets the connection first") {
+                std::vector<std::string> order;
+                fixture.Run([&]() -> net::awaitable<void> {
+                    auto conn = std::make_optional(co_await pool.GetConnection());
+                    net::co_spawn(fixture.ioc, TakeConnection(pool, order, "waiter"s), net::detached);
+                    co_await Sleep(10ms);
+                    // Соединение возвращается, и сразу, до пробуждения ждущей сопрограммы, приходит новый запрос
+                    conn.reset();
+                    co_await TakeConnection(pool, order, "newcomer"s);
+                }());
+                CHECK(order == std::vector<std::string>{"waiter"s, "newcomer"s});
+                CHECK(fixture.opened == 1);
+            }
+        }
+
+        WHEN("opening a connection fails") {
+            fixture.failures = 1;
+
+            THEN("its place is released for the next attempt") {
+                fixture.Run([&pool]() -> net::awaitable<void> {
+                    const bool failed = co_await Throws<postgres::DatabaseError>(pool.GetConnection());
+                    CHECK(failed);
+                    auto conn = co_await pool.GetConnection(1s);
+                    CHECK(conn.has_value());
+                }());
+                CHECK(fixture.opened == 2);
+            }
+        }
+
+        WHEN("a broken connection is returned") {
+            THEN("it is closed and a new one is opened in its place") {
+                fixture.Run([&pool]() -> net::awaitable<void> {
+                    {
+                        auto conn = co_await pool.GetConnection();
+                        static_cast<FakeConnection&>(*conn).open = false;
+                    }
+                    auto conn = co_await pool.GetConnection(1s);
+                    CHECK(conn.has_value());
+                }());
+                CHECK(fixture.opened == 2);
+                CHECK(fixture.closed == 1);
+            }
+        }
+    }
+
+    GIVEN("a pool that keeps one idle connection") {
+        auto settings = PoolFixture::MakeSettings(1, 3);
+        settings.idle_timeout = 200ms;
+        PoolFixture fixture{settings};
+        auto& pool = fixture.pool;
+
+        WHEN("connections stay idle longer than the idle timeout") {
+            THEN("all but the minimum are closed") {
+                fixture.Run([&pool, &fixture]() -> net::awaitable<void> {
+                    {
+                        auto first = co_await pool.GetConnection();
+                        auto second = co_await pool.GetConnection();
+                        auto third = co_await pool.GetConnection();
+                    }
+                    co_await Sleep(5ms);
+                    pool.EvictIdleConnections();
+                    co_await Sleep(5ms);
+                    CHECK(fixture.closed == 0);
+
+                    co_await Sleep(250ms);
+                    pool.EvictIdleConnections();
+                    co_await Sleep(5ms);
+                    CHECK(fixture.closed == 2);
+                }());
+                CHECK(fixture.opened == 3);
+            }
+        }
+    }
+}
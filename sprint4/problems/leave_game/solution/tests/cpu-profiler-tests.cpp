@@ -0,0 +1,68 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/cpu_profiler.h"
+
+#include <cmath>
+#include <sstream>
+#include <string>
+
+using namespace std::literals;
+using namespace metrics;
+
+namespace {
+
+volatile double burn_result = 0;
+
+// Занимает процессор на время duration
+void BurnCpu(std::chrono::milliseconds duration) {
+    const auto end = std::chrono::steady_clock::now() + duration;
+    double sum = 0;
+    while (std::chrono::steady_clock::now() < end) {
+        for (int i = 0; i < 1000; ++i) {
+            sum += std::sqrt(static_cast<double>(i));
+        }
+    }
+    burn_result = sum;
+}
+
+}  // namespace
+
+SCENARIO("CPU profiler") {
+    GIVEN("a profiler with the current thread registered") {
+        CpuProfiler profiler;
+        const CpuProfiler::ThreadScope profiled_thread{profiler};
+
+        WHEN("the thread burns CPU while profiling") {
+            REQUIRE(profiler.Start(250, 1s));
+            const bool started_twice = profiler.Start(250, 1s);
+            BurnCpu(300ms);
+            const std::string stacks = profiler.Stop();
+
+            THEN("only one profiling runs at a time") {
+                CHECK_FALSE(started_twice);
+            }
+            THEN("samples are returned as collapsed stacks") {
+                REQUIRE_FALSE(stacks.empty());
+                std::istringstream lines{stacks};
+                std::string line;
+                size_t samples = 0;
+                while (std::getline(lines, line)) {
+                    const auto space = line.rfind(' ');
+                    REQUIRE(space != std::string::npos);
+                    CHECK(space > 0);
+                    samples += std::stoul(line.substr(space + 1));
+                }
+                CHECK(samples > 0);
+            }
+            THEN("the profiler can be started again") {
+                CHECK(profiler.Start(250, 1s));
+                profiler.Stop();
+            }
+        }
+        WHEN("the profiler is stopped without being started") {
+            THEN("no stacks are returned") {
+                CHECK(profiler.Stop().empty());
+            }
+        }
+    }
+}
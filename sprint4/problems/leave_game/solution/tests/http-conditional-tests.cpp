@@ -0,0 +1,135 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <fstream>
+
+#include "../src/file_range_body.h"
+#include "../src/http_conditional.h"
+
+#include <boost/beast/core/buffers_to_string.hpp>
+#include <boost/beast/http/write.hpp>
+
+using namespace std::literals;
+using namespace http_handler;
+namespace fs = std::filesystem;
+
+namespace {
+
+// Синхронный поток, собирающий записанные данные в строку
+struct StringWriteStream {
+    std::string data;
+
+    template <typename ConstBufferSequence>
+    size_t write_some(const ConstBufferSequence& buffers) {
+        data += beast::buffers_to_string(buffers);
+        return net::buffer_size(buffers);
+    }
+
+    template <typename ConstBufferSequence>
+    size_t write_some(const ConstBufferSequence& buffers, beast::error_code& ec) {
+        ec = {};
+        return write_some(buffers);
+    }
+};
+
+}  // namespace
+
+SCENARIO("HTTP dates") {
+    using namespace std::chrono;
+    const auto time = sys_days{1994y / November / 6} + 8h + 49min + 37s;
+
+    THEN("dates are formatted as IMF-fixdate") {
+        CHECK(FormatHttpDate(time) == "Sun, 06 Nov 1994 08:49:37 GMT"s);
+    }
+    THEN("formatted dates are parsed back") {
+        CHECK(ParseHttpDate("Sun, 06 Nov 1994 08:49:37 GMT"sv) == time);
+        CHECK(ParseHttpDate(FormatHttpDate(time)) == time);
+    }
+    THEN("malformed dates are rejected") {
+        CHECK_FALSE(ParseHttpDate(""sv));
+        CHECK_FALSE(ParseHttpDate("yesterday"sv));
+        CHECK_FALSE(ParseHttpDate("Sun, 06 Nov 1994 08:49:37 GMT trailing"sv));
+    }
+}
+
+SCENARIO("If-None-Match matching") {
+    const auto etag = "\"abc-10\""sv;
+
+    THEN("the list is searched with weak comparison") {
+        CHECK(MatchesEtag("\"abc-10\""sv, etag));
+        CHECK(MatchesEtag("\"x\", \"abc-10\""sv, etag));
+        CHECK(MatchesEtag("W/\"abc-10\""sv, etag));
+        CHECK(MatchesEtag("\"abc-10\""sv, "W/\"abc-10\""sv));
+        CHECK(MatchesEtag("*"sv, etag));
+    }
+    THEN("other tags do not match") {
+        CHECK_FALSE(MatchesEtag("\"abc-11\""sv, etag));
+        CHECK_FALSE(MatchesEtag("\"x\",\"y\""sv, etag));
+    }
+}
+
+SCENARIO("Range header parsing") {
+    using Status = ParsedRange::Status;
+    constexpr uint64_t size = 1000;
+
+    THEN("a single range is satisfiable") {
+        auto range = ParseRange("bytes=0-499"sv, size);
+        CHECK(range.status == Status::SATISFIABLE);
+        CHECK(range.range.offset == 0);
+        CHECK(range.range.length == 500);
+
+        range = ParseRange("bytes=500-"sv, size);
+        CHECK(range.status == Status::SATISFIABLE);
+        CHECK(range.range.offset == 500);
+        CHECK(range.range.length == 500);
+
+        range = ParseRange("bytes=-100"sv, size);
+        CHECK(range.status == Status::SATISFIABLE);
+        CHECK(range.range.offset == 900);
+        CHECK(range.range.length == 100);
+    }
+    THEN("ranges past the end of the file are truncated") {
+        auto range = ParseRange("bytes=900-5000"sv, size);
+        CHECK(range.status == Status::SATISFIABLE);
+        CHECK(range.range.length == 100);
+
+        range = ParseRange("bytes=-5000"sv, size);
+        CHECK(range.status == Status::SATISFIABLE);
+        CHECK(range.range.offset == 0);
+        CHECK(range.range.length == size);
+    }
+    THEN("ranges starting past the end are unsatisfiable") {
+        CHECK(ParseRange("bytes=1000-"sv, size).status == Status::UNSATISFIABLE);
+        CHECK(ParseRange("bytes=-0"sv, size).status == Status::UNSATISFIABLE);
+        CHECK(ParseRange("bytes=0-"sv, 0).status == Status::UNSATISFIABLE);
+    }
+    THEN("malformed and multiple ranges are ignored") {
+        CHECK(ParseRange("items=0-10"sv, size).status == Status::IGNORED);
+        CHECK(ParseRange("bytes=10-5"sv, size).status == Status::IGNORED);
+        CHECK(ParseRange("bytes=a-b"sv, size).status == Status::IGNORED);
+        CHECK(ParseRange("bytes=0-10,20-30"sv, size).status == Status::IGNORED);
+        CHECK(ParseRange("bytes=-"sv, size).status == Status::IGNORED);
+    }
+}
+
+SCENARIO("File range body") {
+    const auto path = fs::temp_directory_path() / "file-range-body-test.txt";
+    std::ofstream(path, std::ios::binary) << "0123456789"s;
+
+    FileRangeBody::value_type body;
+    beast::error_code ec;
+    body.open(path.c_str(), 3, 4, ec);
+    REQUIRE_FALSE(ec);
+
+    http::response<FileRangeBody> res{http::status::partial_content, 11};
+    res.body() = std::move(body);
+    res.prepare_payload();
+    StringWriteStream out;
+    http::write(out, res);
+
+    THEN("only the requested part of the file is sent") {
+        CHECK(res[http::field::content_length] == "4"sv);
+        CHECK(out.data.ends_with("\r\n\r\n3456"sv));
+    }
+    fs::remove(path);
+}
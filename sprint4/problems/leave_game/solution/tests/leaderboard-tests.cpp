@@ -0,0 +1,121 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/leaderboard.h"
+
+using leaderboard::Leaderboard;
+using leaderboard::Record;
+
+namespace {
+
+std::vector<std::string> GetNames(const leaderboard::Page& page) {
+    std::vector<std::string> names;
+    for (const auto& record : page.records) {
+        names.push_back(record.name);
+    }
+    return names;
+}
+
+}  // namespace
+
+SCENARIO("In-memory table of records") {
+    GIVEN("a table loaded from the database") {
+        Leaderboard table;
+        table.Reset({
+                {"1", "Rex", 10, 5000},
+                {"2", "Bim", 30, 9000},
+                {"3", "Ace", 10, 5000},
+                {"4", "Tom", 10, 3000},
+        });
+
+        THEN("records are ordered by score, play time and name") {
+            CHECK(GetNames(table.GetPage(0, 100)) == std::vector<std::string>{"Bim", "Tom", "Ace", "Rex"});
+            CHECK(table.GetSize() == 4);
+        }
+
+        THEN("a page starts at the given position") {
+            CHECK(GetNames(table.GetPage(1, 2)) == std::vector<std::string>{"Tom", "Ace"});
+            CHECK(GetNames(table.GetPage(3, 10)) == std::vector<std::string>{"Rex"});
+            CHECK(table.GetPage(4, 10).records.empty());
+            CHECK(table.GetPage(100, 10).records.empty());
+            CHECK(table.GetPage(0, 0).records.empty());
+        }
+
+        WHEN("a retired player is added") {
+            const auto version = table.GetVersion();
+            const auto old_page = table.GetPage(0, 2);
+            table.Add({"5", "Max", 20, 1000});
+
+            THEN("the player takes their place and the version changes") {
+                CHECK(GetNames(table.GetPage(0, 100)) == std::vector<std::string>{"Bim", "Max", "Tom", "Ace", "Rex"});
+                CHECK(table.GetVersion() != version);
+                CHECK(old_page.version == version);
+                CHECK(table.GetPage(0, 2).version == table.GetVersion());
+            }
+        }
+
+        WHEN("players with the same name and result are added") {
+            table.Add({"6", "Rex", 10, 5000});
+            table.Add({"7", "Rex", 10, 5000});
+
+            THEN("all of them are kept") {
+                CHECK(table.GetSize() == 6);
+                CHECK(GetNames(table.GetPage(3, 3)) == std::vector<std::string>{"Rex", "Rex", "Rex"});
+            }
+        }
+
+        WHEN("pages are read with a cursor") {
+            const auto first = table.GetPage(0, 2);
+            const auto cursor = leaderboard::EncodeCursor(first.records.back());
+            const auto after = leaderboard::DecodeCursor(cursor);
+            REQUIRE(after);
+
+            THEN("the next page starts after the cursor record") {
+                CHECK(GetNames(table.GetPageAfter(*after, 2)) == std::vector<std::string>{"Ace", "Rex"});
+                CHECK(GetNames(table.GetPageAfter(table.GetPage(3, 1).records.back(), 2)).empty());
+            }
+
+            AND_WHEN("a player is added before the cursor") {
+                table.Add({"5", "Max", 50, 1000});
+
+                THEN("the next page does not repeat records") {
+                    CHECK(GetNames(table.GetPageAfter(*after, 2)) == std::vector<std::string>{"Ace", "Rex"});
+                }
+            }
+        }
+
+        WHEN("the table is reloaded") {
+            table.Reset({{"8", "Ann", 1, 1}});
+
+            THEN("old records are replaced") {
+                CHECK(GetNames(table.GetPage(0, 100)) == std::vector<std::string>{"Ann"});
+            }
+        }
+    }
+}
+
+SCENARIO("Table of records cursor") {
+    GIVEN("a record whose name contains the field separator") {
+        const Record record{"0b5e7e0c-7e0e-4f7e-9d7e-0c7e0e4f7e9d", "Rex: the dog", -3, 12345};
+
+        THEN("the cursor is URL-safe and decodes to the same position") {
+            const auto cursor = leaderboard::EncodeCursor(record);
+            CHECK(cursor.find_first_not_of("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_")
+                  == std::string::npos);
+            const auto decoded = leaderboard::DecodeCursor(cursor);
+            REQUIRE(decoded);
+            CHECK(decoded->id == record.id);
+            CHECK(decoded->name == record.name);
+            CHECK(decoded->score == record.score);
+            CHECK(decoded->play_time_ms == record.play_time_ms);
+        }
+    }
+
+    THEN("malformed cursors are rejected") {
+        CHECK_FALSE(leaderboard::DecodeCursor("not a cursor"));
+        CHECK_FALSE(leaderboard::DecodeCursor(""));
+        // "10:20" - нет идентификатора и имени
+        CHECK_FALSE(leaderboard::DecodeCursor("MTA6MjA"));
+        // "x:1:id:name" - очки не число
+        CHECK_FALSE(leaderboard::DecodeCursor("eDoxOmlkOm5hbWU"));
+    }
+}
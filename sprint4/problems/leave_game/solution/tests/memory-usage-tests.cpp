@@ -0,0 +1,99 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/app.h"
+#include "../src/json_loader.h"
+#include "../src/memory_usage.h"
+#include "../src/model.h"
+
+using namespace std::literals;
+using namespace memory_usage;
+
+SCENARIO("Container memory estimates") {
+    GIVEN("a vector with reserved capacity") {
+        std::vector<int> vector;
+        vector.reserve(100);
+        vector.push_back(1);
+
+        THEN("the estimate follows the capacity, not the size") {
+            CHECK(EstimateHeap(vector) == 100 * sizeof(int));
+        }
+    }
+    GIVEN("short and long strings") {
+        const std::string short_string = "dog"s;
+        const std::string long_string(100, 'x');
+
+        THEN("only strings outside the inline buffer use the heap") {
+            CHECK(EstimateHeap(short_string) == 0);
+            CHECK(EstimateHeap(long_string) >= 101);
+        }
+    }
+    GIVEN("a JSON array of objects") {
+        const json::value value = json::parse(R"([{"name":"key","file":"assets/key.obj"},{"name":"wallet"}])");
+
+        THEN("nested arrays, objects and strings are counted") {
+            CHECK(EstimateHeap(value) >= 2 * sizeof(json::value) + 3 * sizeof(json::key_value_pair));
+        }
+    }
+    GIVEN("the allocator") {
+        THEN("statistics report memory in use") {
+            CHECK(GetAllocatorStats().in_use > 0);
+            CHECK(GetMallocInfo().find("<malloc"sv) != std::string::npos);
+        }
+    }
+}
+
+// Игроки входят, подбирают предметы и уходят. Если какой-то индекс не освобождает записи ушедших игроков,
+// оценка и занятая память растут от раунда к раунду
+SCENARIO("Memory does not grow under player churn", "[soak]") {
+    constexpr int ROUNDS = 200;
+    constexpr int WARMUP_ROUNDS = 10;
+    constexpr int PLAYERS_PER_ROUND = 50;
+    // Допустимый рост памяти, занятой в куче всем процессом: запас на буферы тестового фреймворка
+    constexpr size_t ALLOCATOR_SLACK = 256 * 1024;
+
+    GIVEN("a game session and a token index") {
+        model::Game game = json_loader::LoadGame("../tests/data/test_config.json"s);
+        const auto session = game.AddSession(model::Map::Id("town"s));
+        app::DogTokens tokens;
+
+        WHEN("players repeatedly join, collect loot and leave") {
+            size_t warmup_peak = 0;
+            size_t warmup_in_use = 0;
+            size_t last_peak = 0;
+            for (int round = 0; round < ROUNDS; ++round) {
+                for (int i = 0; i < PLAYERS_PER_ROUND; ++i) {
+                    const auto dog = session->AddDog("Player "s + std::to_string(i));
+                    [[maybe_unused]] const auto token = tokens.AddDog(dog, session);
+                }
+                session->AddLoots(PLAYERS_PER_ROUND);
+                auto dog_it = session->GetDogs().begin();
+                while (!session->GetLoots().empty()) {
+                    const auto loot = session->GetLoots().begin()->second;
+                    dog_it->second->AddLootToBag(loot);
+                    session->DeleteLoot(loot);
+                    ++dog_it;
+                }
+
+                const auto usage = session->EstimateMemoryUsage();
+                last_peak = usage.Total() + tokens.EstimateHeapUsage();
+
+                for (auto it = session->GetDogs().begin(); it != session->GetDogs().end();) {
+                    tokens.DeleteDogToken(it->second);
+                    session->DeleteDog(it);
+                }
+                if (round + 1 == WARMUP_ROUNDS) {
+                    warmup_peak = last_peak;
+                    warmup_in_use = GetAllocatorStats().in_use;
+                }
+            }
+
+            THEN("the estimated peak stays at its warm-up level") {
+                CHECK(last_peak <= warmup_peak);
+                CHECK(session->EstimateMemoryUsage().Total() == 0);
+            }
+            THEN("the allocator does not accumulate memory") {
+                CHECK(GetAllocatorStats().in_use <= warmup_in_use + ALLOCATOR_SLACK);
+            }
+        }
+    }
+}
@@ -0,0 +1,122 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../src/metrics.h"
+
+using namespace std::literals;
+using namespace metrics;
+
+SCENARIO("Histogram buckets") {
+    GIVEN("values of different magnitude") {
+        THEN("small values get exact buckets") {
+            for (uint64_t value = 0; value < Histogram::SUB_BUCKET_COUNT; ++value) {
+                CHECK(Histogram::GetBucketIndex(value) == value);
+                CHECK(Histogram::GetBucketLowerBound(value) == value);
+            }
+        }
+        THEN("each value lies between the lower bounds of its bucket and the next one") {
+            for (const uint64_t value : {5ull, 8ull, 15ull, 16ull, 1000ull, 123456ull, (1ull << 31) + 7}) {
+                const size_t index = Histogram::GetBucketIndex(value);
+                CHECK(Histogram::GetBucketLowerBound(index) <= value);
+                CHECK(value < Histogram::GetBucketLowerBound(index + 1));
+            }
+        }
+        THEN("a bucket is at most a quarter of its lower bound wide") {
+            for (size_t index = Histogram::SUB_BUCKET_COUNT; index + 1 < Histogram::BUCKET_COUNT; ++index) {
+                const uint64_t lower = Histogram::GetBucketLowerBound(index);
+                CHECK(Histogram::GetBucketLowerBound(index + 1) - lower <= lower / 4);
+            }
+        }
+        THEN("huge values go to the last bucket") {
+            CHECK(Histogram::GetBucketIndex(1ull << 40) == Histogram::BUCKET_COUNT - 1);
+            CHECK(Histogram::GetBucketIndex(UINT64_MAX) == Histogram::BUCKET_COUNT - 1);
+        }
+    }
+}
+
+SCENARIO("Recording metrics from several threads") {
+    GIVEN("a counter and a histogram") {
+        Counter counter;
+        Histogram histogram;
+
+        WHEN("threads record values concurrently") {
+            constexpr int thread_count = 8;
+            constexpr int per_thread = 1000;
+            std::vector<std::thread> threads;
+            for (int i = 0; i < thread_count; ++i) {
+                threads.emplace_back([&counter, &histogram] {
+                    for (int j = 0; j < per_thread; ++j) {
+                        counter.Add();
+                        histogram.Record(100us);
+                    }
+                });
+            }
+            for (auto& thread : threads) {
+                thread.join();
+            }
+
+            THEN("no value is lost") {
+                CHECK(counter.Get() == thread_count * per_thread);
+                const auto snapshot = histogram.Collect();
+                CHECK(snapshot.count == thread_count * per_thread);
+                CHECK(snapshot.sum == 100u * thread_count * per_thread);
+                CHECK(snapshot.buckets[Histogram::GetBucketIndex(100)] == thread_count * per_thread);
+            }
+        }
+    }
+}
+
+SCENARIO("Prometheus text format") {
+    GIVEN("a histogram with two values") {
+        Histogram histogram;
+        histogram.Record(20us);
+        histogram.Record(3ms);
+
+        WHEN("it is written") {
+            std::string out;
+            TextWriter writer{out};
+            writer.WriteHistogram("latency_seconds"sv, R"(route="maps")"sv, histogram);
+
+            THEN("buckets are cumulative and end with +Inf, sum and count") {
+                CHECK(out.starts_with("latency_seconds_bucket{route=\"maps\",le=\"1.6e-05\"} 0\n"
+                                      "latency_seconds_bucket{route=\"maps\",le=\"3.2e-05\"} 1\n"sv));
+                CHECK(out.find("le=\"0.004096\"} 2\n"sv) != std::string::npos);
+                CHECK(out.ends_with("latency_seconds_bucket{route=\"maps\",le=\"+Inf\"} 2\n"
+                                    "latency_seconds_sum{route=\"maps\"} 0.00302\n"
+                                    "latency_seconds_count{route=\"maps\"} 2\n"sv));
+            }
+        }
+    }
+    GIVEN("an empty histogram") {
+        Histogram histogram;
+
+        THEN("nothing is written") {
+            std::string out;
+            TextWriter{out}.WriteHistogram("latency_seconds"sv, {}, histogram);
+            CHECK(out.empty());
+        }
+    }
+    GIVEN("server metrics with a recorded request") {
+        // Гистограммы занимают сотни килобайт, поэтому объект размещается в куче
+        auto server_metrics = std::make_unique<ServerMetrics>();
+        server_metrics->RecordRequest(http_handler::ApiRoute::STATE, 200, 1ms);
+        server_metrics->RecordRequest(std::nullopt, 404, 1ms);
+        server_metrics->dogs.Set(3);
+
+        WHEN("they are written") {
+            std::string out;
+            server_metrics->Write(out);
+
+            THEN("requests are labelled by route and status class") {
+                CHECK(out.find(R"(game_server_http_request_duration_seconds_count{route="state",status="2xx"} 1)"sv)
+                      != std::string::npos);
+                CHECK(out.find(R"(game_server_http_request_duration_seconds_count{route="static",status="4xx"} 1)"sv)
+                      != std::string::npos);
+                CHECK(out.find("# TYPE game_server_dogs gauge\ngame_server_dogs 3\n"sv) != std::string::npos);
+            }
+        }
+    }
+}
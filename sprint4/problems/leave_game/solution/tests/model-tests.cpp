@@ -48,5 +48,20 @@ SCENARIO("Model testing") {
                 }
             }
         }
+        WHEN("State of one session changes") {
+            const auto town = game.AddSession(model::Map::Id("town"s));
+            const auto map1 = game.AddSession(model::Map::Id("map1"s));
+            const auto town_version = town->GetStateVersion();
+            const auto map1_version = map1->GetStateVersion();
+            town->AddDog("DogName1");
+            THEN("Only its state version changes") {
+                REQUIRE(town->GetStateVersion() != town_version);
+                REQUIRE(map1->GetStateVersion() == map1_version);
+            }
+            THEN("Versions of different sessions do not repeat") {
+                REQUIRE(town->GetStateVersion() != map1->GetStateVersion());
+                REQUIRE(town_version != map1_version);
+            }
+        }
     }
 }
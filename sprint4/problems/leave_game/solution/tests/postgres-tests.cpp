@@ -0,0 +1,150 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/use_future.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "../src/postgres.h"
+
+using namespace std::literals;
+using postgres::AsyncConnection;
+using postgres::RetiredPlayersRepository;
+
+namespace {
+
+namespace net = boost::asio;
+
+constexpr auto TIMEOUT = 5s;
+
+// Тесты с сервером Postgres выполняются, только если задана переменная окружения GAME_DB_URL
+std::optional<std::string> GetTestDbUrl() {
+    if (const auto* url = std::getenv("GAME_DB_URL")) {
+        return url;
+    }
+    return std::nullopt;
+}
+
+template <typename T>
+T RunAsync(net::io_context& ioc, net::awaitable<T> awaitable) {
+    auto done = net::co_spawn(ioc, std::move(awaitable), net::use_future);
+    ioc.run();
+    ioc.restart();
+    return done.get();
+}
+
+net::awaitable<int> ExecutePreparedTwice(AsyncConnection::Executor executor, std::string url) {
+    const auto conn = co_await AsyncConnection::Connect(executor, std::move(url), TIMEOUT);
+    co_await conn->Prepare("add_one"s, "SELECT $1::integer + 1;"s, TIMEOUT);
+    std::vector<std::string> first_params{"1"s};
+    const auto first = co_await conn->ExecutePrepared("add_one"s, std::move(first_params), TIMEOUT);
+    std::vector<std::string> second_params{"41"s};
+    const auto second = co_await conn->ExecutePrepared("add_one"s, std::move(second_params), TIMEOUT);
+    co_return first.GetInt(0, 0) + second.GetInt(0, 0);
+}
+
+// Записывает игрока дважды и возвращает, сколько раз он встретился в загруженной таблице
+net::awaitable<int> SaveTwiceAndCount(AsyncConnection::Executor executor, std::string url,
+                                      postgres::RetiredPlayer player) {
+    co_await postgres::Database::CreateSchema(executor, url, TIMEOUT);
+    const auto conn = co_await postgres::Database::Connect(executor, url, TIMEOUT);
+    const postgres::RetiredPlayersRepository repository{*conn, TIMEOUT};
+    co_await repository.Save(player);
+    co_await repository.Save(player);
+    std::optional<postgres::RetiredPlayer> after;
+    int found = 0;
+    for (;;) {
+        auto players = co_await repository.Load(after, 1000);
+        found += static_cast<int>(std::count_if(players.begin(), players.end(), [&player](const auto& loaded) {
+            return loaded.id == player.id;
+        }));
+        if (players.size() < 1000) {
+            break;
+        }
+        after = std::move(players.back());
+    }
+    std::vector<std::string> delete_params{player.id.ToString()};
+    co_await conn->Execute("DELETE FROM retired_players WHERE id = $1;"s, std::move(delete_params), TIMEOUT);
+    co_return found;
+}
+
+// Имя игроков, которых записывает тест производительности. По нему они удаляются после теста
+constexpr std::string_view BENCHMARK_PLAYER_NAME = "insert benchmark";
+
+// Записывает count игроков запросом записи из репозитория: подготовленным или отправляемым с текстом каждый раз
+net::awaitable<void> InsertPlayers(AsyncConnection& conn, bool prepared, int count) {
+    for (int i = 0; i < count; ++i) {
+        std::vector<std::string> params{postgres::RetiredPlayerId::New().ToString(), std::string{BENCHMARK_PLAYER_NAME},
+                                        "0"s, "0"s};
+        if (prepared) {
+            auto insert = conn.ExecutePrepared(std::string{RetiredPlayersRepository::SAVE_STATEMENT},
+                                               std::move(params), TIMEOUT);
+            co_await std::move(insert);
+        } else {
+            auto insert = conn.Execute(std::string{RetiredPlayersRepository::SAVE_SQL}, std::move(params), TIMEOUT);
+            co_await std::move(insert);
+        }
+    }
+}
+
+net::awaitable<std::unique_ptr<AsyncConnection>> ConnectForBenchmark(AsyncConnection::Executor executor,
+                                                                     std::string url) {
+    co_await postgres::Database::CreateSchema(executor, url, TIMEOUT);
+    co_return co_await postgres::Database::Connect(executor, std::move(url), TIMEOUT);
+}
+
+net::awaitable<void> DeleteBenchmarkPlayers(AsyncConnection& conn) {
+    std::vector<std::string> params{std::string{BENCHMARK_PLAYER_NAME}};
+    co_await conn.Execute("DELETE FROM retired_players WHERE name = $1;"s, std::move(params), TIMEOUT);
+}
+
+}  // namespace
+
+SCENARIO("Postgres connection") {
+    const auto url = GetTestDbUrl();
+    if (!url) {
+        WARN("GAME_DB_URL is not set, Postgres tests are skipped");
+        return;
+    }
+    net::io_context ioc;
+
+    GIVEN("a prepared statement") {
+        THEN("it can be executed many times with different parameters") {
+            CHECK(RunAsync(ioc, ExecutePreparedTwice(ioc.get_executor(), *url)) == 2 + 42);
+        }
+    }
+
+    GIVEN("a retired player") {
+        const postgres::RetiredPlayer player{postgres::RetiredPlayerId::New(), "Rex"s, 10, 1000};
+
+        WHEN("the player is saved twice") {
+            THEN("the records table holds one row for them") {
+                CHECK(RunAsync(ioc, SaveTwiceAndCount(ioc.get_executor(), *url, player)) == 1);
+            }
+        }
+    }
+}
+
+// Запуск: GAME_DB_URL=postgres://... game_server_tests "[benchmark]"
+// Сравнивает время записи игрока подготовленным запросом и тем же запросом, разбираемым сервером каждый раз
+TEST_CASE("Retired player insert latency", "[.][benchmark]") {
+    const auto url = GetTestDbUrl();
+    if (!url) {
+        WARN("GAME_DB_URL is not set, the insert benchmark is skipped");
+        return;
+    }
+    constexpr int INSERTS = 100;
+    net::io_context ioc;
+    const auto conn = RunAsync(ioc, ConnectForBenchmark(ioc.get_executor(), *url));
+
+    BENCHMARK("100 inserts via ExecutePrepared") {
+        RunAsync(ioc, InsertPlayers(*conn, true, INSERTS));
+    };
+    BENCHMARK("100 inserts via Execute") {
+        RunAsync(ioc, InsertPlayers(*conn, false, INSERTS));
+    };
+
+    RunAsync(ioc, DeleteBenchmarkPlayers(*conn));
+}
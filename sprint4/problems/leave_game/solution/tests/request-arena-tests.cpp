@@ -0,0 +1,30 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/request_arena.h"
+
+namespace json = boost::json;
+
+SCENARIO("JSON serialization into a string") {
+    GIVEN("a small JSON body") {
+        const json::object body{{"code", "badRequest"}, {"message", "Invalid parameter start"}};
+
+        THEN("the string matches json::serialize and is allocated at its exact size") {
+            const std::string result = http_handler::SerializeJson(body);
+            CHECK(result == json::serialize(body));
+            CHECK(result.capacity() == result.size());
+        }
+    }
+
+    GIVEN("a body larger than the serialization chunk") {
+        json::array body;
+        for (int i = 0; i < 2000; ++i) {
+            body.emplace_back(json::object{{"name", "Dog " + std::to_string(i)}, {"score", i}});
+        }
+
+        THEN("the whole body is serialized") {
+            const std::string result = http_handler::SerializeJson(body);
+            CHECK(result.size() > 4096);
+            CHECK(result == json::serialize(body));
+        }
+    }
+}
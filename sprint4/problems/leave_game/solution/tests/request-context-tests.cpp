@@ -0,0 +1,43 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/request_context.h"
+
+using namespace std::literals;
+using namespace server_logging;
+
+SCENARIO("Request timing") {
+    GIVEN("a request context") {
+        RequestContext context;
+        context.received_at = RequestContext::Clock::time_point{} + 100ms;
+
+        WHEN("the request is answered without api_strand") {
+            context.responded_at = context.received_at + 5ms;
+
+            THEN("the whole response time is spent in the handler") {
+                CHECK(context.GetResponseTime() == 5ms);
+                CHECK(context.GetStrandWait() == 0ms);
+                CHECK(context.GetHandlerTime() == 5ms);
+            }
+        }
+        WHEN("the request waits in the api_strand queue") {
+            context.strand_enqueued_at = context.received_at + 1ms;
+            context.strand_started_at = context.received_at + 31ms;
+            context.responded_at = context.received_at + 35ms;
+
+            THEN("the queue wait is reported separately from the handler time") {
+                CHECK(context.GetResponseTime() == 35ms);
+                CHECK(context.GetStrandWait() == 30ms);
+                CHECK(context.GetHandlerTime() == 5ms);
+            }
+        }
+        WHEN("the request is rejected before it starts in api_strand") {
+            context.strand_enqueued_at = context.received_at;
+            context.responded_at = context.received_at + 2ms;
+
+            THEN("no queue wait is reported") {
+                CHECK(context.GetStrandWait() == 0ms);
+                CHECK(context.GetHandlerTime() == 2ms);
+            }
+        }
+    }
+}
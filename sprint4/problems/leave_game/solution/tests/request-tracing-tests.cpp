@@ -0,0 +1,65 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/request_tracer.h"
+
+using namespace std::literals;
+using namespace server_logging;
+
+namespace {
+
+RequestContext MakeRecordsRequestContext() {
+    const auto start = RequestContext::Clock::time_point{} + 1s;
+    RequestContext context;
+    context.accepted_at = start - 10ms;
+    context.read_started_at = start;
+    context.read_finished_at = start + 1ms;
+    context.received_at = start + 1ms;
+    context.api_route = http_handler::ApiRoute::RECORDS;
+    context.strand_enqueued_at = start + 1ms;
+    context.strand_started_at = start + 21ms;
+    context.responded_at = start + 26ms;
+    return context;
+}
+
+}  // namespace
+
+SCENARIO("Server-Timing header") {
+    GIVEN("a request that waited in api_strand") {
+        const RequestContext context = MakeRecordsRequestContext();
+
+        THEN("every phase is reported in milliseconds") {
+            CHECK(FormatServerTiming(context) == "read;dur=1.000, queue;dur=20.000, app;dur=5.000, total;dur=26.000"s);
+        }
+    }
+}
+
+SCENARIO("Request trace events") {
+    GIVEN("a traced request") {
+        RequestTracer::Trace trace;
+        trace.context = MakeRecordsRequestContext();
+        trace.method = "GET"s;
+        trace.target = "/api/v1/game/records?start=\"0\""s;
+        trace.status = 200;
+        trace.written_at = trace.context.responded_at + 2ms;
+
+        WHEN("its events are formatted") {
+            std::string out;
+            RequestTracer::AppendEvents(out, trace, 7);
+
+            THEN("every phase becomes a span on the request track") {
+                for (const auto name : {"accept"sv, "request"sv, "read"sv, "strand_wait"sv, "handler"sv,
+                                        "write"sv}) {
+                    CHECK(out.find(R"({"name":")"s + std::string{name} + R"(")"s) != std::string::npos);
+                }
+                CHECK(out.find(R"("pid":2,"tid":7)"sv) != std::string::npos);
+                CHECK(out.find(R"("name":"handler","cat":"request","ph":"X","pid":2,"tid":7,"ts":1021000.000,"dur":5000.000)"sv)
+                      != std::string::npos);
+                CHECK(out.find(R"("write","cat":"request","ph":"X","pid":2,"tid":7,"ts":1026000.000,"dur":2000.000)"sv)
+                      != std::string::npos);
+            }
+            THEN("request attributes are escaped") {
+                CHECK(out.find(R"("target":"/api/v1/game/records?start=\"0\"","status":200)"sv) != std::string::npos);
+            }
+        }
+    }
+}
@@ -0,0 +1,128 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/use_awaitable.hpp>
+
+#include "../src/metrics.h"
+#include "../src/retired_players_writer.h"
+
+using namespace std::literals;
+using app::RetiredPlayersWriter;
+
+namespace {
+
+namespace net = boost::asio;
+
+postgres::RetiredPlayer MakePlayer(std::string name) {
+    return {postgres::RetiredPlayerId::New(), std::move(name), 10, 1000};
+}
+
+// Очередь записи в поддельную базу данных. Первые failures попыток записи завершаются ошибкой
+struct WriterFixture {
+    explicit WriterFixture(RetiredPlayersWriter::Settings settings)
+            : writer(ioc.get_executor(), settings, [this](const postgres::RetiredPlayer& player) {
+                return Write(player.name);
+            }) {
+    }
+
+    net::awaitable<void> Write(std::string name) {
+        ++attempts;
+        if (failures > 0) {
+            --failures;
+            throw postgres::DatabaseError("Connection refused"s);
+        }
+        saved.push_back(std::move(name));
+        co_return;
+    }
+
+    // Ждёт записи очереди не дольше timeout и возвращает число незаписанных игроков.
+    // Цикл событий выполняется только до завершения Flush: ожидающий повтора игрок остаётся в очереди
+    size_t Flush(std::chrono::milliseconds timeout) {
+        std::optional<size_t> unsaved;
+        net::co_spawn(ioc, writer.Flush(timeout), [&unsaved](std::exception_ptr, size_t count) {
+            unsaved = count;
+        });
+        while (!unsaved) {
+            ioc.run_one();
+        }
+        return *unsaved;
+    }
+
+    static RetiredPlayersWriter::Settings MakeSettings(std::chrono::milliseconds retry_delay) {
+        RetiredPlayersWriter::Settings settings;
+        settings.initial_retry_delay = retry_delay;
+        settings.max_retry_delay = retry_delay * 4;
+        return settings;
+    }
+
+    net::io_context ioc;
+    int attempts = 0;
+    int failures = 0;
+    std::vector<std::string> saved;
+    RetiredPlayersWriter writer;
+};
+
+}  // namespace
+
+SCENARIO("Retired players writer") {
+    GIVEN("a writer with room for two players") {
+        auto settings = WriterFixture::MakeSettings(1ms);
+        settings.max_pending = 2;
+        WriterFixture fixture{settings};
+        auto& writer = fixture.writer;
+
+        WHEN("players are enqueued") {
+            CHECK(writer.Enqueue(MakePlayer("Rex")));
+            CHECK(writer.Enqueue(MakePlayer("Bim")));
+
+            THEN("the queue rejects players beyond its size and counts them as lost") {
+                const auto lost = metrics::GetServerMetrics().retired_players_lost.Get();
+                CHECK_FALSE(writer.Enqueue(MakePlayer("Ace")));
+                CHECK(writer.GetPendingCount() == 2);
+                CHECK(metrics::GetServerMetrics().retired_players_lost.Get() == lost + 1);
+                CHECK(metrics::GetServerMetrics().retired_players_queue_depth.Get() == 2);
+            }
+
+            THEN("they are written in order") {
+                fixture.ioc.run();
+                CHECK(fixture.saved == std::vector<std::string>{"Rex", "Bim"});
+                CHECK(writer.GetPendingCount() == 0);
+                CHECK(metrics::GetServerMetrics().retired_players_queue_depth.Get() == 0);
+                CHECK(writer.Enqueue(MakePlayer("Ace")));
+                CHECK(metrics::GetServerMetrics().retired_players_queue_depth.Get() == 1);
+            }
+        }
+
+        WHEN("the database is unavailable for a while") {
+            fixture.failures = 5;
+            CHECK(writer.Enqueue(MakePlayer("Rex")));
+            CHECK(writer.Enqueue(MakePlayer("Bim")));
+
+            THEN("every player is written once it becomes available") {
+                const auto failures = metrics::GetServerMetrics().retired_player_save_failures.Get();
+                CHECK(fixture.Flush(5s) == 0);
+                CHECK(fixture.attempts == 7);
+                CHECK(metrics::GetServerMetrics().retired_player_save_failures.Get() == failures + 5);
+                CHECK(fixture.saved == std::vector<std::string>{"Rex", "Bim"});
+            }
+        }
+    }
+
+    GIVEN("a writer that retries once an hour") {
+        WriterFixture fixture{WriterFixture::MakeSettings(1h)};
+
+        WHEN("the database stays unavailable") {
+            fixture.failures = 1'000;
+            CHECK(fixture.writer.Enqueue(MakePlayer("Rex")));
+
+            THEN("flush retries at once and reports the player as unsaved after the timeout") {
+                const auto started_at = std::chrono::steady_clock::now();
+                CHECK(fixture.Flush(20ms) == 1);
+                CHECK(metrics::GetServerMetrics().retired_players_queue_depth.Get() == 1);
+                CHECK(std::chrono::steady_clock::now() - started_at < 1s);
+                CHECK(fixture.attempts == 2);
+                CHECK(fixture.saved.empty());
+            }
+        }
+    }
+}
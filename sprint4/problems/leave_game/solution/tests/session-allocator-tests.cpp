@@ -0,0 +1,65 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <vector>
+
+#include "../src/session_allocator.h"
+
+using http_server::RecyclingAllocator;
+using http_server::RecyclingPool;
+
+SCENARIO("Per-connection recycling pool") {
+    GIVEN("a pool") {
+        RecyclingPool pool;
+
+        WHEN("a block is freed") {
+            void* first = pool.Allocate(100);
+            pool.Deallocate(first, 100);
+            THEN("a block of the same size class is reused") {
+                void* second = pool.Allocate(120);
+                CHECK(second == first);
+                pool.Deallocate(second, 120);
+            }
+            THEN("a block of another size class is not reused") {
+                void* other = pool.Allocate(30);
+                CHECK(other != first);
+                pool.Deallocate(other, 30);
+            }
+        }
+
+        WHEN("a string with the pool allocator is rebuilt for every request") {
+            using PoolString = std::basic_string<char, std::char_traits<char>, RecyclingAllocator<char>>;
+            const void* data = nullptr;
+            for (int request = 0; request < 3; ++request) {
+                PoolString body(RecyclingAllocator<char>{pool});
+                body.assign(200, 'x');
+                if (request == 0) {
+                    data = body.data();
+                }
+                THEN("its buffer is taken from the recycled block") {
+                    CHECK(body.data() == data);
+                }
+            }
+        }
+
+        WHEN("a block is larger than the biggest size class") {
+            void* block = pool.Allocate(RecyclingPool::MAX_BLOCK_SIZE + 1);
+            THEN("it is served by the heap") {
+                CHECK(block != nullptr);
+                pool.Deallocate(block, RecyclingPool::MAX_BLOCK_SIZE + 1);
+            }
+        }
+    }
+
+    GIVEN("allocators rebound from one another") {
+        RecyclingPool pool;
+        RecyclingAllocator<char> chars{pool};
+        RecyclingAllocator<int> ints{chars};
+        THEN("they compare equal and share the pool") {
+            CHECK(ints == chars);
+            std::vector<int, RecyclingAllocator<int>> values(ints);
+            values.assign(10, 1);
+            CHECK(values.size() == 10);
+        }
+    }
+}
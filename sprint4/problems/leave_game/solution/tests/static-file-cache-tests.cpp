@@ -0,0 +1,191 @@
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <fstream>
+
+#include <unistd.h>
+
+#include "../src/shared_buffer_body.h"
+#include "../src/static_file_cache.h"
+
+using namespace std::literals;
+using namespace http_handler;
+
+namespace {
+
+std::string GzipDecompress(const std::string& data) {
+    namespace io = boost::iostreams;
+    io::filtering_istream in;
+    in.push(io::gzip_decompressor());
+    in.push(io::array_source(data.data(), data.size()));
+    return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+}
+
+// Временный каталог со статическими файлами, удаляемый после теста
+class TempRoot {
+public:
+    explicit TempRoot(const std::string& suffix = {})
+            : path_(fs::temp_directory_path()
+                    / ("static-file-cache-tests-"s + std::to_string(::getpid()) + suffix)) {
+        fs::remove_all(path_);
+        fs::create_directories(path_ / "js");
+    }
+    ~TempRoot() {
+        fs::remove_all(path_);
+    }
+
+    fs::path Write(const fs::path& rel_path, const std::string& content) const {
+        std::ofstream(path_ / rel_path, std::ios::binary) << content;
+        return fs::weakly_canonical(path_ / rel_path);
+    }
+
+    const fs::path& GetPath() const {
+        return path_;
+    }
+
+private:
+    fs::path path_;
+};
+
+std::string GetMimeType(const fs::path& path) {
+    if (path.extension() == ".html"sv) {
+        return "text/html"s;
+    }
+    if (path.extension() == ".js"sv) {
+        return "text/javascript"s;
+    }
+    return "image/png"s;
+}
+
+}  // namespace
+
+SCENARIO("Static file cache") {
+    GIVEN("a directory with text and binary files") {
+        const TempRoot root;
+        std::string html;
+        for (int i = 0; i < 100; ++i) {
+            html += "<p>Hello, world!</p>\n"s;
+        }
+        root.Write("index.html", html);
+        root.Write("js/app.js", "let x = 1;"s);
+        root.Write("image.png", std::string(1000, 'x'));
+
+        const StaticIndex index(root.GetPath(), GetMimeType);
+        const auto& html_file = *index.Find("/index.html"sv);
+        const auto& js_file = *index.Find("/js/app.js"sv);
+        const auto& png_file = *index.Find("/image.png"sv);
+
+        WHEN("the whole directory fits into the cache") {
+            const StaticFileCache cache(index, {});
+
+            THEN("every file is loaded") {
+                CHECK(cache.GetFileCount() == 3);
+                CHECK(cache.GetTotalSize() == html.size() + 10 + 1000);
+            }
+            THEN("files are found by index entry") {
+                const auto* file = cache.Find(html_file);
+                REQUIRE(file);
+                CHECK(*file->plain == html);
+                CHECK(file->mime_type == "text/html"s);
+                CHECK(file->etag == StaticFileCache::MakeEtag(html));
+            }
+            THEN("compressible files get a smaller gzip variant") {
+                const auto* file = cache.Find(html_file);
+                REQUIRE(file->gzip);
+                CHECK(file->gzip->size() < html.size());
+                CHECK(GzipDecompress(*file->gzip) == html);
+            }
+            THEN("short and binary files are stored uncompressed") {
+                CHECK_FALSE(cache.Find(js_file)->gzip);
+                CHECK_FALSE(cache.Find(png_file)->gzip);
+            }
+        }
+
+        WHEN("the cache size is limited") {
+            StaticFileCacheSettings settings;
+            settings.max_total_size = 1100;
+            const StaticFileCache cache(index, settings);
+
+            THEN("the smallest files are loaded first") {
+                CHECK(cache.GetFileCount() == 2);
+                CHECK(cache.Find(js_file));
+                CHECK(cache.Find(png_file));
+                CHECK(cache.Find(html_file) == nullptr);
+            }
+        }
+    }
+}
+
+SCENARIO("Static files index") {
+    GIVEN("a directory with nested index pages") {
+        const TempRoot root;
+        const auto index_path = root.Write("index.html", "root"s);
+        const auto nested_path = root.Write("js/index.html", "nested"s);
+        const auto js_path = root.Write("js/app.js", "let x = 1;"s);
+        const StaticIndex index(root.GetPath(), GetMimeType);
+
+        THEN("files are found by URL path") {
+            const auto* entry = index.Find("/js/app.js"sv);
+            REQUIRE(entry);
+            CHECK(entry->path == js_path);
+            CHECK(entry->size == 10);
+            CHECK(entry->mime_type == "text/javascript"s);
+            CHECK(index.GetFiles().size() == 3);
+        }
+        THEN("directories resolve to their index.html") {
+            CHECK(index.Find("/"sv)->path == index_path);
+            CHECK(index.Find("/js"sv)->path == nested_path);
+            CHECK(index.Find("/js/"sv)->path == nested_path);
+        }
+        THEN("dot segments are normalized without leaving the root") {
+            CHECK(index.Find("/js/../index.html"sv)->path == index_path);
+            CHECK(index.Find("/./js/./app.js"sv)->path == js_path);
+            CHECK(index.Find("/../../js/app.js"sv)->path == js_path);
+        }
+        THEN("missing files are not found") {
+            CHECK(index.Find("/missing.html"sv) == nullptr);
+            CHECK(index.Find("/js/app.js/"sv) == nullptr);
+        }
+    }
+    GIVEN("a symbolic link to a file outside the directory") {
+        const TempRoot root;
+        const TempRoot outside{"-outside"};
+        const auto secret_path = outside.Write("secret.txt", "secret"s);
+        fs::create_symlink(secret_path, root.GetPath() / "secret.txt");
+        const StaticIndex index(root.GetPath(), GetMimeType);
+
+        THEN("the link is not indexed") {
+            CHECK(index.Find("/secret.txt"sv) == nullptr);
+        }
+    }
+}
+
+SCENARIO("ETag of cached content") {
+    THEN("ETag is a quoted value that depends on content") {
+        const auto etag = StaticFileCache::MakeEtag("content"sv);
+        CHECK(etag.front() == '"');
+        CHECK(etag.back() == '"');
+        CHECK(etag == StaticFileCache::MakeEtag("content"sv));
+        CHECK(etag != StaticFileCache::MakeEtag("Content"sv));
+    }
+    THEN("ETag is the SHA-1 of content and does not depend on the build") {
+        CHECK(StaticFileCache::MakeEtag("content"sv) == "\"040f06fd774092478d450774f5ba30c5da78acc8\""s);
+        CHECK(StaticFileCache::MakeEtag(""sv) == "\"da39a3ee5e6b4b0d3255bfef95601890afd80709\""s);
+    }
+}
+
+SCENARIO("Shared buffer body") {
+    const auto data = std::make_shared<const std::string>("0123456789"s);
+
+    THEN("the body refers to the whole buffer or its slice without copying") {
+        const SharedBufferBody::value_type whole{data};
+        CHECK(whole.View().data() == data->data());
+        CHECK(SharedBufferBody::size(whole) == 10);
+
+        const SharedBufferBody::value_type slice{data, 2, 5};
+        CHECK(slice.View() == "23456"sv);
+        CHECK(SharedBufferBody::size(slice) == 5);
+    }
+}
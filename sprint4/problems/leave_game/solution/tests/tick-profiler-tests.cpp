@@ -0,0 +1,84 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <memory>
+
+#include "../src/tick_profiler.h"
+
+using namespace std::literals;
+using namespace metrics;
+
+namespace {
+
+size_t CountOccurrences(std::string_view text, std::string_view substring) {
+    size_t count = 0;
+    for (auto pos = text.find(substring); pos != std::string_view::npos; pos = text.find(substring, pos + 1)) {
+        ++count;
+    }
+    return count;
+}
+
+void RunTick(TickProfiler& profiler, std::string_view session) {
+    const TickProfiler::TickTimer tick{profiler};
+    {
+        const TickProfiler::PhaseTimer timer{profiler, TickPhase::MOVE_DOGS, session};
+        const TickProfiler::PhaseTimer nested{profiler, TickPhase::RETIRE_DOG, session};
+    }
+    const TickProfiler::PhaseTimer timer{profiler, TickPhase::DETECT_COLLISIONS, session};
+}
+
+}  // namespace
+
+SCENARIO("Tick profiler") {
+    // Гистограммы этапов занимают десятки килобайт, поэтому профилировщик размещается в куче
+    auto profiler = std::make_unique<TickProfiler>();
+
+    GIVEN("a profiler without trace capacity") {
+        WHEN("ticks run") {
+            RunTick(*profiler, "map1"sv);
+            RunTick(*profiler, "map1"sv);
+
+            THEN("phases are recorded into histograms only") {
+                CHECK(profiler->GetPhaseHistogram(TickPhase::MOVE_DOGS).Collect().count == 2);
+                CHECK(profiler->GetPhaseHistogram(TickPhase::RETIRE_DOG).Collect().count == 2);
+                CHECK(profiler->GetPhaseHistogram(TickPhase::GENERATE_LOOT).Collect().count == 0);
+                std::string trace;
+                profiler->WriteChromeTrace(trace);
+                CHECK(trace == R"({"displayTimeUnit":"ms","traceEvents":[]})"sv);
+            }
+        }
+    }
+    GIVEN("a profiler keeping the last two ticks") {
+        profiler->SetTraceCapacity(2);
+
+        WHEN("three ticks run") {
+            RunTick(*profiler, "first"sv);
+            RunTick(*profiler, "second"sv);
+            RunTick(*profiler, "third\"map"sv);
+
+            THEN("only the last two are exported as complete events") {
+                std::string trace;
+                profiler->WriteChromeTrace(trace);
+                CHECK(trace.starts_with(R"({"displayTimeUnit":"ms","traceEvents":[{"name":"tick","cat":"tick","ph":"X",)"sv));
+                CHECK(trace.ends_with("}]}"sv));
+                CHECK(CountOccurrences(trace, R"("name":"tick")"sv) == 2);
+                CHECK(CountOccurrences(trace, R"("name":"move_dogs")"sv) == 2);
+                CHECK(CountOccurrences(trace, R"("name":"retire_dog")"sv) == 2);
+                CHECK(trace.find("first"sv) == std::string::npos);
+                CHECK(trace.find(R"("args":{"session":"second"})"sv) < trace.find(R"(third\"map)"sv));
+            }
+        }
+        WHEN("a phase is timed outside a tick") {
+            {
+                const TickProfiler::PhaseTimer timer{*profiler, TickPhase::GENERATE_LOOT, "map1"sv};
+            }
+            RunTick(*profiler, "map1"sv);
+
+            THEN("it is counted but not traced") {
+                CHECK(profiler->GetPhaseHistogram(TickPhase::GENERATE_LOOT).Collect().count == 1);
+                std::string trace;
+                profiler->WriteChromeTrace(trace);
+                CHECK(trace.find("generate_loot"sv) == std::string::npos);
+            }
+        }
+    }
+}
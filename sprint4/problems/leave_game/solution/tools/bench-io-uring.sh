@@ -0,0 +1,49 @@
+#!/usr/bin/env bash
+# A/B-сравнение сборок сервера с epoll и io_uring.
+# Для каждой сборки измеряются системные вызовы на запрос (strace -c) и задержки (wrk --latency).
+#
+# Использование:
+#   tools/bench-io-uring.sh <epoll_build_dir> <io_uring_build_dir> [url_path]
+# Сборки готовятся так:
+#   cmake -DCMAKE_BUILD_TYPE=Release -DGAME_SERVER_USE_IO_URING=OFF .. && cmake --build .
+#   cmake -DCMAKE_BUILD_TYPE=Release -DGAME_SERVER_USE_IO_URING=ON .. && cmake --build .
+# Переменные окружения: GAME_DB_URL, DURATION (по умолчанию 30s), CONNECTIONS (256), THREADS (8)
+set -euo pipefail
+
+EPOLL_DIR=${1:?epoll build dir}
+URING_DIR=${2:?io_uring build dir}
+URL_PATH=${3:-/game.html}
+DURATION=${DURATION:-30s}
+CONNECTIONS=${CONNECTIONS:-256}
+THREADS=${THREADS:-8}
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+URL="http://127.0.0.1:8080${URL_PATH}"
+
+run_case() {
+    local name=$1 binary=$2
+    shift 2
+    local strace_log
+    strace_log=$(mktemp)
+
+    strace -f -c -o "$strace_log" "$binary" -c "$ROOT/data/config.json" -w "$ROOT/static" "$@" >/dev/null 2>&1 &
+    local pid=$!
+    sleep 2
+
+    local wrk_out requests
+    wrk_out=$(wrk -t"$THREADS" -c"$CONNECTIONS" -d"$DURATION" --latency "$URL")
+    requests=$(echo "$wrk_out" | awk '/requests in/ {print $1}')
+
+    kill -INT "$pid"
+    wait "$pid" || true
+
+    local syscalls
+    syscalls=$(awk '$NF == "total" {print $4}' "$strace_log")
+    echo "== $name"
+    echo "$wrk_out" | grep -E 'Requests/sec|50%|99%'
+    echo "syscalls total: $syscalls, per request: $(echo "scale=2; $syscalls / $requests" | bc)"
+    rm -f "$strace_log"
+}
+
+run_case "epoll" "$EPOLL_DIR/game_server"
+run_case "io_uring (sockets)" "$URING_DIR/game_server"
+run_case "io_uring (sockets + files)" "$URING_DIR/game_server" --io-uring-files
@@ -0,0 +1,52 @@
+#!/usr/bin/env bash
+# Сравнение отдачи крупных статических файлов через file_body и через sendfile().
+# Для каждого режима измеряется процессорное время сервера (utime + stime) на гигабайт отданных данных.
+#
+# Использование:
+#   tools/bench-sendfile.sh <build_dir> [url_path]
+# Кэш статических файлов отключается, чтобы файл читался с диска.
+# Переменные окружения: GAME_DB_URL, DURATION (по умолчанию 30s), CONNECTIONS (64), THREADS (8)
+set -euo pipefail
+
+BUILD_DIR=${1:?build dir}
+URL_PATH=${2:-/assets/pug.fbx}
+DURATION=${DURATION:-30s}
+CONNECTIONS=${CONNECTIONS:-64}
+THREADS=${THREADS:-8}
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+URL="http://127.0.0.1:8080${URL_PATH}"
+FILE_SIZE=$(stat -c %s "$ROOT/static${URL_PATH}")
+CLK_TCK=$(getconf CLK_TCK)
+
+# Процессорное время процесса в тиках: поля utime и stime из /proc/<pid>/stat
+cpu_ticks() {
+    awk '{print $14 + $15}' "/proc/$1/stat"
+}
+
+run_case() {
+    local name=$1
+    shift
+    "$BUILD_DIR/game_server" -c "$ROOT/data/config.json" -w "$ROOT/static" --static-cache-size 0 "$@" \
+        >/dev/null 2>&1 &
+    local pid=$!
+    sleep 2
+
+    local ticks_before wrk_out ticks_after requests
+    ticks_before=$(cpu_ticks "$pid")
+    wrk_out=$(wrk -t"$THREADS" -c"$CONNECTIONS" -d"$DURATION" "$URL")
+    ticks_after=$(cpu_ticks "$pid")
+    requests=$(echo "$wrk_out" | awk '/requests in/ {print $1}')
+
+    kill -INT "$pid"
+    wait "$pid" || true
+
+    local gigabytes cpu_seconds
+    gigabytes=$(echo "scale=3; $requests * $FILE_SIZE / 1000000000" | bc)
+    cpu_seconds=$(echo "scale=3; ($ticks_after - $ticks_before) / $CLK_TCK" | bc)
+    echo "== $name"
+    echo "$wrk_out" | grep -E 'Requests/sec|Transfer/sec'
+    echo "served: ${gigabytes} GB, CPU: ${cpu_seconds} s, CPU per GB: $(echo "scale=3; $cpu_seconds / $gigabytes" | bc) s"
+}
+
+run_case "file_body" --sendfile-min-size 0
+run_case "sendfile"